@@ -0,0 +1,155 @@
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "bench.h"
+
+#include <errno.h>                // for errno, ENOENT
+#include <linux/perf_event.h>     // for perf_event_attr, PERF_TYPE_HARDWARE, PERF_COUNT_HW_*
+#include <math.h>                 // for ceil
+#include <stdbool.h>              // for false, true
+#include <stddef.h>               // for size_t
+#include <stdint.h>               // for uint64_t
+#include <stdlib.h>               // for free, malloc, qsort
+#include <sys/ioctl.h>            // for ioctl
+#include <sys/syscall.h>          // for SYS_perf_event_open
+#include <unistd.h>               // for close, read, syscall
+
+#include "common.h"               // for FORT_UNUSED
+
+static int cmp_double(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, size_t n, double p) {
+    size_t rank = (size_t)ceil(p / 100.0 * (double)n);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    return sorted[rank - 1];
+}
+
+void bench_summarize(double* samples, size_t n, bench_summary_t* summary) {
+    if (n == 0) {
+        *summary = (bench_summary_t){0};
+        return;
+    }
+
+    qsort(samples, n, sizeof(double), cmp_double);
+    *summary = (bench_summary_t){
+        .min = samples[0],
+        .median = percentile(samples, n, 50),
+        .p90 = percentile(samples, n, 90),
+        .p99 = percentile(samples, n, 99),
+        .max = samples[n - 1],
+    };
+}
+
+struct bench_counters {
+    int fds[BENCH_EVENT_COUNT];
+    int leader;
+};
+
+typedef struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} event_t;
+
+#define HW_CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const event_t EVENTS[] = {
+    [BENCH_EVENT_CYCLES] = {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [BENCH_EVENT_INSTRUCTIONS] = {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [BENCH_EVENT_BRANCH_MISSES] = {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [BENCH_EVENT_L1D_MISSES] = {"l1d_misses", PERF_TYPE_HW_CACHE, HW_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    [BENCH_EVENT_LLC_MISSES] = {"llc_misses", PERF_TYPE_HW_CACHE, HW_CACHE_MISS(PERF_COUNT_HW_CACHE_LL)},
+};
+_Static_assert(NELEM(EVENTS) == BENCH_EVENT_COUNT, "every event needs a description");
+
+const char* bench_event_name(bench_event_t event) {
+    return event < BENCH_EVENT_COUNT ? EVENTS[event].name : "unknown";
+}
+
+static int open_event(const event_t* event, int group_fd) {
+    struct perf_event_attr attr = {0};
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    // The leader starts disabled and the group follows it.
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+bench_counters_t* mkbench_counters(void) {
+    bench_counters_t* counters = malloc(sizeof(bench_counters_t));
+    counters->leader = -1;
+
+    // One group, so that all events cover exactly the same instructions and
+    // ratios such as IPC are meaningful. Events the CPU lacks are left out.
+    int err = ENOENT;
+    for (size_t i = 0; i < BENCH_EVENT_COUNT; ++i) {
+        counters->fds[i] = open_event(&EVENTS[i], counters->leader);
+        if (counters->fds[i] < 0) {
+            err = errno;
+        } else if (counters->leader < 0) {
+            counters->leader = counters->fds[i];
+        }
+    }
+
+    if (counters->leader < 0) {
+        free(counters);
+        errno = err;
+        return NULL;
+    }
+
+    return counters;
+}
+
+void bench_counters_fini(bench_counters_t* counters) {
+    if (counters == NULL) {
+        return;
+    }
+
+    // Members first; closing the leader would break up the group.
+    for (size_t i = BENCH_EVENT_COUNT; i-- > 0;) {
+        if (counters->fds[i] >= 0) {
+            FORT_UNUSED(close(counters->fds[i]));
+        }
+    }
+    free(counters);
+}
+
+void bench_counters_start(bench_counters_t* counters) {
+    FORT_UNUSED(ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP));
+    FORT_UNUSED(ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP));
+}
+
+void bench_counters_stop(bench_counters_t* counters, bench_counts_t* counts) {
+    FORT_UNUSED(ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP));
+
+    const bool first = counts->runs == 0;
+    counts->runs++;
+    for (size_t i = 0; i < BENCH_EVENT_COUNT; ++i) {
+        // value, time_enabled, time_running
+        uint64_t buf[3] = {0};
+        if (counters->fds[i] < 0 || read(counters->fds[i], buf, sizeof(buf)) != sizeof(buf) ||
+            buf[2] == 0) {
+            counts->valid[i] = false;
+            continue;
+        }
+
+        double val = (double)buf[0];
+        if (buf[2] < buf[1]) {
+            val *= (double)buf[1] / (double)buf[2];
+        }
+        counts->vals[i] += (uint64_t)val;
+        counts->valid[i] = first || counts->valid[i];
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FORT_BENCH_H
+#define FORT_BENCH_H
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for uint64_t
+
+// Distribution of repeated measurements, in whatever unit the samples use.
+typedef struct {
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double max;
+} bench_summary_t;
+
+// Sorts `samples` in place. Percentiles use the nearest rank, so they are
+// always one of the samples.
+void bench_summarize(double* samples, size_t n, bench_summary_t* summary);
+
+typedef enum {
+    BENCH_EVENT_CYCLES,
+    BENCH_EVENT_INSTRUCTIONS,
+    BENCH_EVENT_BRANCH_MISSES,
+    BENCH_EVENT_L1D_MISSES,
+    BENCH_EVENT_LLC_MISSES,
+    BENCH_EVENT_COUNT,
+} bench_event_t;
+
+// Hardware event counts summed over `runs` measurements. An event that could
+// not be counted in every run is marked invalid rather than reported short.
+typedef struct {
+    uint64_t vals[BENCH_EVENT_COUNT];
+    bool valid[BENCH_EVENT_COUNT];
+    size_t runs;
+} bench_counts_t;
+
+// User-space hardware counters for the calling thread, read with
+// perf_event_open.
+typedef struct bench_counters bench_counters_t;
+
+const char* bench_event_name(bench_event_t event);
+
+// Opens every event it can. Returns NULL with errno set if none could be
+// opened, e.g. without a PMU in a VM or with perf_event_paranoid > 2.
+bench_counters_t* mkbench_counters(void);
+
+void bench_counters_fini(bench_counters_t* counters);
+
+void bench_counters_start(bench_counters_t* counters);
+
+// Adds what was counted since bench_counters_start to `counts`, scaled up
+// when the kernel had to multiplex the counters.
+void bench_counters_stop(bench_counters_t* counters, bench_counts_t* counts);
+
+#endif // FORT_BENCH_H
@@ -0,0 +1,425 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <errno.h>     // for errno
+#include <getopt.h>    // for getopt_long, optarg, optind, option, required_argument
+#include <stdbool.h>   // for bool, false, true
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for fclose, fopen, fread, printf, snprintf, FILE
+#include <stdlib.h>    // for EXIT_FAILURE, EXIT_SUCCESS, free, malloc, qsort, strtod
+#include <string.h>    // for strcmp, strerror
+
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_OUTCOME_NOK_RET, FORT_UNUSED, eprintln
+#include "json.h"      // for json_t, json_get, json_get_num, json_parse, json_free
+
+// Compares stage_bench runs against a stored baseline and fails if a stage
+// got slower.
+//
+//   bench_check [--threshold=PCT] [--alpha=P] BASELINE CURRENT
+//
+// Both files hold one or more stage_bench runs, each from its own process.
+// Repetitions within a process share its CPU frequency, placement and load,
+// so they are not independent evidence; each run is reduced to its median
+// ns/token and only those medians are compared. A stage regresses when the
+// lower end of a bootstrap confidence interval, at level 1 - 2P, for the
+// ratio of the median run medians is more than PCT percent above 1.
+// Hardware counters, when both files have them, are the median over runs and
+// only checked against the threshold.
+//
+// To compare two builds rather than a build and the baseline, alternate
+// their stage_bench --append runs so that drift on the machine hits both.
+
+// Machines drift by this much between sessions without any code change, so
+// a smaller regression cannot be told apart from noise.
+#define DEFAULT_THRESHOLD_PCT 25.0
+#define DEFAULT_ALPHA 0.05
+#define FILE_MAX (64 * 1024 * 1024)
+#define BOOTSTRAP_RESAMPLES 10000
+#define BOOTSTRAP_SEED 0x9E3779B97F4A7C15ULL
+#define MIN_RUNS 3
+
+typedef enum {
+    VERDICT_SAME,
+    VERDICT_FASTER,
+    VERDICT_SLOWER,
+    VERDICT_MISSING,
+} verdict_t;
+
+static const char* const VERDICT_NAMES[] = {
+    [VERDICT_SAME] = "ok",
+    [VERDICT_FASTER] = "faster",
+    [VERDICT_SLOWER] = "REGRESSED",
+    [VERDICT_MISSING] = "MISSING",
+};
+
+typedef struct {
+    double threshold;
+    double alpha;
+} check_opts_t;
+
+// The runs of one file. A file with a single run, as older stage_bench wrote,
+// is read as a list of one.
+typedef struct {
+    json_t* json;
+    const json_t* runs;
+    size_t nruns;
+} run_set_t;
+
+static json_t* load_json(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        eprintln("error: cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    char* text = malloc(FILE_MAX + 1);
+    const size_t len = fread(text, 1, FILE_MAX, file);
+    FORT_UNUSED(fclose(file));
+    text[len] = '\0';
+
+    json_t* json = json_parse(text);
+    free(text);
+    if (json == NULL) {
+        eprintln("error: %s is not valid JSON", path);
+    }
+
+    return json;
+}
+
+static bool is_run(const json_t* run) {
+    const json_t* results = json_get(run, "results");
+
+    return results != NULL && results->kind == JSON_ARR;
+}
+
+static fort_outcome_t load_runs(const char* path, run_set_t* set) {
+    *set = (run_set_t){load_json(path), NULL, 0};
+    if (set->json == NULL) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    const json_t* runs = json_get(set->json, "runs");
+    if (runs != NULL && runs->kind == JSON_ARR && runs->len > 0) {
+        set->runs = runs->items;
+        set->nruns = runs->len;
+    } else {
+        set->runs = set->json;
+        set->nruns = 1;
+    }
+    for (size_t i = 0; i < set->nruns; ++i) {
+        if (!is_run(&set->runs[i])) {
+            eprintln("error: %s: expected stage_bench JSON output", path);
+            return FORT_OUTCOME_ERR;
+        }
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+// Counts in the JSON are whole numbers, so compare them as such.
+static size_t get_count(const json_t* obj, const char* key) {
+    const double val = json_get_num(obj, key, 0);
+
+    return val > 0 ? (size_t)val : 0;
+}
+
+static const json_t* find_result(const json_t* run, const char* stage, size_t funcs) {
+    const json_t* results = json_get(run, "results");
+    for (size_t i = 0; i < results->len; ++i) {
+        const json_t* r = &results->items[i];
+        const json_t* name = json_get(r, "stage");
+        if (name != NULL && name->kind == JSON_STR && strcmp(name->str, stage) == 0 &&
+            get_count(r, "funcs") == funcs) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Sorts `vals` in place.
+static double median(double* vals, size_t n) {
+    qsort(vals, n, sizeof(double), cmp_double);
+
+    return n % 2 == 1 ? vals[n / 2] : (vals[n / 2 - 1] + vals[n / 2]) / 2;
+}
+
+// Collects `key` of `metric` from every run that has a result for the stage
+// and size. Returns how many it found; `vals` has room for every run.
+static size_t collect(const run_set_t* set,
+                      const char* stage,
+                      size_t funcs,
+                      const char* metric,
+                      const char* key,
+                      double* vals) {
+    size_t n = 0;
+    for (size_t i = 0; i < set->nruns; ++i) {
+        const json_t* r = find_result(&set->runs[i], stage, funcs);
+        const json_t* obj = r != NULL ? json_get(r, metric) : NULL;
+        const json_t* val = obj != NULL ? json_get(obj, key) : NULL;
+        if (val != NULL && val->kind == JSON_NUM) {
+            vals[n++] = val->num;
+        }
+    }
+
+    return n;
+}
+
+// xorshift64*, seeded the same way every time so that a verdict does not
+// change between invocations on the same files.
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double resample_median(const double* vals, size_t n, double* scratch, uint64_t* state) {
+    for (size_t i = 0; i < n; ++i) {
+        scratch[i] = vals[next_random(state) % n];
+    }
+
+    return median(scratch, n);
+}
+
+// Percentile bootstrap interval, at level 1 - 2 * alpha, for the ratio of the
+// median of `cur` to the median of `base`.
+static void bootstrap_ratio(const double* base,
+                            size_t nbase,
+                            const double* cur,
+                            size_t ncur,
+                            double alpha,
+                            double* lo,
+                            double* hi) {
+    double* ratios = malloc(sizeof(double) * BOOTSTRAP_RESAMPLES);
+    double* scratch = malloc(sizeof(double) * (nbase > ncur ? nbase : ncur));
+    uint64_t state = BOOTSTRAP_SEED;
+    size_t n = 0;
+    for (size_t i = 0; i < BOOTSTRAP_RESAMPLES; ++i) {
+        const double b = resample_median(base, nbase, scratch, &state);
+        const double c = resample_median(cur, ncur, scratch, &state);
+        if (b > 0) {
+            ratios[n++] = c / b;
+        }
+    }
+    free(scratch);
+
+    *lo = 1;
+    *hi = 1;
+    if (n > 0) {
+        qsort(ratios, n, sizeof(double), cmp_double);
+        const size_t lo_idx = (size_t)(alpha * (double)(n - 1));
+        const size_t hi_idx = (size_t)((1 - alpha) * (double)(n - 1));
+        *lo = ratios[lo_idx];
+        *hi = ratios[hi_idx];
+    }
+    free(ratios);
+}
+
+static double pct_change(double base, double cur) {
+    return base > 0 ? (cur - base) / base * 100 : 0;
+}
+
+// `ci`, when there is one, is the interval for the change in percent.
+static void print_row(const char* stage,
+                      size_t funcs,
+                      const char* metric,
+                      double base,
+                      double cur,
+                      const double* ci,
+                      verdict_t verdict) {
+    FORT_UNUSED(printf("%-8s %8zu %-28s %12.3f %12.3f %+8.1f%%", stage, funcs, metric, base, cur,
+                       pct_change(base, cur)));
+    if (ci != NULL) {
+        FORT_UNUSED(printf(" %+7.1f%% %+7.1f%%", ci[0], ci[1]));
+    } else {
+        FORT_UNUSED(printf(" %8s %8s", "-", "-"));
+    }
+    FORT_UNUSED(printf("  %s\n", VERDICT_NAMES[verdict]));
+}
+
+// Compares the median ns/token of one stage and size across runs.
+static verdict_t check_time(const check_opts_t* opts,
+                            const char* stage,
+                            size_t funcs,
+                            const run_set_t* base,
+                            const run_set_t* cur) {
+    double* base_vals = malloc(sizeof(double) * base->nruns);
+    double* cur_vals = malloc(sizeof(double) * cur->nruns);
+    const size_t nbase = collect(base, stage, funcs, "ns_per_token", "median", base_vals);
+    const size_t ncur = collect(cur, stage, funcs, "ns_per_token", "median", cur_vals);
+
+    verdict_t verdict = VERDICT_MISSING;
+    double base_median = 0;
+    double cur_median = 0;
+    double ci[2] = {0, 0};
+    if (nbase > 0 && ncur > 0) {
+        double lo = 1;
+        double hi = 1;
+        bootstrap_ratio(base_vals, nbase, cur_vals, ncur, opts->alpha, &lo, &hi);
+        ci[0] = (lo - 1) * 100;
+        ci[1] = (hi - 1) * 100;
+        base_median = median(base_vals, nbase);
+        cur_median = median(cur_vals, ncur);
+
+        verdict = VERDICT_SAME;
+        if (ci[0] > opts->threshold) {
+            verdict = VERDICT_SLOWER;
+        } else if (ci[1] < -opts->threshold) {
+            verdict = VERDICT_FASTER;
+        }
+    }
+    print_row(stage, funcs, "ns_per_token.median", base_median, cur_median,
+              verdict == VERDICT_MISSING ? NULL : ci, verdict);
+    free(cur_vals);
+    free(base_vals);
+
+    return verdict;
+}
+
+// Compares the median over runs of every counter metric both files have.
+// Lower is better for all of them except IPC.
+static bool check_counters(const check_opts_t* opts,
+                           const char* stage,
+                           size_t funcs,
+                           const run_set_t* base,
+                           const run_set_t* cur) {
+    const json_t* first = find_result(&base->runs[0], stage, funcs);
+    const json_t* base_ctrs = first != NULL ? json_get(first, "counters") : NULL;
+    if (base_ctrs == NULL || base_ctrs->kind != JSON_OBJ) {
+        return true;
+    }
+
+    double* base_vals = malloc(sizeof(double) * base->nruns);
+    double* cur_vals = malloc(sizeof(double) * cur->nruns);
+    bool ok = true;
+    for (size_t i = 0; i < base_ctrs->len; ++i) {
+        const char* key = base_ctrs->keys[i];
+        const size_t nbase = collect(base, stage, funcs, "counters", key, base_vals);
+        const size_t ncur = collect(cur, stage, funcs, "counters", key, cur_vals);
+        if (nbase == 0 || ncur == 0) {
+            continue;
+        }
+        const double base_val = median(base_vals, nbase);
+        const double cur_val = median(cur_vals, ncur);
+
+        double change = pct_change(base_val, cur_val);
+        if (strcmp(key, "ipc") == 0) {
+            change = -change;
+        }
+        verdict_t verdict = VERDICT_SAME;
+        if (change > opts->threshold) {
+            verdict = VERDICT_SLOWER;
+            ok = false;
+        } else if (change < -opts->threshold) {
+            verdict = VERDICT_FASTER;
+        }
+        char metric[64];
+        FORT_UNUSED(snprintf(metric, sizeof(metric), "counters.%s", key));
+        print_row(stage, funcs, metric, base_val, cur_val, NULL, verdict);
+    }
+    free(cur_vals);
+    free(base_vals);
+
+    return ok;
+}
+
+static fort_outcome_t parse_num(const char* arg, double* val) {
+    char* end = NULL;
+    errno = 0;
+    *val = strtod(arg, &end);
+
+    return errno != 0 || end == arg || *end != '\0' || *val < 0 ? FORT_OUTCOME_ERR
+                                                                : FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_opts(int argc, char* argv[], check_opts_t* opts) {
+    enum { OPT_THRESHOLD = 1, OPT_ALPHA };
+    static const struct option long_opts[] = {{"threshold", required_argument, NULL, OPT_THRESHOLD},
+                                              {"alpha", required_argument, NULL, OPT_ALPHA},
+                                              {NULL, 0, NULL, 0}};
+    int opt = -1;
+    while ((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case OPT_THRESHOLD:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &opts->threshold));
+            break;
+        case OPT_ALPHA:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &opts->alpha));
+            break;
+        default:
+            return FORT_OUTCOME_ERR;
+        }
+    }
+
+    return argc - optind == 2 ? FORT_OUTCOME_OK : FORT_OUTCOME_ERR;
+}
+
+int main(int argc, char* argv[]) {
+    check_opts_t opts = {DEFAULT_THRESHOLD_PCT, DEFAULT_ALPHA};
+    if (parse_opts(argc, argv, &opts) != FORT_OUTCOME_OK || opts.alpha >= 0.5) {
+        eprintln("usage: bench_check [--threshold=PCT] [--alpha=P] BASELINE CURRENT");
+        return EXIT_FAILURE;
+    }
+
+    run_set_t base = {0};
+    run_set_t cur = {0};
+    if (load_runs(argv[optind], &base) != FORT_OUTCOME_OK ||
+        load_runs(argv[optind + 1], &cur) != FORT_OUTCOME_OK) {
+        json_free(cur.json);
+        json_free(base.json);
+        return EXIT_FAILURE;
+    }
+
+    if (get_count(&base.runs[0], "reps") != get_count(&cur.runs[0], "reps") ||
+        get_count(&base.runs[0], "warmup") != get_count(&cur.runs[0], "warmup")) {
+        eprintln("warning: runs differ in warm-up or repetitions; results may not be comparable");
+    }
+    if (base.nruns < MIN_RUNS || cur.nruns < MIN_RUNS) {
+        eprintln("warning: %zu baseline and %zu current run(s); with fewer than %d each the "
+                 "interval is too narrow to trust",
+                 base.nruns, cur.nruns, MIN_RUNS);
+    }
+
+    FORT_UNUSED(printf("threshold=%.1f%% alpha=%g runs=%zu/%zu\n", opts.threshold, opts.alpha,
+                       base.nruns, cur.nruns));
+    FORT_UNUSED(printf("%-8s %8s %-28s %12s %12s %9s %17s  %s\n", "stage", "funcs", "metric",
+                       "baseline", "current", "change", "interval", "verdict"));
+
+    // Every stage and size of the first baseline run; the others have the
+    // same ones unless stage_bench options changed between them.
+    size_t nregressed = 0;
+    const json_t* results = json_get(&base.runs[0], "results");
+    for (size_t i = 0; i < results->len; ++i) {
+        const json_t* b = &results->items[i];
+        const json_t* stage = json_get(b, "stage");
+        if (stage == NULL || stage->kind != JSON_STR) {
+            continue;
+        }
+        const size_t funcs = get_count(b, "funcs");
+
+        const verdict_t verdict = check_time(&opts, stage->str, funcs, &base, &cur);
+        if (verdict == VERDICT_SLOWER || verdict == VERDICT_MISSING) {
+            nregressed++;
+        }
+        if (verdict != VERDICT_MISSING && !check_counters(&opts, stage->str, funcs, &base, &cur)) {
+            nregressed++;
+        }
+    }
+
+    json_free(cur.json);
+    json_free(base.json);
+
+    if (nregressed > 0) {
+        eprintln("bench_check: %zu regression(s) against the baseline", nregressed);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
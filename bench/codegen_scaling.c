@@ -0,0 +1,124 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for printf
+#include <stdlib.h>    // for EXIT_FAILURE, EXIT_SUCCESS, free, malloc, strtoul
+#include <unistd.h>    // for sysconf, _SC_NPROCESSORS_ONLN
+
+#include "arena.h"     // for arena_t, arena_fini, arena_reset, mkarena
+#include "assemble.h"  // for asm_prog_t, assembler_run, assembler_set_pool
+#include "common.h"    // for FORT_OUTCOME_OK, eprintln
+#include "gen.h"       // for gen_opts_t, gen_default_opts, gen_src
+#include "lex.h"       // for tok_stream_t, lexer_run, mklexer
+#include "parse.h"     // for prog_t, parser_run, mkparser, prog_fini
+#include "pool.h"      // for mkpool, pool_fini, pool_t
+#include "timing.h"    // for timing_now
+
+// Lowers one program with many functions on 1, 2, 4, ... workers and prints
+// the best time of several rounds for each, relative to a single worker.
+//
+//   codegen_scaling [NFUNCS] [ROUNDS] [MAX_WORKERS]
+//
+// MAX_WORKERS defaults to the number of online CPUs.
+
+#define DEFAULT_NFUNCS 100000
+#define DEFAULT_ROUNDS 5
+#define ARENA_CHUNK_SZ (64 * 1024)
+#define NS_PER_MS 1e6
+
+static double run(prog_t* prog, size_t nworkers, size_t rounds) {
+    pool_t* pool = mkpool(nworkers);
+    arena_t** arenas = malloc(sizeof(arena_t*) * nworkers);
+    for (size_t i = 0; i < nworkers; ++i) {
+        arenas[i] = mkarena(ARENA_CHUNK_SZ);
+    }
+
+    assembler_t* assembler = mkassembler(prog);
+    assembler_set_pool(assembler, pool);
+
+    double best = -1;
+    for (size_t r = 0; r < rounds; ++r) {
+        asm_prog_t asm_prog = {0};
+        asm_prog.arenas = arenas;
+
+        const uint64_t start = timing_now();
+        const fort_outcome_t outcome = assembler_run(assembler, &asm_prog);
+        const double elapsed = (double)(timing_now() - start) / NS_PER_MS;
+
+        for (size_t i = 0; i < nworkers; ++i) {
+            arena_reset(arenas[i]);
+        }
+        if (outcome != FORT_OUTCOME_OK) {
+            best = -1;
+            break;
+        }
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    assembler_fini(assembler);
+    for (size_t i = 0; i < nworkers; ++i) {
+        arena_fini(arenas[i]);
+    }
+    free(arenas);
+    pool_fini(pool);
+
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    const int base = 10;
+    const size_t nfuncs = argc > 1 ? strtoul(argv[1], NULL, base) : DEFAULT_NFUNCS;
+    const size_t rounds = argc > 2 ? strtoul(argv[2], NULL, base) : DEFAULT_ROUNDS;
+    if (nfuncs == 0 || rounds == 0) {
+        eprintln("usage: codegen_scaling [NFUNCS] [ROUNDS] [MAX_WORKERS]");
+        return EXIT_FAILURE;
+    }
+
+    gen_opts_t gen_opts = gen_default_opts();
+    gen_opts.funcs = nfuncs;
+    size_t len = 0;
+    char* src = gen_src(&gen_opts, &len);
+    if (src == NULL) {
+        eprintln("error: failed to generate source");
+        return EXIT_FAILURE;
+    }
+    lexer_t* lexer = mklexer(src, len);
+    tok_stream_t toks = {0};
+    prog_t prog = {0};
+    parser_t* parser = NULL;
+    if (lexer_run(lexer, &toks) != FORT_OUTCOME_OK ||
+        parser_run(parser = mkparser(&toks), &prog) != FORT_OUTCOME_OK) {
+        eprintln("error: failed to parse generated source");
+        return EXIT_FAILURE;
+    }
+
+    const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_workers = ncpus > 0 ? (size_t)ncpus : 1;
+    if (argc > 3) {
+        max_workers = strtoul(argv[3], NULL, base);
+    }
+
+    FORT_UNUSED(printf("functions=%zu rounds=%zu\n", nfuncs, rounds));
+    FORT_UNUSED(printf("%8s %12s %8s\n", "workers", "best_ms", "speedup"));
+    double serial = 0;
+    for (size_t nworkers = 1; nworkers <= max_workers; nworkers *= 2) {
+        const double ms = run(&prog, nworkers, rounds);
+        if (ms < 0) {
+            eprintln("error: code generation failed with %zu workers", nworkers);
+            return EXIT_FAILURE;
+        }
+        if (nworkers == 1) {
+            serial = ms;
+        }
+        FORT_UNUSED(printf("%8zu %12.3f %8.2f\n", nworkers, ms, serial / ms));
+    }
+
+    prog_fini(&prog);
+    parser_fini(parser);
+    tok_stream_fini(&toks);
+    lexer_fini(lexer);
+    free(src);
+
+    return EXIT_SUCCESS;
+}
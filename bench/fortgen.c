@@ -0,0 +1,166 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <errno.h>    // for errno
+#include <getopt.h>   // for getopt_long, optarg, optind, option, required_argument
+#include <stdint.h>   // for uint32_t, INT32_MAX
+#include <stdio.h>    // for fclose, fopen, stdout, FILE
+#include <stdlib.h>   // for EXIT_FAILURE, EXIT_SUCCESS, strtod, strtoull
+
+#include "common.h"   // for FORT_OUTCOME_OK, FORT_OUTCOME_NOK_RET, eprintln
+#include "gen.h"      // for gen_opts_t, gen_default_opts, gen_write
+
+// Writes a synthetic fort program for benchmarks and scale tests.
+//
+//   fortgen [--funcs=N | --size=BYTES[K|M|G]] [--ident-len=N] [--comments=P]
+//           [--const-max=N] [--seed=N] [-o FILE]
+//
+// Without --funcs, functions are added until the program is about --size
+// bytes long (default 1M).
+
+#define DEFAULT_SIZE (1024 * 1024)
+#define KB 1024ULL
+
+static void print_usage(void) {
+    eprintln("Usage: fortgen [OPTIONS]");
+    eprintln("Options:");
+    eprintln("  --funcs=N          Number of functions besides main");
+    eprintln("  --size=BYTES       Approximate program size, with an optional K, M or G");
+    eprintln("                     suffix (default: 1M); ignored with --funcs");
+    eprintln("  --ident-len=N      Length of function names (at least %d)", GEN_IDENT_LEN_MIN);
+    eprintln("  --comments=P       Chance in [0, 1] of a comment before each function");
+    eprintln("  --const-max=N      Largest returned constant");
+    eprintln("  --seed=N           Seed; the same options always give the same program");
+    eprintln("  -o FILE            Write to FILE instead of stdout");
+}
+
+static fort_outcome_t parse_u64(const char* arg, unsigned long long* val, char** end) {
+    const int base = 10;
+    errno = 0;
+    *val = strtoull(arg, end, base);
+
+    return errno != 0 || *end == arg ? FORT_OUTCOME_ERR : FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_num(const char* arg, unsigned long long* val) {
+    char* end = NULL;
+    FORT_OUTCOME_NOK_RET(parse_u64(arg, val, &end));
+
+    return *end == '\0' ? FORT_OUTCOME_OK : FORT_OUTCOME_ERR;
+}
+
+static fort_outcome_t parse_size(const char* arg, size_t* size) {
+    char* end = NULL;
+    unsigned long long val = 0;
+    FORT_OUTCOME_NOK_RET(parse_u64(arg, &val, &end));
+
+    switch (*end) {
+    case '\0':
+        break;
+    case 'K':
+        val *= KB;
+        break;
+    case 'M':
+        val *= KB * KB;
+        break;
+    case 'G':
+        val *= KB * KB * KB;
+        break;
+    default:
+        return FORT_OUTCOME_ERR;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        return FORT_OUTCOME_ERR;
+    }
+    *size = (size_t)val;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_prob(const char* arg, double* p) {
+    char* end = NULL;
+    errno = 0;
+    *p = strtod(arg, &end);
+
+    return errno != 0 || end == arg || *end != '\0' || !(*p >= 0 && *p <= 1) ? FORT_OUTCOME_ERR
+                                                                            : FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_opts(int argc, char* argv[], gen_opts_t* opts, const char** out_path) {
+    enum { OPT_FUNCS = 1, OPT_SIZE, OPT_IDENT_LEN, OPT_COMMENTS, OPT_CONST_MAX, OPT_SEED };
+    static const struct option long_opts[] = {{"funcs", required_argument, NULL, OPT_FUNCS},
+                                              {"size", required_argument, NULL, OPT_SIZE},
+                                              {"ident-len", required_argument, NULL, OPT_IDENT_LEN},
+                                              {"comments", required_argument, NULL, OPT_COMMENTS},
+                                              {"const-max", required_argument, NULL, OPT_CONST_MAX},
+                                              {"seed", required_argument, NULL, OPT_SEED},
+                                              {NULL, 0, NULL, 0}};
+    int opt = -1;
+    unsigned long long val = 0;
+    while ((opt = getopt_long(argc, argv, "o:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case OPT_FUNCS:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &val));
+            opts->funcs = (size_t)val;
+            break;
+        case OPT_SIZE:
+            FORT_OUTCOME_NOK_RET(parse_size(optarg, &opts->max_bytes));
+            break;
+        case OPT_IDENT_LEN:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &val));
+            if (val < GEN_IDENT_LEN_MIN) {
+                return FORT_OUTCOME_ERR;
+            }
+            opts->ident_len = (size_t)val;
+            break;
+        case OPT_COMMENTS:
+            FORT_OUTCOME_NOK_RET(parse_prob(optarg, &opts->comment_density));
+            break;
+        case OPT_CONST_MAX:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &val));
+            // Constants must fit in an i32.
+            if (val > INT32_MAX) {
+                return FORT_OUTCOME_ERR;
+            }
+            opts->const_max = (uint32_t)val;
+            break;
+        case OPT_SEED:
+            FORT_OUTCOME_NOK_RET(parse_num(optarg, &val));
+            opts->seed = val;
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        default:
+            return FORT_OUTCOME_ERR;
+        }
+    }
+
+    return optind == argc ? FORT_OUTCOME_OK : FORT_OUTCOME_ERR;
+}
+
+int main(int argc, char* argv[]) {
+    gen_opts_t opts = gen_default_opts();
+    opts.max_bytes = DEFAULT_SIZE;
+    const char* out_path = NULL;
+    if (parse_opts(argc, argv, &opts, &out_path) != FORT_OUTCOME_OK) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    FILE* out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            eprintln("error: cannot write %s", out_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    FORT_UNUSED(gen_write(out, &opts));
+
+    if (fclose(out) != 0) {
+        eprintln("error: failed to write %s", out_path != NULL ? out_path : "output");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "gen.h"
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for uint64_t, uint32_t
+#include <stdio.h>    // for fprintf, fputc, fputs, open_memstream, FILE
+#include <stdlib.h>   // for free
+
+#include "common.h"   // for FORT_UNUSED
+
+#define DEFAULT_IDENT_LEN 12
+#define DEFAULT_COMMENT_DENSITY 0.1
+#define DEFAULT_CONST_MAX 1000
+#define DEFAULT_SEED 1
+
+// Function names end in a fixed-width base-36 counter so they never collide.
+#define COUNTER_DIGITS 7
+#define COUNTER_BASE 36
+
+#define COMMENT_LEN_MIN 16
+#define COMMENT_LEN_MAX 80
+
+static const char MAIN[] = "i32 main(void) { return 0; }\n";
+
+static const char IDENT_CHARS[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+gen_opts_t gen_default_opts(void) {
+    return (gen_opts_t){
+        .ident_len = DEFAULT_IDENT_LEN,
+        .comment_density = DEFAULT_COMMENT_DENSITY,
+        .const_max = DEFAULT_CONST_MAX,
+        .seed = DEFAULT_SEED,
+    };
+}
+
+// splitmix64: tiny, fast and good enough to vary the shape of the output.
+static uint64_t next_rand(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+static uint64_t rand_below(uint64_t* state, uint64_t n) {
+    return next_rand(state) % n;
+}
+
+static bool rand_chance(uint64_t* state, double p) {
+    const double unit = 0x1p-53;
+    return (double)(next_rand(state) >> 11) * unit < p;
+}
+
+// Every name starts with 'f' so that none is a keyword or a prefix of one.
+static size_t write_ident(FILE* out, uint64_t* state, size_t ident_len, size_t id) {
+    char name[COUNTER_DIGITS];
+    for (size_t i = COUNTER_DIGITS; i-- > 0;) {
+        name[i] = DIGITS[id % COUNTER_BASE];
+        id /= COUNTER_BASE;
+    }
+
+    FORT_UNUSED(fputc('f', out));
+    for (size_t i = 1 + COUNTER_DIGITS; i < ident_len; ++i) {
+        FORT_UNUSED(fputc(IDENT_CHARS[rand_below(state, sizeof(IDENT_CHARS) - 1)], out));
+    }
+    for (size_t i = 0; i < COUNTER_DIGITS; ++i) {
+        FORT_UNUSED(fputc(name[i], out));
+    }
+
+    return ident_len;
+}
+
+static size_t write_comment(FILE* out, uint64_t* state) {
+    const size_t len = COMMENT_LEN_MIN + rand_below(state, COMMENT_LEN_MAX - COMMENT_LEN_MIN + 1);
+    FORT_UNUSED(fputs("//", out));
+    for (size_t i = 0; i < len; ++i) {
+        // Mostly letters, with spaces to break them into words.
+        const char c = rand_below(state, 6) == 0 ? ' ' : (char)('a' + rand_below(state, 26));
+        FORT_UNUSED(fputc(c, out));
+    }
+    FORT_UNUSED(fputc('\n', out));
+
+    return len + 3;
+}
+
+static size_t write_func(FILE* out, uint64_t* state, const gen_opts_t* opts, size_t id) {
+    size_t len = 0;
+    if (rand_chance(state, opts->comment_density)) {
+        len += write_comment(out, state);
+    }
+
+    const size_t ident_len = opts->ident_len < GEN_IDENT_LEN_MIN ? GEN_IDENT_LEN_MIN : opts->ident_len;
+    const uint64_t val = rand_below(state, (uint64_t)opts->const_max + 1);
+    int n = fprintf(out, "i32 ");
+    len += write_ident(out, state, ident_len, id);
+    // Half the functions are spread over several lines, as people write them.
+    if (rand_below(state, 2) == 0) {
+        n += fprintf(out, "(void) { return %llu; }\n", (unsigned long long)val);
+    } else {
+        n += fprintf(out, "(void) {\n    return %llu;\n}\n", (unsigned long long)val);
+    }
+
+    return len + (size_t)n;
+}
+
+size_t gen_write(FILE* out, const gen_opts_t* opts) {
+    uint64_t state = opts->seed;
+    const size_t main_len = sizeof(MAIN) - 1;
+
+    size_t len = 0;
+    for (size_t id = 0;; ++id) {
+        if (opts->funcs > 0 ? id >= opts->funcs : len + main_len >= opts->max_bytes) {
+            break;
+        }
+        len += write_func(out, &state, opts, id);
+    }
+    FORT_UNUSED(fputs(MAIN, out));
+
+    return len + main_len;
+}
+
+char* gen_src(const gen_opts_t* opts, size_t* len) {
+    char* src = NULL;
+    size_t src_len = 0;
+    FILE* out = open_memstream(&src, &src_len);
+    if (out == NULL) {
+        return NULL;
+    }
+
+    FORT_UNUSED(gen_write(out, opts));
+    if (fclose(out) != 0) {
+        free(src);
+        return NULL;
+    }
+    *len = src_len;
+
+    return src;
+}
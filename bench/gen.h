@@ -0,0 +1,38 @@
+#ifndef FORT_GEN_H
+#define FORT_GEN_H
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+#include <stdio.h>   // for FILE
+
+// Shape of a generated program. The language has one return of a constant
+// per function, so size comes from the number of functions and their
+// spelling rather than from nesting.
+typedef struct {
+    // Functions to write, not counting the final `main`. 0 means "until the
+    // output reaches max_bytes".
+    size_t funcs;
+    size_t max_bytes;
+    // Length of each generated function name, at least GEN_IDENT_LEN_MIN.
+    size_t ident_len;
+    // Chance in [0, 1] that a function is preceded by a comment line.
+    double comment_density;
+    // Largest constant returned; constants are drawn from [0, const_max].
+    uint32_t const_max;
+    uint64_t seed;
+} gen_opts_t;
+
+#define GEN_IDENT_LEN_MIN 8
+
+// Sensible defaults; fill in funcs or max_bytes before use.
+gen_opts_t gen_default_opts(void);
+
+// Writes a valid program to `out` and returns the number of bytes written.
+// The same options always produce the same program. The program ends with
+// `i32 main(void) { return 0; }` so that it can be run as well as compiled.
+size_t gen_write(FILE* out, const gen_opts_t* opts);
+
+// Same as gen_write, into a malloc'd NUL-terminated buffer.
+char* gen_src(const gen_opts_t* opts, size_t* len);
+
+#endif // FORT_GEN_H
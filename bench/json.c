@@ -0,0 +1,241 @@
+#include "json.h"
+
+#include <stdbool.h>  // for bool, false, true
+#include <stddef.h>   // for size_t, NULL
+#include <stdlib.h>   // for free, malloc, realloc, strtod, strtol
+#include <string.h>   // for strcmp, strlen, strncmp
+
+#include "common.h"   // for FORT_OUTCOME_OK, FORT_OUTCOME_ERR, FORT_OUTCOME_NOK_RET
+
+// Deeper nesting than this is not something the benchmarks write.
+#define JSON_DEPTH_MAX 64
+
+typedef struct {
+    const char* p;
+    size_t depth;
+} reader_t;
+
+static void skip_ws(reader_t* r) {
+    while (*r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r') {
+        r->p++;
+    }
+}
+
+static fort_outcome_t parse_value(reader_t* r, json_t* out);
+
+static void value_fini(json_t* json) {
+    for (size_t i = 0; i < json->len; ++i) {
+        value_fini(&json->items[i]);
+        if (json->keys != NULL) {
+            free(json->keys[i]);
+        }
+    }
+    free(json->items);
+    free(json->keys);
+    free(json->str);
+}
+
+// Escapes other than \uXXXX are kept as the escaped character; \uXXXX
+// outside ASCII becomes '?', which is fine for names and numbers.
+static fort_outcome_t parse_str(reader_t* r, char** out) {
+    if (*r->p != '"') {
+        return FORT_OUTCOME_ERR;
+    }
+    r->p++;
+
+    const char* start = r->p;
+    size_t len = 0;
+    while (start[len] != '"') {
+        if (start[len] == '\0') {
+            return FORT_OUTCOME_ERR;
+        }
+        if (start[len] == '\\' && start[len + 1] != '\0') {
+            len++;
+        }
+        len++;
+    }
+
+    char* str = malloc(len + 1);
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        char c = start[i];
+        if (c == '\\') {
+            c = start[++i];
+            switch (c) {
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'u': {
+                const int base = 16;
+                char hex[5] = {0};
+                for (size_t j = 0; j < 4 && i + 1 < len; ++j) {
+                    hex[j] = start[++i];
+                }
+                const long code = strtol(hex, NULL, base);
+                c = code < 0x80 ? (char)code : '?';
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        str[n++] = c;
+    }
+    str[n] = '\0';
+
+    r->p = start + len + 1;
+    *out = str;
+
+    return FORT_OUTCOME_OK;
+}
+
+static void push(json_t* json, size_t* cap) {
+    if (json->len == *cap) {
+        *cap = *cap > 0 ? *cap * 2 : 4;
+        json->items = realloc(json->items, sizeof(json_t) * *cap);
+        if (json->kind == JSON_OBJ) {
+            json->keys = realloc(json->keys, sizeof(char*) * *cap);
+        }
+    }
+    json->items[json->len] = (json_t){0};
+    if (json->kind == JSON_OBJ) {
+        json->keys[json->len] = NULL;
+    }
+    json->len++;
+}
+
+static fort_outcome_t parse_members(reader_t* r, json_t* out, char close) {
+    size_t cap = 0;
+    r->p++;
+    skip_ws(r);
+    if (*r->p == close) {
+        r->p++;
+        return FORT_OUTCOME_OK;
+    }
+
+    for (;;) {
+        push(out, &cap);
+        skip_ws(r);
+        if (out->kind == JSON_OBJ) {
+            FORT_OUTCOME_NOK_RET(parse_str(r, &out->keys[out->len - 1]));
+            skip_ws(r);
+            if (*r->p++ != ':') {
+                return FORT_OUTCOME_ERR;
+            }
+        }
+        FORT_OUTCOME_NOK_RET(parse_value(r, &out->items[out->len - 1]));
+        skip_ws(r);
+        if (*r->p == close) {
+            r->p++;
+            return FORT_OUTCOME_OK;
+        }
+        if (*r->p++ != ',') {
+            return FORT_OUTCOME_ERR;
+        }
+    }
+}
+
+static fort_outcome_t parse_word(reader_t* r, const char* word) {
+    const size_t len = strlen(word);
+    if (strncmp(r->p, word, len) != 0) {
+        return FORT_OUTCOME_ERR;
+    }
+    r->p += len;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_value(reader_t* r, json_t* out) {
+    skip_ws(r);
+    *out = (json_t){0};
+
+    switch (*r->p) {
+    case '{':
+    case '[': {
+        if (++r->depth > JSON_DEPTH_MAX) {
+            return FORT_OUTCOME_ERR;
+        }
+        const char close = *r->p == '{' ? '}' : ']';
+        out->kind = *r->p == '{' ? JSON_OBJ : JSON_ARR;
+        FORT_OUTCOME_NOK_RET(parse_members(r, out, close));
+        r->depth--;
+        return FORT_OUTCOME_OK;
+    }
+    case '"':
+        out->kind = JSON_STR;
+        return parse_str(r, &out->str);
+    case 't':
+        out->kind = JSON_BOOL;
+        out->boolean = true;
+        return parse_word(r, "true");
+    case 'f':
+        out->kind = JSON_BOOL;
+        return parse_word(r, "false");
+    case 'n':
+        return parse_word(r, "null");
+    default: {
+        char* end = NULL;
+        out->kind = JSON_NUM;
+        out->num = strtod(r->p, &end);
+        if (end == r->p) {
+            return FORT_OUTCOME_ERR;
+        }
+        r->p = end;
+        return FORT_OUTCOME_OK;
+    }
+    }
+}
+
+json_t* json_parse(const char* text) {
+    reader_t r = {text, 0};
+    json_t* json = malloc(sizeof(json_t));
+    fort_outcome_t outcome = parse_value(&r, json);
+    skip_ws(&r);
+    if (outcome != FORT_OUTCOME_OK || *r.p != '\0') {
+        json_free(json);
+        return NULL;
+    }
+
+    return json;
+}
+
+void json_free(json_t* json) {
+    if (json == NULL) {
+        return;
+    }
+
+    value_fini(json);
+    free(json);
+}
+
+const json_t* json_get(const json_t* obj, const char* key) {
+    if (obj == NULL || obj->kind != JSON_OBJ) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < obj->len; ++i) {
+        if (obj->keys[i] != NULL && strcmp(obj->keys[i], key) == 0) {
+            return &obj->items[i];
+        }
+    }
+
+    return NULL;
+}
+
+double json_get_num(const json_t* obj, const char* key, double fallback) {
+    const json_t* val = json_get(obj, key);
+
+    return val != NULL && val->kind == JSON_NUM ? val->num : fallback;
+}
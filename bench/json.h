@@ -0,0 +1,40 @@
+#ifndef FORT_JSON_H
+#define FORT_JSON_H
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+
+// Just enough JSON to read back what the benchmarks write.
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUM,
+    JSON_STR,
+    JSON_ARR,
+    JSON_OBJ,
+} json_kind_t;
+
+// Arrays and objects keep their members in `items`; objects also keep the
+// matching keys in `keys`.
+typedef struct json {
+    json_kind_t kind;
+    bool boolean;
+    double num;
+    char* str;
+    struct json* items;
+    char** keys;
+    size_t len;
+} json_t;
+
+// Returns NULL if `text` is not a single well-formed JSON value.
+json_t* json_parse(const char* text);
+
+void json_free(json_t* json);
+
+// The member of an object called `key`, or NULL.
+const json_t* json_get(const json_t* obj, const char* key);
+
+// The number at `key`, or `fallback` if it is missing or not a number.
+double json_get_num(const json_t* obj, const char* key, double fallback);
+
+#endif // FORT_JSON_H
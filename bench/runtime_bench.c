@@ -0,0 +1,412 @@
+#define _DEFAULT_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <dlfcn.h>     // for dlclose, dlerror, dlopen, dlsym, RTLD_NOW
+#include <errno.h>     // for errno
+#include <getopt.h>    // for getopt_long, optarg, optind, option, no_argument, required_argument
+#include <stdbool.h>   // for bool, false, true
+#include <stdint.h>    // for int32_t, uint64_t, UINT64_MAX
+#include <stdio.h>     // for fclose, fopen, fprintf, fread, printf, snprintf, FILE
+#include <stdlib.h>    // for EXIT_FAILURE, EXIT_SUCCESS, free, getenv, malloc, mkdtemp, system
+#include <string.h>    // for memcpy, strerror, strrchr
+#include <sys/mman.h>  // for mmap, mprotect, munmap, MAP_ANONYMOUS, MAP_FAILED, MAP_PRIVATE
+#include <unistd.h>    // for rmdir, sysconf, unlink, _SC_PAGESIZE
+
+#include "assemble.h"  // for asm_prog_t, assembler_run, mkassembler
+#include "bench.h"     // for bench_counters_t, bench_counts_t, mkbench_counters
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_OUTCOME_NOK_RET, FORT_UNUSED, eprintln
+#include "jit.h"       // for jit_prog_t, jit_run, mkjit
+#include "lex.h"       // for tok_stream_t, lexer_run, mklexer
+#include "opt.h"       // for opt_pipeline_t, opt_pipeline_level
+#include "parse.h"     // for prog_t, parser_run, mkparser, prog_fini
+#include "timing.h"    // for timing_now
+
+// Runs the programs in bench/kernels as compiled by fort at -O0, -O1 and -O2
+// and by a C compiler, and compares how long a call to each one's main takes.
+//
+//   runtime_bench [--cc=CC] [--calls=N] [--reps=N] [--counters] KERNEL...
+//
+// fort programs are valid C once `i32` is defined, so each kernel is also
+// built with `CC -O0` and `CC -O2` into a shared object and loaded with
+// dlopen. Every implementation is called through a function pointer, so the
+// numbers compare the generated code and not inlining. Each kernel must give
+// the same result everywhere, which doubles as a check on fort's codegen.
+
+#define DEFAULT_CC "gcc"
+#define DEFAULT_CALLS 1000000
+#define DEFAULT_REPS 10
+#define SRC_MAX (1024 * 1024)
+#define CMD_MAX 4096
+#define PATH_MAX_LEN 1024
+
+// Prepended to each kernel so that a C compiler accepts it. `main` is renamed
+// so that it can live in a shared object.
+static const char C_PRELUDE[] = "#include <stdint.h>\n"
+                                "typedef int32_t i32;\n"
+                                "#define main fort_kernel\n";
+static const char C_ENTRY[] = "fort_kernel";
+
+typedef int32_t (*entry_t)(void);
+
+typedef enum {
+    IMPL_FORT,
+    IMPL_FORT_O1,
+    IMPL_FORT_O2,
+    IMPL_CC_O0,
+    IMPL_CC_O2,
+    IMPL_COUNT,
+} impl_t;
+
+static const char* const IMPL_NAMES[] = {
+    [IMPL_FORT] = "fort",
+    [IMPL_FORT_O1] = "fort -O1",
+    [IMPL_FORT_O2] = "fort -O2",
+    [IMPL_CC_O0] = "cc -O0",
+    [IMPL_CC_O2] = "cc -O2",
+};
+
+static const unsigned IMPL_LEVELS[] = {
+    [IMPL_FORT] = 0,
+    [IMPL_FORT_O1] = 1,
+    [IMPL_FORT_O2] = 2,
+};
+
+static const char* const IMPL_FLAGS[] = {
+    [IMPL_CC_O0] = "-O0",
+    [IMPL_CC_O2] = "-O2",
+};
+
+typedef struct {
+    const char* cc;
+    size_t calls;
+    size_t reps;
+    bool counters;
+} bench_opts_t;
+
+typedef struct {
+    double ns_per_call;
+    bench_counts_t counts;
+    int32_t ret;
+} result_t;
+
+// fort's entry point, copied into executable memory as jit_exec does.
+typedef struct {
+    void* mem;
+    size_t map_sz;
+    entry_t entry;
+} code_t;
+
+static char* read_file(const char* path, size_t* len) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    char* src = malloc(SRC_MAX + 1);
+    *len = fread(src, 1, SRC_MAX, file);
+    FORT_UNUSED(fclose(file));
+    src[*len] = '\0';
+
+    return src;
+}
+
+static fort_outcome_t map_code(const jit_func_t* func, code_t* code) {
+    const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+    code->map_sz = (func->len + page_sz - 1) / page_sz * page_sz;
+    code->mem = mmap(NULL, code->map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code->mem == MAP_FAILED) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    memcpy(code->mem, func->code, func->len);
+    if (mprotect(code->mem, code->map_sz, PROT_READ | PROT_EXEC) < 0) {
+        FORT_UNUSED(munmap(code->mem, code->map_sz));
+        return FORT_OUTCOME_ERR;
+    }
+    memcpy(&code->entry, &code->mem, sizeof(code->entry));
+
+    return FORT_OUTCOME_OK;
+}
+
+// Runs the whole pipeline on `src` at -O`level` and maps the entry point.
+static fort_outcome_t compile_fort(const char* src, size_t len, unsigned level, code_t* code) {
+    tok_stream_t toks = {0};
+    lexer_t* lexer = mklexer(src, len);
+    fort_outcome_t outcome = lexer_run(lexer, &toks);
+    lexer_fini(lexer);
+
+    prog_t prog = {0};
+    if (outcome == FORT_OUTCOME_OK) {
+        parser_t* parser = mkparser(&toks);
+        outcome = parser_run(parser, &prog);
+        parser_fini(parser);
+    }
+
+    asm_prog_t asm_prog = {0};
+    opt_pipeline_t pipeline = {0};
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = opt_pipeline_level(level, &pipeline);
+    }
+    if (outcome == FORT_OUTCOME_OK) {
+        assembler_t* assembler = mkassembler(&prog);
+        assembler_set_opt(assembler, &pipeline, NULL);
+        outcome = assembler_run(assembler, &asm_prog);
+        assembler_fini(assembler);
+    }
+
+    jit_prog_t jit_prog = {0};
+    if (outcome == FORT_OUTCOME_OK) {
+        jit_t* jit = mkjit(&asm_prog);
+        outcome = jit_run(jit, &jit_prog);
+        jit_fini(jit);
+    }
+
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = map_code(&jit_prog.func, code);
+    }
+
+    jit_prog_fini(&jit_prog);
+    asm_prog_fini(&asm_prog);
+    prog_fini(&prog);
+    tok_stream_fini(&toks);
+
+    return outcome;
+}
+
+// Builds `src` with the C compiler into `dir` and loads it.
+static fort_outcome_t compile_cc(const bench_opts_t* opts,
+                                 impl_t impl,
+                                 const char* dir,
+                                 const char* src,
+                                 void** handle,
+                                 entry_t* entry) {
+    char c_path[PATH_MAX_LEN];
+    char so_path[PATH_MAX_LEN];
+    const int c_len = snprintf(c_path, sizeof(c_path), "%s/kernel.c", dir);
+    const int so_len = snprintf(so_path, sizeof(so_path), "%s/kernel%s.so", dir, IMPL_FLAGS[impl]);
+    if (c_len < 0 || (size_t)c_len >= sizeof(c_path) || so_len < 0 ||
+        (size_t)so_len >= sizeof(so_path)) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    FILE* out = fopen(c_path, "w");
+    if (out == NULL) {
+        return FORT_OUTCOME_ERR;
+    }
+    FORT_UNUSED(fprintf(out, "%s%s", C_PRELUDE, src));
+    if (fclose(out) != 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    char cmd[CMD_MAX];
+    FORT_UNUSED(snprintf(cmd, sizeof(cmd), "%s %s -shared -fPIC -o %s %s", opts->cc,
+                         IMPL_FLAGS[impl], so_path, c_path));
+    const int status = system(cmd);
+    FORT_UNUSED(unlink(c_path));
+    if (status != 0) {
+        eprintln("error: `%s` failed", cmd);
+        return FORT_OUTCOME_ERR;
+    }
+
+    *handle = dlopen(so_path, RTLD_NOW);
+    FORT_UNUSED(unlink(so_path));
+    if (*handle == NULL) {
+        eprintln("error: %s", dlerror());
+        return FORT_OUTCOME_ERR;
+    }
+
+    void* sym = dlsym(*handle, C_ENTRY);
+    if (sym == NULL) {
+        eprintln("error: kernel has no main");
+        FORT_UNUSED(dlclose(*handle));
+        return FORT_OUTCOME_ERR;
+    }
+    memcpy(entry, &sym, sizeof(*entry));
+
+    return FORT_OUTCOME_OK;
+}
+
+// Calls `entry` `calls` times per repetition and keeps the fastest repetition.
+static void measure(const bench_opts_t* opts,
+                    bench_counters_t* counters,
+                    entry_t entry,
+                    result_t* result) {
+    *result = (result_t){0};
+    result->ret = entry();
+
+    uint64_t best_ns = UINT64_MAX;
+    for (size_t r = 0; r < opts->reps; ++r) {
+        // Storing every result keeps the calls from being dropped.
+        volatile int32_t sink = 0;
+        if (counters != NULL) {
+            bench_counters_start(counters);
+        }
+        const uint64_t start = timing_now();
+        for (size_t i = 0; i < opts->calls; ++i) {
+            sink = entry();
+        }
+        const uint64_t ns = timing_now() - start;
+        if (counters != NULL) {
+            bench_counters_stop(counters, &result->counts);
+        }
+        FORT_UNUSED(sink);
+        best_ns = ns < best_ns ? ns : best_ns;
+    }
+    result->ns_per_call = (double)best_ns / (double)opts->calls;
+}
+
+// Instructions per call over every timed call, or a negative value if they
+// could not be counted.
+static double insts_per_call(const bench_opts_t* opts, const result_t* r) {
+    const double calls = (double)opts->calls * (double)r->counts.runs;
+    return r->counts.valid[BENCH_EVENT_INSTRUCTIONS] && calls > 0
+               ? (double)r->counts.vals[BENCH_EVENT_INSTRUCTIONS] / calls
+               : -1;
+}
+
+static const char* kernel_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+static fort_outcome_t bench_kernel(const bench_opts_t* opts,
+                                   bench_counters_t* counters,
+                                   const char* dir,
+                                   const char* path) {
+    size_t len = 0;
+    char* src = read_file(path, &len);
+    if (src == NULL) {
+        eprintln("error: cannot read %s: %s", path, strerror(errno));
+        return FORT_OUTCOME_ERR;
+    }
+
+    result_t results[IMPL_COUNT];
+    fort_outcome_t outcome = FORT_OUTCOME_OK;
+    for (size_t i = IMPL_FORT; i < IMPL_CC_O0; ++i) {
+        code_t code = {0};
+        outcome = compile_fort(src, len, IMPL_LEVELS[i], &code);
+        if (outcome != FORT_OUTCOME_OK) {
+            eprintln("error: %s failed to compile %s", IMPL_NAMES[i], path);
+            free(src);
+            return outcome;
+        }
+        measure(opts, counters, code.entry, &results[i]);
+        FORT_UNUSED(munmap(code.mem, code.map_sz));
+    }
+
+    for (size_t i = IMPL_CC_O0; i < IMPL_COUNT && outcome == FORT_OUTCOME_OK; ++i) {
+        void* handle = NULL;
+        entry_t entry = NULL;
+        outcome = compile_cc(opts, (impl_t)i, dir, src, &handle, &entry);
+        if (outcome == FORT_OUTCOME_OK) {
+            measure(opts, counters, entry, &results[i]);
+            FORT_UNUSED(dlclose(handle));
+        }
+    }
+    free(src);
+    FORT_OUTCOME_NOK_RET(outcome);
+
+    const result_t* fort = &results[IMPL_FORT];
+    for (size_t i = 0; i < IMPL_COUNT; ++i) {
+        const result_t* r = &results[i];
+        FORT_UNUSED(printf("%-16s %-8s %10.3f", kernel_name(path), IMPL_NAMES[i], r->ns_per_call));
+        const double insts = insts_per_call(opts, r);
+        if (insts < 0) {
+            FORT_UNUSED(printf(" %10s", "-"));
+        } else {
+            FORT_UNUSED(printf(" %10.2f", insts));
+        }
+        // How many times faster fort's code is than this implementation's.
+        FORT_UNUSED(printf(" %9.2fx\n", fort->ns_per_call > 0 ? r->ns_per_call / fort->ns_per_call : 0));
+
+        if (r->ret != fort->ret) {
+            eprintln("error: %s returns %d with %s but %d with fort", kernel_name(path), r->ret,
+                     IMPL_NAMES[i], fort->ret);
+            outcome = FORT_OUTCOME_ERR;
+        }
+    }
+
+    return outcome;
+}
+
+static fort_outcome_t parse_count(const char* arg, size_t* count) {
+    const int base = 10;
+    char* end = NULL;
+    errno = 0;
+    const unsigned long val = strtoul(arg, &end, base);
+    if (errno != 0 || end == arg || *end != '\0' || val == 0) {
+        return FORT_OUTCOME_ERR;
+    }
+    *count = (size_t)val;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_opts(int argc, char* argv[], bench_opts_t* opts) {
+    enum { OPT_CC = 1, OPT_CALLS, OPT_REPS, OPT_COUNTERS };
+    static const struct option long_opts[] = {{"cc", required_argument, NULL, OPT_CC},
+                                              {"calls", required_argument, NULL, OPT_CALLS},
+                                              {"reps", required_argument, NULL, OPT_REPS},
+                                              {"counters", no_argument, NULL, OPT_COUNTERS},
+                                              {NULL, 0, NULL, 0}};
+    int opt = -1;
+    while ((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case OPT_CC:
+            opts->cc = optarg;
+            break;
+        case OPT_CALLS:
+            FORT_OUTCOME_NOK_RET(parse_count(optarg, &opts->calls));
+            break;
+        case OPT_REPS:
+            FORT_OUTCOME_NOK_RET(parse_count(optarg, &opts->reps));
+            break;
+        case OPT_COUNTERS:
+            opts->counters = true;
+            break;
+        default:
+            return FORT_OUTCOME_ERR;
+        }
+    }
+
+    return optind < argc ? FORT_OUTCOME_OK : FORT_OUTCOME_ERR;
+}
+
+int main(int argc, char* argv[]) {
+    bench_opts_t opts = {.cc = DEFAULT_CC, .calls = DEFAULT_CALLS, .reps = DEFAULT_REPS};
+    if (parse_opts(argc, argv, &opts) != FORT_OUTCOME_OK) {
+        eprintln("usage: runtime_bench [--cc=CC] [--calls=N] [--reps=N] [--counters] KERNEL...");
+        return EXIT_FAILURE;
+    }
+
+    bench_counters_t* counters = NULL;
+    if (opts.counters) {
+        counters = mkbench_counters();
+        if (counters == NULL) {
+            eprintln("warning: hardware counters unavailable: %s", strerror(errno));
+        }
+    }
+
+    const char* tmp = getenv("TMPDIR");
+    char dir[PATH_MAX_LEN];
+    FORT_UNUSED(snprintf(dir, sizeof(dir), "%s/fort-runtime-XXXXXX", tmp != NULL ? tmp : "/tmp"));
+    if (mkdtemp(dir) == NULL) {
+        eprintln("error: cannot create a temporary directory: %s", strerror(errno));
+        bench_counters_fini(counters);
+        return EXIT_FAILURE;
+    }
+
+    FORT_UNUSED(printf("cc=%s calls=%zu reps=%zu\n", opts.cc, opts.calls, opts.reps));
+    FORT_UNUSED(printf("%-16s %-8s %10s %10s %10s\n", "kernel", "impl", "ns/call", "insts/call",
+                       "fort gain"));
+
+    int exit_code = EXIT_SUCCESS;
+    for (int i = optind; i < argc; ++i) {
+        if (bench_kernel(&opts, counters, dir, argv[i]) != FORT_OUTCOME_OK) {
+            exit_code = EXIT_FAILURE;
+        }
+    }
+
+    FORT_UNUSED(rmdir(dir));
+    bench_counters_fini(counters);
+
+    return exit_code;
+}
@@ -0,0 +1,509 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <errno.h>     // for errno, EINVAL, ENOENT
+#include <getopt.h>    // for getopt_long, optarg, option, no_argument, required_argument
+#include <stdbool.h>   // for bool, false, true
+#include <stdio.h>     // for fclose, fopen, fprintf, fputs, fread, fseek, printf, snprintf
+#include <stdlib.h>    // for EXIT_FAILURE, EXIT_SUCCESS, free, malloc, strtoul
+#include <string.h>    // for memcmp, strerror
+
+#include "arena.h"     // for arena_t, arena_fini, arena_reset, mkarena
+#include "assemble.h"  // for asm_prog_t, assembler_run, mkassembler
+#include "bench.h"     // for bench_summary_t, bench_summarize, bench_counters_t
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_UNUSED, eprintln
+#include "gen.h"       // for gen_opts_t, gen_default_opts, gen_src
+#include "lex.h"       // for tok_stream_t, lexer_run, mklexer
+#include "parse.h"     // for prog_t, parser_run, mkparser, prog_fini
+#include "timing.h"    // for timing_now
+
+// Times lexer_run, parser_run and assembler_run on generated programs of
+// growing size and reports nanoseconds per source token and source MB/s.
+//
+//   stage_bench [--sizes=N,N,...] [--warmup=N] [--reps=N] [--counters] [--json=FILE]
+//               [--append]
+//
+// Each stage runs `warmup` untimed times and then `reps` timed ones on the
+// same input; the JSON output is meant to be kept and compared across commits.
+// The repetitions of one process share its CPU frequency, placement and
+// neighbours, so they say little about how much a later process will differ.
+// The JSON file therefore holds a list of runs, and --append adds this
+// process's run to the ones already in FILE; bench_check compares runs, not
+// repetitions.
+// --counters also reads hardware counters over the timed runs and reports IPC
+// and events per token, where the machine allows it.
+
+#define DEFAULT_WARMUP 3
+#define DEFAULT_REPS 25
+#define SIZES_MAX 16
+#define ARENA_CHUNK_SZ (64 * 1024)
+#define BYTES_PER_MB 1e6
+#define NS_PER_SEC 1e9
+
+static const size_t DEFAULT_SIZES[] = {100, 1000, 10000, 100000};
+
+typedef enum {
+    BENCH_LEX,
+    BENCH_PARSE,
+    BENCH_CODEGEN,
+    BENCH_STAGE_COUNT,
+} bench_stage_t;
+
+static const char* const STAGE_NAMES[] = {
+    [BENCH_LEX] = "lex",
+    [BENCH_PARSE] = "parse",
+    [BENCH_CODEGEN] = "codegen",
+};
+
+typedef struct {
+    size_t sizes[SIZES_MAX];
+    size_t nsizes;
+    size_t warmup;
+    size_t reps;
+    bool counters;
+    const char* json_path;
+    bool append;
+} bench_opts_t;
+
+typedef struct {
+    bench_stage_t stage;
+    size_t funcs;
+    size_t tokens;
+    size_t bytes;
+    bench_summary_t ns_per_token;
+    double mb_per_sec;
+    bench_counts_t counts;
+    // Every timed run in ns per token, for statistical comparisons.
+    double* samples;
+    size_t nsamples;
+} result_t;
+
+// Everything one size needs: the source, and the output of each stage so the
+// next one can be timed on its own.
+typedef struct {
+    char* src;
+    size_t len;
+    arena_t* arena;
+    tok_stream_t toks;
+    prog_t prog;
+} input_t;
+
+// Measures the code between meter_start and meter_stop: always its time, and
+// its hardware events when `counters` is set.
+typedef struct {
+    bench_counters_t* counters;
+    bench_counts_t* counts;
+    uint64_t start;
+} meter_t;
+
+static void meter_start(meter_t* meter) {
+    if (meter->counters != NULL) {
+        bench_counters_start(meter->counters);
+    }
+    meter->start = timing_now();
+}
+
+static uint64_t meter_stop(meter_t* meter) {
+    const uint64_t ns = timing_now() - meter->start;
+    if (meter->counters != NULL) {
+        bench_counters_stop(meter->counters, meter->counts);
+    }
+
+    return ns;
+}
+
+// Runs `stage` once and returns how long it took.
+static fort_outcome_t run_stage(bench_stage_t stage, input_t* in, meter_t* meter, uint64_t* ns) {
+    fort_outcome_t outcome = FORT_OUTCOME_FATAL;
+
+    switch (stage) {
+    case BENCH_LEX: {
+        tok_stream_t toks = {.arena = in->arena};
+        lexer_t* lexer = mklexer(in->src, in->len);
+        meter_start(meter);
+        outcome = lexer_run(lexer, &toks);
+        *ns = meter_stop(meter);
+        lexer_fini(lexer);
+        arena_reset(in->arena);
+        break;
+    }
+    case BENCH_PARSE: {
+        prog_t prog = {0};
+        in->toks.next = in->toks.head.next;
+        parser_t* parser = mkparser(&in->toks);
+        meter_start(meter);
+        outcome = parser_run(parser, &prog);
+        *ns = meter_stop(meter);
+        parser_fini(parser);
+        prog_fini(&prog);
+        break;
+    }
+    case BENCH_CODEGEN: {
+        arena_t* arenas[] = {in->arena};
+        asm_prog_t asm_prog = {.arenas = arenas};
+        assembler_t* assembler = mkassembler(&in->prog);
+        meter_start(meter);
+        outcome = assembler_run(assembler, &asm_prog);
+        *ns = meter_stop(meter);
+        assembler_fini(assembler);
+        arena_reset(in->arena);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return outcome;
+}
+
+static fort_outcome_t bench_stage(const bench_opts_t* opts,
+                                  bench_counters_t* counters,
+                                  bench_stage_t stage,
+                                  input_t* in,
+                                  result_t* result) {
+    uint64_t ns = 0;
+    meter_t warmup = {0};
+    for (size_t i = 0; i < opts->warmup; ++i) {
+        FORT_OUTCOME_NOK_RET(run_stage(stage, in, &warmup, &ns));
+    }
+
+    result->counts = (bench_counts_t){0};
+    meter_t meter = {.counters = counters, .counts = &result->counts};
+    double* samples = malloc(sizeof(double) * opts->reps);
+    for (size_t i = 0; i < opts->reps; ++i) {
+        const fort_outcome_t outcome = run_stage(stage, in, &meter, &ns);
+        if (outcome != FORT_OUTCOME_OK) {
+            free(samples);
+            return outcome;
+        }
+        samples[i] = (double)ns / (double)in->toks.ntoks;
+    }
+
+    result->stage = stage;
+    result->tokens = in->toks.ntoks;
+    result->bytes = in->len;
+    bench_summarize(samples, opts->reps, &result->ns_per_token);
+    // Throughput from the median, so that one slow repetition does not skew it.
+    const double median_ns = result->ns_per_token.median * (double)in->toks.ntoks;
+    result->mb_per_sec = median_ns > 0 ? (double)in->len / BYTES_PER_MB * NS_PER_SEC / median_ns : 0;
+    result->samples = samples;
+    result->nsamples = opts->reps;
+
+    return FORT_OUTCOME_OK;
+}
+
+// Lexes and parses the input once up front so that the later stages have
+// something to work on.
+static fort_outcome_t mkinput(size_t nfuncs, input_t* in) {
+    *in = (input_t){0};
+    gen_opts_t gen_opts = gen_default_opts();
+    gen_opts.funcs = nfuncs;
+    in->src = gen_src(&gen_opts, &in->len);
+    if (in->src == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+    in->arena = mkarena(ARENA_CHUNK_SZ);
+
+    lexer_t* lexer = mklexer(in->src, in->len);
+    fort_outcome_t outcome = lexer_run(lexer, &in->toks);
+    lexer_fini(lexer);
+    FORT_OUTCOME_NOK_RET(outcome);
+
+    parser_t* parser = mkparser(&in->toks);
+    outcome = parser_run(parser, &in->prog);
+    parser_fini(parser);
+
+    return outcome;
+}
+
+static void input_fini(input_t* in) {
+    prog_fini(&in->prog);
+    tok_stream_fini(&in->toks);
+    arena_fini(in->arena);
+    free(in->src);
+}
+
+static void print_result(const result_t* r) {
+    FORT_UNUSED(printf("%-8s %8zu %9zu %10zu %9.2f %9.2f %9.2f %9.2f %9.1f\n",
+                       STAGE_NAMES[r->stage], r->funcs, r->tokens, r->bytes, r->ns_per_token.min,
+                       r->ns_per_token.median, r->ns_per_token.p90, r->ns_per_token.p99,
+                       r->mb_per_sec));
+}
+
+// Events per token over all timed runs, or a negative value if the event
+// could not be counted.
+static double per_token(const result_t* r, bench_event_t event) {
+    const double tokens = (double)r->tokens * (double)r->counts.runs;
+    return r->counts.valid[event] && tokens > 0 ? (double)r->counts.vals[event] / tokens : -1;
+}
+
+static double ipc(const result_t* r) {
+    const bench_counts_t* c = &r->counts;
+    if (!c->valid[BENCH_EVENT_CYCLES] || !c->valid[BENCH_EVENT_INSTRUCTIONS] ||
+        c->vals[BENCH_EVENT_CYCLES] == 0) {
+        return -1;
+    }
+
+    return (double)c->vals[BENCH_EVENT_INSTRUCTIONS] / (double)c->vals[BENCH_EVENT_CYCLES];
+}
+
+static void print_metric(double val) {
+    if (val < 0) {
+        FORT_UNUSED(printf(" %13s", "-"));
+    } else {
+        FORT_UNUSED(printf(" %13.3f", val));
+    }
+}
+
+static void print_counters(const result_t* results, size_t n) {
+    FORT_UNUSED(printf("\n%-8s %8s %13s", "stage", "funcs", "ipc"));
+    for (size_t e = 0; e < BENCH_EVENT_COUNT; ++e) {
+        FORT_UNUSED(printf(" %13s", bench_event_name((bench_event_t)e)));
+    }
+    FORT_UNUSED(printf("\n%-8s %8s %13s %69s\n", "", "", "", "(per token)"));
+
+    for (size_t i = 0; i < n; ++i) {
+        const result_t* r = &results[i];
+        FORT_UNUSED(printf("%-8s %8zu", STAGE_NAMES[r->stage], r->funcs));
+        print_metric(ipc(r));
+        for (size_t e = 0; e < BENCH_EVENT_COUNT; ++e) {
+            print_metric(per_token(r, (bench_event_t)e));
+        }
+        FORT_UNUSED(printf("\n"));
+    }
+}
+
+static void write_json_metric(FILE* out, const char* key, double val) {
+    if (val < 0) {
+        FORT_UNUSED(fprintf(out, "\"%s\":null", key));
+    } else {
+        FORT_UNUSED(fprintf(out, "\"%s\":%.4f", key, val));
+    }
+}
+
+static void write_json_counters(FILE* out, const result_t* r) {
+    FORT_UNUSED(fprintf(out, ",\"counters\":{"));
+    write_json_metric(out, "ipc", ipc(r));
+    for (size_t e = 0; e < BENCH_EVENT_COUNT; ++e) {
+        char key[64];
+        FORT_UNUSED(snprintf(key, sizeof(key), "%s_per_token", bench_event_name((bench_event_t)e)));
+        FORT_UNUSED(fprintf(out, ","));
+        write_json_metric(out, key, per_token(r, (bench_event_t)e));
+    }
+    FORT_UNUSED(fprintf(out, "}"));
+}
+
+static void write_json(FILE* out,
+                       const bench_opts_t* opts,
+                       bool counters,
+                       const result_t* results,
+                       size_t n) {
+    FORT_UNUSED(fprintf(out, "{\"warmup\":%zu,\"reps\":%zu,\"results\":[", opts->warmup, opts->reps));
+    for (size_t i = 0; i < n; ++i) {
+        const result_t* r = &results[i];
+        FORT_UNUSED(fprintf(out,
+                            "%s\n{\"stage\":\"%s\",\"funcs\":%zu,\"tokens\":%zu,\"bytes\":%zu,"
+                            "\"ns_per_token\":{\"min\":%.3f,\"median\":%.3f,\"p90\":%.3f,"
+                            "\"p99\":%.3f,\"max\":%.3f},\"mb_per_sec\":%.3f",
+                            i > 0 ? "," : "", STAGE_NAMES[r->stage], r->funcs, r->tokens, r->bytes,
+                            r->ns_per_token.min, r->ns_per_token.median, r->ns_per_token.p90,
+                            r->ns_per_token.p99, r->ns_per_token.max, r->mb_per_sec));
+        FORT_UNUSED(fprintf(out, ",\"samples\":["));
+        for (size_t j = 0; j < r->nsamples; ++j) {
+            FORT_UNUSED(fprintf(out, "%s%.3f", j > 0 ? "," : "", r->samples[j]));
+        }
+        FORT_UNUSED(fprintf(out, "]"));
+        if (counters) {
+            write_json_counters(out, r);
+        }
+        FORT_UNUSED(fprintf(out, "}"));
+    }
+    FORT_UNUSED(fprintf(out, "\n]}"));
+}
+
+// Every JSON file ends with this, so that the next run can go before it.
+static const char RUNS_END[] = "\n]}\n";
+#define RUNS_END_LEN (sizeof(RUNS_END) - 1)
+
+// Opens `path` for the next run: at the end of its list of runs with
+// `append`, or as a new file.
+static FILE* open_runs(const char* path, bool append) {
+    FILE* out = append ? fopen(path, "r+") : NULL;
+    if (out == NULL) {
+        if (append && errno != ENOENT) {
+            return NULL;
+        }
+        out = fopen(path, "w");
+        if (out != NULL) {
+            FORT_UNUSED(fprintf(out, "{\"runs\":[\n"));
+        }
+        return out;
+    }
+
+    char end[RUNS_END_LEN];
+    const long back = -(long)RUNS_END_LEN;
+    if (fseek(out, back, SEEK_END) != 0 || fread(end, 1, RUNS_END_LEN, out) != RUNS_END_LEN ||
+        memcmp(end, RUNS_END, RUNS_END_LEN) != 0 || fseek(out, back, SEEK_END) != 0) {
+        FORT_UNUSED(fclose(out));
+        errno = EINVAL;
+        return NULL;
+    }
+    FORT_UNUSED(fprintf(out, ",\n"));
+
+    return out;
+}
+
+// Parses a count of at least `min` and leaves `end` just past it.
+static fort_outcome_t parse_count(const char* arg, size_t min, size_t* val, char** end) {
+    const int base = 10;
+    errno = 0;
+    const unsigned long n = strtoul(arg, end, base);
+    if (errno != 0 || *end == arg || n < min) {
+        return FORT_OUTCOME_ERR;
+    }
+    *val = n;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_sizes(const char* arg, bench_opts_t* opts) {
+    opts->nsizes = 0;
+    for (;;) {
+        char* end = NULL;
+        if (opts->nsizes == SIZES_MAX) {
+            return FORT_OUTCOME_ERR;
+        }
+        FORT_OUTCOME_NOK_RET(parse_count(arg, 1, &opts->sizes[opts->nsizes++], &end));
+        if (*end == '\0') {
+            return FORT_OUTCOME_OK;
+        }
+        if (*end != ',') {
+            return FORT_OUTCOME_ERR;
+        }
+        arg = end + 1;
+    }
+}
+
+static fort_outcome_t parse_opts(int argc, char* argv[], bench_opts_t* opts) {
+    enum { OPT_SIZES = 1, OPT_WARMUP, OPT_REPS, OPT_COUNTERS, OPT_JSON, OPT_APPEND };
+    static const struct option long_opts[] = {{"sizes", required_argument, NULL, OPT_SIZES},
+                                              {"warmup", required_argument, NULL, OPT_WARMUP},
+                                              {"reps", required_argument, NULL, OPT_REPS},
+                                              {"counters", no_argument, NULL, OPT_COUNTERS},
+                                              {"json", required_argument, NULL, OPT_JSON},
+                                              {"append", no_argument, NULL, OPT_APPEND},
+                                              {NULL, 0, NULL, 0}};
+    int opt = -1;
+    char* end = NULL;
+    while ((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case OPT_SIZES:
+            FORT_OUTCOME_NOK_RET(parse_sizes(optarg, opts));
+            break;
+        case OPT_WARMUP:
+            FORT_OUTCOME_NOK_RET(parse_count(optarg, 0, &opts->warmup, &end));
+            if (*end != '\0') {
+                return FORT_OUTCOME_ERR;
+            }
+            break;
+        case OPT_REPS:
+            FORT_OUTCOME_NOK_RET(parse_count(optarg, 1, &opts->reps, &end));
+            if (*end != '\0') {
+                return FORT_OUTCOME_ERR;
+            }
+            break;
+        case OPT_COUNTERS:
+            opts->counters = true;
+            break;
+        case OPT_JSON:
+            opts->json_path = optarg;
+            break;
+        case OPT_APPEND:
+            opts->append = true;
+            break;
+        default:
+            return FORT_OUTCOME_ERR;
+        }
+    }
+
+    if (opts->append && opts->json_path == NULL) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    return optind == argc ? FORT_OUTCOME_OK : FORT_OUTCOME_ERR;
+}
+
+int main(int argc, char* argv[]) {
+    bench_opts_t opts = {.warmup = DEFAULT_WARMUP, .reps = DEFAULT_REPS};
+    for (size_t i = 0; i < NELEM(DEFAULT_SIZES); ++i) {
+        opts.sizes[opts.nsizes++] = DEFAULT_SIZES[i];
+    }
+    if (parse_opts(argc, argv, &opts) != FORT_OUTCOME_OK) {
+        eprintln("usage: stage_bench [--sizes=N,N,...] [--warmup=N] [--reps=N] [--counters] "
+                 "[--json=FILE] [--append]");
+        return EXIT_FAILURE;
+    }
+
+    bench_counters_t* counters = NULL;
+    if (opts.counters) {
+        counters = mkbench_counters();
+        if (counters == NULL) {
+            eprintln("warning: hardware counters unavailable: %s", strerror(errno));
+        }
+    }
+
+    const size_t nresults = opts.nsizes * BENCH_STAGE_COUNT;
+    result_t* results = malloc(sizeof(result_t) * nresults);
+    size_t n = 0;
+
+    FORT_UNUSED(printf("warmup=%zu reps=%zu\n", opts.warmup, opts.reps));
+    FORT_UNUSED(printf("%-8s %8s %9s %10s %9s %9s %9s %9s %9s\n", "stage", "funcs", "tokens",
+                       "bytes", "min", "median", "p90", "p99", "MB/s"));
+    FORT_UNUSED(printf("%-8s %8s %9s %10s %39s\n", "", "", "", "", "(ns per token)"));
+
+    int exit_code = EXIT_SUCCESS;
+    for (size_t i = 0; i < opts.nsizes && exit_code == EXIT_SUCCESS; ++i) {
+        input_t in;
+        if (mkinput(opts.sizes[i], &in) != FORT_OUTCOME_OK) {
+            eprintln("error: failed to parse generated source");
+            exit_code = EXIT_FAILURE;
+        }
+        for (size_t s = 0; s < BENCH_STAGE_COUNT && exit_code == EXIT_SUCCESS; ++s) {
+            result_t* result = &results[n];
+            if (bench_stage(&opts, counters, (bench_stage_t)s, &in, result) != FORT_OUTCOME_OK) {
+                eprintln("error: %s failed on %zu functions", STAGE_NAMES[s], opts.sizes[i]);
+                exit_code = EXIT_FAILURE;
+                break;
+            }
+            result->funcs = opts.sizes[i];
+            print_result(result);
+            n++;
+        }
+        input_fini(&in);
+    }
+
+    if (counters != NULL) {
+        print_counters(results, n);
+    }
+
+    if (exit_code == EXIT_SUCCESS && opts.json_path != NULL) {
+        FILE* out = open_runs(opts.json_path, opts.append);
+        if (out == NULL) {
+            eprintln("error: cannot write %s: %s", opts.json_path, strerror(errno));
+            exit_code = EXIT_FAILURE;
+        } else {
+            write_json(out, &opts, counters != NULL, results, n);
+            FORT_UNUSED(fputs(RUNS_END, out));
+            if (fclose(out) != 0) {
+                eprintln("error: failed to write %s", opts.json_path);
+                exit_code = EXIT_FAILURE;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        free(results[i].samples);
+    }
+    free(results);
+    bench_counters_fini(counters);
+
+    return exit_code;
+}
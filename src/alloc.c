@@ -0,0 +1,174 @@
+#include "alloc.h"
+
+#include <stdalign.h>  // for alignas
+#include <stdatomic.h> // for atomic_size_t, atomic_fetch_add_explicit, memory_order_relaxed
+#include <stddef.h>    // for max_align_t, size_t, NULL
+#include <stdio.h>     // for fprintf, FILE
+#include <stdlib.h>    // for free, malloc
+
+#include "arena.h"     // for arena_alloc, arena_t
+#include "common.h"    // for FORT_UNUSED
+
+#define CACHE_LINE_SZ 64
+
+// Each stage gets its own cache line so that workers lexing and lowering in
+// parallel do not contend on the counters.
+typedef struct {
+    alignas(CACHE_LINE_SZ) atomic_size_t count;
+    atomic_size_t bytes;
+    atomic_size_t live;
+    atomic_size_t peak;
+} counters_t;
+
+// Sits in front of every fort_alloc block so that fort_free knows what to
+// give back; the union keeps the block itself maximally aligned.
+typedef union {
+    struct {
+        size_t sz;
+        alloc_stage_t stage;
+    } h;
+    max_align_t align;
+} header_t;
+
+static counters_t COUNTERS[ALLOC_STAGE_COUNT];
+
+// Only the calls that reached malloc, whatever stage they were charged to.
+static counters_t HEAP;
+
+const char* alloc_stage_name(alloc_stage_t stage) {
+    switch (stage) {
+    case ALLOC_LOAD:
+        return "load_src";
+    case ALLOC_LEX:
+        return "lex";
+    case ALLOC_PARSE:
+        return "parse";
+    case ALLOC_CODEGEN:
+        return "codegen";
+    case ALLOC_EMIT:
+        return "emit";
+    case ALLOC_DRIVER:
+        return "driver";
+    case ALLOC_ARENA:
+        return "arena";
+    default:
+        return "unknown";
+    }
+}
+
+static void count(alloc_stage_t stage, size_t sz) {
+    counters_t* c = &COUNTERS[stage];
+    FORT_UNUSED(atomic_fetch_add_explicit(&c->count, 1, memory_order_relaxed));
+    FORT_UNUSED(atomic_fetch_add_explicit(&c->bytes, sz, memory_order_relaxed));
+}
+
+void* fort_alloc(alloc_stage_t stage, size_t sz) {
+    header_t* header = malloc(sizeof(header_t) + sz);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->h.sz = sz;
+    header->h.stage = stage;
+
+    count(stage, sz);
+    FORT_UNUSED(atomic_fetch_add_explicit(&HEAP.count, 1, memory_order_relaxed));
+    FORT_UNUSED(atomic_fetch_add_explicit(&HEAP.bytes, sz, memory_order_relaxed));
+    counters_t* c = &COUNTERS[stage];
+    const size_t live = atomic_fetch_add_explicit(&c->live, sz, memory_order_relaxed) + sz;
+    size_t peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+    while (peak < live && !atomic_compare_exchange_weak_explicit(&c->peak, &peak, live,
+                                                                  memory_order_relaxed,
+                                                                  memory_order_relaxed)) {
+    }
+
+    return header + 1;
+}
+
+void fort_free(void* p) {
+    if (p == NULL) {
+        return;
+    }
+
+    header_t* header = (header_t*)p - 1;
+    FORT_UNUSED(atomic_fetch_sub_explicit(&COUNTERS[header->h.stage].live, header->h.sz,
+                                          memory_order_relaxed));
+    free(header);
+}
+
+void* fort_alloc_from(arena_t* arena, alloc_stage_t stage, size_t sz) {
+    if (arena == NULL) {
+        return fort_alloc(stage, sz);
+    }
+
+    count(stage, sz);
+    return arena_alloc(arena, sz);
+}
+
+void alloc_stats(alloc_stats_t* stats) {
+    for (size_t i = 0; i < ALLOC_STAGE_COUNT; ++i) {
+        counters_t* c = &COUNTERS[i];
+        stats->stage[i] = (alloc_counts_t){
+            .count = atomic_load_explicit(&c->count, memory_order_relaxed),
+            .bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed),
+            .peak = atomic_load_explicit(&c->peak, memory_order_relaxed),
+        };
+    }
+}
+
+void alloc_heap(size_t* count, size_t* bytes) {
+    *count = atomic_load_explicit(&HEAP.count, memory_order_relaxed);
+    *bytes = atomic_load_explicit(&HEAP.bytes, memory_order_relaxed);
+}
+
+void alloc_reset_peak(void) {
+    for (size_t i = 0; i < ALLOC_STAGE_COUNT; ++i) {
+        counters_t* c = &COUNTERS[i];
+        atomic_store_explicit(&c->peak, atomic_load_explicit(&c->live, memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+}
+
+static alloc_counts_t since(const alloc_stats_t* before, const alloc_stats_t* after, size_t i) {
+    return (alloc_counts_t){
+        .count = after->stage[i].count - before->stage[i].count,
+        .bytes = after->stage[i].bytes - before->stage[i].bytes,
+        // The peak never drops below what alloc_reset_peak started it at.
+        .peak = after->stage[i].peak - before->stage[i].peak,
+    };
+}
+
+static double per_unit(size_t bytes, size_t units) {
+    return units > 0 ? (double)bytes / (double)units : 0;
+}
+
+void alloc_print(FILE* out, const alloc_stats_t* before, const alloc_stats_t* after, size_t tokens,
+                 size_t nodes) {
+    FORT_UNUSED(fprintf(out, "memory report: %zu tokens, %zu AST nodes\n", tokens, nodes));
+    FORT_UNUSED(fprintf(out, "%-10s %12s %14s %14s %12s %12s\n", "stage", "allocs", "bytes",
+                        "peak_bytes", "bytes/token", "bytes/node"));
+
+    // No total: requests served from an arena would be counted twice, once
+    // for their stage and again in the arena's chunks.
+    for (size_t i = 0; i < ALLOC_STAGE_COUNT; ++i) {
+        const alloc_counts_t counts = since(before, after, i);
+        FORT_UNUSED(fprintf(out, "%-10s %12zu %14zu %14zu %12.1f %12.1f\n",
+                            alloc_stage_name((alloc_stage_t)i), counts.count, counts.bytes,
+                            counts.peak, per_unit(counts.bytes, tokens),
+                            per_unit(counts.bytes, nodes)));
+    }
+}
+
+void alloc_print_json(FILE* out, const alloc_stats_t* before, const alloc_stats_t* after,
+                      size_t tokens, size_t nodes) {
+    FORT_UNUSED(fprintf(out, "{\"tokens\":%zu,\"nodes\":%zu,\"stages\":[", tokens, nodes));
+    for (size_t i = 0; i < ALLOC_STAGE_COUNT; ++i) {
+        const alloc_counts_t counts = since(before, after, i);
+        FORT_UNUSED(fprintf(out,
+                            "%s{\"name\":\"%s\",\"allocs\":%zu,\"bytes\":%zu,\"peak_bytes\":%zu,"
+                            "\"bytes_per_token\":%.1f,\"bytes_per_node\":%.1f}",
+                            i > 0 ? "," : "", alloc_stage_name((alloc_stage_t)i), counts.count,
+                            counts.bytes, counts.peak, per_unit(counts.bytes, tokens),
+                            per_unit(counts.bytes, nodes)));
+    }
+    FORT_UNUSED(fprintf(out, "]}\n"));
+}
@@ -0,0 +1,68 @@
+#ifndef FORT_ALLOC_H
+#define FORT_ALLOC_H
+
+#include <stddef.h>  // for size_t
+#include <stdio.h>   // for FILE
+
+#include "arena.h"   // for arena_t
+
+// The compiler stage an allocation is charged to.
+typedef enum {
+    ALLOC_LOAD,
+    ALLOC_LEX,
+    ALLOC_PARSE,
+    ALLOC_CODEGEN,
+    ALLOC_EMIT,
+    // What outlives a single file: worker threads, caches, traces, batches
+    // and server requests.
+    ALLOC_DRIVER,
+    ALLOC_ARENA,
+    ALLOC_STAGE_COUNT,
+} alloc_stage_t;
+
+// What a stage asked for: `count` allocations totalling `bytes`, and the most
+// heap memory it held at once. Allocations served from an arena count towards
+// `count` and `bytes` only; the chunks behind them are charged to ALLOC_ARENA.
+typedef struct {
+    size_t count;
+    size_t bytes;
+    size_t peak;
+} alloc_counts_t;
+
+typedef struct {
+    alloc_counts_t stage[ALLOC_STAGE_COUNT];
+} alloc_stats_t;
+
+const char* alloc_stage_name(alloc_stage_t stage);
+
+// malloc and free that keep per-stage counters. Memory from fort_alloc must be
+// released with fort_free and nothing else.
+void* fort_alloc(alloc_stage_t stage, size_t sz);
+
+void fort_free(void* p);
+
+// Allocates from `arena`, or from the heap with fort_alloc when it is NULL.
+void* fort_alloc_from(arena_t* arena, alloc_stage_t stage, size_t sz);
+
+// The counters are process-wide and only ever grow, except that
+// alloc_reset_peak restarts each peak from what is currently live, so the
+// peak of a single compilation can be measured.
+void alloc_stats(alloc_stats_t* stats);
+
+// Heap allocations made through fort_alloc so far, over all stages. Unlike
+// the per-stage counts these leave out requests an arena served.
+void alloc_heap(size_t* count, size_t* bytes);
+
+void alloc_reset_peak(void);
+
+// Prints the counts accumulated since `before` alongside bytes per token and
+// per AST node. Take `before` right after alloc_reset_peak: each peak is then
+// reported as how far the stage rose above what it already held, so memory
+// that was live before the batch does not count towards it.
+void alloc_print(FILE* out, const alloc_stats_t* before, const alloc_stats_t* after, size_t tokens,
+                 size_t nodes);
+
+void alloc_print_json(FILE* out, const alloc_stats_t* before, const alloc_stats_t* after,
+                      size_t tokens, size_t nodes);
+
+#endif // FORT_ALLOC_H
@@ -0,0 +1,91 @@
+#include "arena.h"
+
+#include <stdalign.h>  // for alignof
+#include <stddef.h>    // for max_align_t, size_t, NULL
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_ARENA
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+typedef struct chunk {
+    struct chunk* next;
+    size_t cap;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+} chunk_t;
+
+struct arena {
+    chunk_t* head;
+    chunk_t* cur;
+    size_t chunk_sz;
+};
+
+static chunk_t* mkchunk(size_t cap) {
+    chunk_t* chunk = fort_alloc(ALLOC_ARENA, sizeof(chunk_t) + cap);
+    chunk->next = NULL;
+    chunk->cap = cap;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+arena_t* mkarena(size_t chunk_sz) {
+    arena_t* arena = fort_alloc(ALLOC_ARENA, sizeof(arena_t));
+    arena->head = NULL;
+    arena->cur = NULL;
+    arena->chunk_sz = chunk_sz;
+
+    return arena;
+}
+
+void arena_fini(arena_t* arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    chunk_t* chunk = arena->head;
+    while (chunk != NULL) {
+        chunk_t* next = chunk->next;
+        fort_free(chunk);
+        chunk = next;
+    }
+    fort_free(arena);
+}
+
+void* arena_alloc(arena_t* arena, size_t sz) {
+    sz = (sz + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    // Walk forward through chunks kept from before the last reset. Oversized
+    // requests get a chunk of their own, linked in after the current one.
+    chunk_t* chunk = arena->cur;
+    while (chunk != NULL && chunk->cap - chunk->used < sz) {
+        chunk = chunk->next;
+        if (chunk != NULL) {
+            chunk->used = 0;
+        }
+    }
+
+    if (chunk == NULL) {
+        chunk = mkchunk(sz > arena->chunk_sz ? sz : arena->chunk_sz);
+        if (arena->cur == NULL) {
+            chunk->next = arena->head;
+            arena->head = chunk;
+        } else {
+            chunk->next = arena->cur->next;
+            arena->cur->next = chunk;
+        }
+    }
+
+    arena->cur = chunk;
+    void* p = chunk->data + chunk->used;
+    chunk->used += sz;
+
+    return p;
+}
+
+void arena_reset(arena_t* arena) {
+    arena->cur = arena->head;
+    if (arena->cur != NULL) {
+        arena->cur->used = 0;
+    }
+}
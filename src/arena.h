@@ -0,0 +1,19 @@
+#ifndef FORT_ARENA_H
+#define FORT_ARENA_H
+
+#include <stddef.h>  // for size_t
+
+// Bump allocator. Individual allocations are never freed; arena_reset
+// releases them all at once but keeps the chunks, so an arena that is reset
+// between compilations stops allocating once it has grown to the working set.
+typedef struct arena arena_t;
+
+arena_t* mkarena(size_t chunk_sz);
+
+void arena_fini(arena_t* arena);
+
+void* arena_alloc(arena_t* arena, size_t sz);
+
+void arena_reset(arena_t* arena);
+
+#endif // FORT_ARENA_H
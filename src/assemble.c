@@ -1,12 +1,20 @@
 #include "assemble.h"
 
-#include <stdlib.h>
+#include <stddef.h>
 
+#include "alloc.h"
+#include "arena.h"
 #include "common.h"
+#include "opt.h"
 #include "parse.h"
+#include "pool.h"
+#include "trace.h"
 
 struct assembler {
     prog_t* prog;
+    pool_t* pool;
+    const opt_pipeline_t* pipeline;
+    opt_stats_t* opt_stats;
 };
 
 static fort_outcome_t convert_expression(expr_t* expr, op_t* op) {
@@ -22,18 +30,18 @@ static fort_outcome_t convert_expression(expr_t* expr, op_t* op) {
     }
 }
 
-static inline fort_outcome_t gen_inst(stmt_t* body, inst_t** inst) {
+static inline fort_outcome_t gen_inst(stmt_t* body, arena_t* arena, inst_t** inst) {
     switch (body->kind) {
     case STMT_RET: {
         op_t imm = {0};
         fort_outcome_t outcome = convert_expression(&body->u.ret.expr, &imm);
         FORT_OUTCOME_NOK_RET(outcome);
-        inst_t* inst_mov = malloc(sizeof(inst_t));
+        inst_t* inst_mov = fort_alloc_from(arena, ALLOC_CODEGEN, sizeof(inst_t));
         inst_mov->u.mov.src = imm;
         inst_mov->u.mov.dst = (op_t){{{REG_EAX}}, OP_REG};
         inst_mov->kind = INST_MOV;
 
-        inst_t* inst_ret = malloc(sizeof(inst_t));
+        inst_t* inst_ret = fort_alloc_from(arena, ALLOC_CODEGEN, sizeof(inst_t));
         inst_ret->kind = INST_RET;
         inst_ret->next = NULL;
         inst_mov->next = inst_ret;
@@ -46,7 +54,12 @@ static inline fort_outcome_t gen_inst(stmt_t* body, inst_t** inst) {
         return FORT_OUTCOME_FATAL;
     }
 }
-static fort_outcome_t gen_func(func_t* func, asm_func_t* asm_func) {
+
+static fort_outcome_t gen_func(const assembler_t* assembler,
+                               func_t* func,
+                               arena_t* arena,
+                               opt_stats_t* opt_stats,
+                               asm_func_t* asm_func) {
 
     fort_outcome_t outcome = FORT_OUTCOME_FATAL;
 
@@ -54,36 +67,149 @@ static fort_outcome_t gen_func(func_t* func, asm_func_t* asm_func) {
         return FORT_OUTCOME_FATAL;
     }
 
+    const uint64_t start = trace_begin();
     asm_func->name = func->name;
+    asm_func->inst = NULL;
+    asm_func->next = NULL;
 
-    outcome = gen_inst(&func->body, &asm_func->inst);
+    outcome = gen_inst(&func->body, arena, &asm_func->inst);
+    if (outcome == FORT_OUTCOME_OK && assembler->pipeline != NULL) {
+        opt_run(assembler->pipeline, asm_func, arena, opt_stats);
+    }
+    trace_end(func->name, "func", start);
     FORT_OUTCOME_NOK_RET(outcome);
 
     return FORT_OUTCOME_OK;
 }
 
-static fort_outcome_t gen_prog(prog_t* prog, asm_prog_t* asm_prog) {
+static fort_outcome_t gen_prog(const assembler_t* assembler, asm_prog_t* asm_prog) {
     fort_outcome_t outcome = FORT_OUTCOME_FATAL;
 
     if (asm_prog == NULL) {
         return FORT_OUTCOME_FATAL;
     }
 
-    outcome = gen_func(&prog->func, &asm_prog->func);
+    prog_t* prog = assembler->prog;
+    arena_t* arena = asm_prog->arenas != NULL ? asm_prog->arenas[0] : NULL;
+
+    outcome = gen_func(assembler, &prog->func, arena, assembler->opt_stats, &asm_prog->func);
     FORT_OUTCOME_NOK_RET(outcome);
 
+    asm_func_t* tail = &asm_prog->func;
+    for (func_t* func = prog->func.next; func != NULL; func = func->next) {
+        asm_func_t* asm_func = fort_alloc_from(arena, ALLOC_CODEGEN, sizeof(asm_func_t));
+        outcome = gen_func(assembler, func, arena, assembler->opt_stats, asm_func);
+        tail->next = asm_func;
+        tail = asm_func;
+        FORT_OUTCOME_NOK_RET(outcome);
+    }
+
     return FORT_OUTCOME_OK;
 }
 
+// One job per function. Each job writes only its own slot, and the slots are
+// linked in source order afterwards, so the result does not depend on which
+// worker ran which job or when. Pass statistics are kept per worker and
+// summed at the end.
+typedef struct {
+    const assembler_t* assembler;
+    func_t** funcs;
+    asm_func_t** asm_funcs;
+    fort_outcome_t* outcomes;
+    opt_stats_t* opt_stats;
+    asm_prog_t* asm_prog;
+} gen_batch_t;
+
+static void gen_func_job(void* ctx, size_t job, size_t worker) {
+    gen_batch_t* batch = ctx;
+    asm_prog_t* asm_prog = batch->asm_prog;
+    arena_t* arena = asm_prog->arenas != NULL ? asm_prog->arenas[worker] : NULL;
+
+    asm_func_t* asm_func =
+        job == 0 ? &asm_prog->func : fort_alloc_from(arena, ALLOC_CODEGEN, sizeof(asm_func_t));
+    batch->outcomes[job] =
+        gen_func(batch->assembler, batch->funcs[job], arena, &batch->opt_stats[worker], asm_func);
+    batch->asm_funcs[job] = asm_func;
+}
+
+static fort_outcome_t gen_prog_parallel(const assembler_t* assembler, asm_prog_t* asm_prog) {
+    prog_t* prog = assembler->prog;
+    pool_t* pool = assembler->pool;
+    const size_t nworkers = pool_nworkers(pool);
+    size_t nfuncs = 0;
+    for (func_t* func = &prog->func; func != NULL; func = func->next) {
+        nfuncs++;
+    }
+
+    gen_batch_t batch = {
+        .assembler = assembler,
+        .funcs = fort_alloc(ALLOC_CODEGEN, sizeof(func_t*) * nfuncs),
+        .asm_funcs = fort_alloc(ALLOC_CODEGEN, sizeof(asm_func_t*) * nfuncs),
+        .outcomes = fort_alloc(ALLOC_CODEGEN, sizeof(fort_outcome_t) * nfuncs),
+        .opt_stats = fort_alloc(ALLOC_CODEGEN, sizeof(opt_stats_t) * nworkers),
+        .asm_prog = asm_prog,
+    };
+    for (size_t w = 0; w < nworkers; ++w) {
+        batch.opt_stats[w] = (opt_stats_t){0};
+    }
+
+    size_t i = 0;
+    for (func_t* func = &prog->func; func != NULL; func = func->next) {
+        batch.funcs[i++] = func;
+    }
+
+    fort_outcome_t outcome = pool_run(pool, nfuncs, gen_func_job, &batch);
+
+    // pool_run only fails before any job has run, leaving nothing to link.
+    // Otherwise link every function, failed ones included, so that
+    // asm_prog_fini releases all of it; report the first failure in source
+    // order.
+    if (outcome == FORT_OUTCOME_OK) {
+        for (size_t j = 0; j + 1 < nfuncs; ++j) {
+            batch.asm_funcs[j]->next = batch.asm_funcs[j + 1];
+        }
+    }
+    for (size_t j = 0; j < nfuncs && outcome == FORT_OUTCOME_OK; ++j) {
+        outcome = batch.outcomes[j];
+    }
+
+    if (assembler->opt_stats != NULL) {
+        for (size_t w = 0; w < nworkers; ++w) {
+            opt_stats_merge(assembler->opt_stats, &batch.opt_stats[w]);
+        }
+    }
+
+    fort_free(batch.opt_stats);
+    fort_free(batch.outcomes);
+    fort_free(batch.asm_funcs);
+    fort_free(batch.funcs);
+
+    return outcome;
+}
+
 assembler_t* mkassembler(prog_t* prog) {
-    assembler_t* assembler = malloc(sizeof(assembler_t));
+    assembler_t* assembler = fort_alloc(ALLOC_CODEGEN, sizeof(assembler_t));
     assembler->prog = prog;
+    assembler->pool = NULL;
+    assembler->pipeline = NULL;
+    assembler->opt_stats = NULL;
 
     return assembler;
 }
 
 void assembler_fini(assembler_t* assembler) {
-    free(assembler);
+    fort_free(assembler);
+}
+
+void assembler_set_pool(assembler_t* assembler, pool_t* pool) {
+    assembler->pool = pool;
+}
+
+void assembler_set_opt(assembler_t* assembler,
+                       const opt_pipeline_t* pipeline,
+                       opt_stats_t* stats) {
+    assembler->pipeline = pipeline;
+    assembler->opt_stats = stats;
 }
 
 fort_outcome_t assembler_run(assembler_t* assembler, asm_prog_t* asm_prog) {
@@ -97,17 +223,37 @@ fort_outcome_t assembler_run(assembler_t* assembler, asm_prog_t* asm_prog) {
         return FORT_OUTCOME_FATAL;
     }
 
-    outcome = gen_prog(assembler->prog, asm_prog);
+    if (assembler->pool != NULL && pool_nworkers(assembler->pool) > 1 &&
+        assembler->prog->func.next != NULL) {
+        outcome = gen_prog_parallel(assembler, asm_prog);
+    } else {
+        outcome = gen_prog(assembler, asm_prog);
+    }
     FORT_OUTCOME_NOK_RET(outcome);
 
     return FORT_OUTCOME_OK;
 }
 
-void asm_prog_fini(asm_prog_t* asm_prog) {
-    inst_t* inst = asm_prog->func.inst;
+static void free_insts(inst_t* inst) {
     while (inst != NULL) {
         inst_t* next = inst->next;
-        free(inst);
+        fort_free(inst);
         inst = next;
     }
 }
+
+void asm_prog_fini(asm_prog_t* asm_prog) {
+    if (asm_prog->arenas != NULL) {
+        return;
+    }
+
+    free_insts(asm_prog->func.inst);
+
+    asm_func_t* asm_func = asm_prog->func.next;
+    while (asm_func != NULL) {
+        asm_func_t* next = asm_func->next;
+        free_insts(asm_func->inst);
+        fort_free(asm_func);
+        asm_func = next;
+    }
+}
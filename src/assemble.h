@@ -3,11 +3,17 @@
 
 #include <stdint.h>
 
+#include "arena.h"
 #include "common.h"
 #include "parse.h"
+#include "pool.h"
 
 typedef struct assembler assembler_t;
 
+// Defined in opt.h, which builds on the types below.
+typedef struct opt_pipeline opt_pipeline_t;
+typedef struct opt_stats opt_stats_t;
+
 typedef enum {
     REG_EAX,
 } reg_t;
@@ -30,6 +36,8 @@ typedef struct {
 typedef enum {
     INST_MOV,
     INST_RET,
+    INST_XOR,
+    INST_KIND_COUNT,
 } inst_kind_t;
 
 typedef struct inst {
@@ -38,24 +46,47 @@ typedef struct inst {
             op_t src;
             op_t dst;
         } mov;
+        // dst ^= src. Clobbers the flags, which nothing reads yet.
+        struct {
+            op_t src;
+            op_t dst;
+        } xor;
     } u;
     inst_kind_t kind;
     struct inst* next;
 } inst_t;
 
-typedef struct {
+typedef struct asm_func {
     buf_t name;
     inst_t* inst;
+    struct asm_func* next;
 } asm_func_t;
 
+// Functions in the same order as in the source, the first one inline.
+// Instructions and the remaining functions are malloc'd one by one unless
+// `arenas` is set, in which case they are carved out of the arena of the
+// worker that lowered them and live until the arenas are reset. With a pool,
+// `arenas` must hold one arena per pool worker.
 typedef struct {
     asm_func_t func;
+    arena_t** arenas;
 } asm_prog_t;
 
 assembler_t* mkassembler(prog_t* prog);
 
 void assembler_fini(assembler_t* assembler);
 
+// Lowers functions concurrently on `pool` when the program has more than one.
+// The result is identical to the serial one. The pool must not be running
+// the job that calls assembler_run.
+void assembler_set_pool(assembler_t* assembler, pool_t* pool);
+
+// Runs `pipeline` on each function right after lowering it, on the same
+// worker. What the passes did is added to `stats`, which may be NULL.
+void assembler_set_opt(assembler_t* assembler,
+                       const opt_pipeline_t* pipeline,
+                       opt_stats_t* stats);
+
 fort_outcome_t assembler_run(assembler_t* assembler, asm_prog_t* asm_prog);
 
 void asm_prog_fini(asm_prog_t* asm_prog);
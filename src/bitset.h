@@ -0,0 +1,86 @@
+#ifndef FORT_BITSET_H
+#define FORT_BITSET_H
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for uint64_t
+
+// Dense bit sets stored as arrays of 64-bit words. The caller owns the words
+// and passes their count; sets combined with one another must have the same
+// count. The loops are plain and restrict-qualified so that the compiler can
+// turn them into vector instructions.
+typedef uint64_t bitset_word_t;
+
+#define BITSET_WORD_BITS 64
+
+static inline size_t bitset_words(size_t nbits) {
+    return (nbits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+static inline void bitset_set(bitset_word_t* set, size_t bit) {
+    set[bit / BITSET_WORD_BITS] |= (bitset_word_t)1 << (bit % BITSET_WORD_BITS);
+}
+
+static inline void bitset_clear(bitset_word_t* set, size_t bit) {
+    set[bit / BITSET_WORD_BITS] &= ~((bitset_word_t)1 << (bit % BITSET_WORD_BITS));
+}
+
+static inline bool bitset_test(const bitset_word_t* set, size_t bit) {
+    return ((set[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1) != 0;
+}
+
+static inline void bitset_zero(bitset_word_t* set, size_t nwords) {
+    for (size_t i = 0; i < nwords; ++i) {
+        set[i] = 0;
+    }
+}
+
+static inline void bitset_copy(bitset_word_t* restrict dst,
+                               const bitset_word_t* restrict src,
+                               size_t nwords) {
+    for (size_t i = 0; i < nwords; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+// dst |= src. Returns whether dst changed.
+static inline bool bitset_union(bitset_word_t* restrict dst,
+                                const bitset_word_t* restrict src,
+                                size_t nwords) {
+    bitset_word_t changed = 0;
+    for (size_t i = 0; i < nwords; ++i) {
+        const bitset_word_t word = dst[i] | src[i];
+        changed |= word ^ dst[i];
+        dst[i] = word;
+    }
+
+    return changed != 0;
+}
+
+// dst = gen | (src & ~kill), the transfer function of most dataflow
+// problems. Returns whether dst changed.
+static inline bool bitset_transfer(bitset_word_t* restrict dst,
+                                   const bitset_word_t* restrict gen,
+                                   const bitset_word_t* restrict src,
+                                   const bitset_word_t* restrict kill,
+                                   size_t nwords) {
+    bitset_word_t changed = 0;
+    for (size_t i = 0; i < nwords; ++i) {
+        const bitset_word_t word = gen[i] | (src[i] & ~kill[i]);
+        changed |= word ^ dst[i];
+        dst[i] = word;
+    }
+
+    return changed != 0;
+}
+
+static inline size_t bitset_count(const bitset_word_t* set, size_t nwords) {
+    size_t n = 0;
+    for (size_t i = 0; i < nwords; ++i) {
+        n += (size_t)__builtin_popcountll(set[i]);
+    }
+
+    return n;
+}
+
+#endif // FORT_BITSET_H
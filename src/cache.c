@@ -0,0 +1,262 @@
+#define _XOPEN_SOURCE 500 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "cache.h"
+
+#include <errno.h>      // for errno, EEXIST
+#include <fcntl.h>      // for open, O_RDONLY
+#include <stdatomic.h>  // for atomic_fetch_add, atomic_load, atomic_init
+#include <stdint.h>     // for uint64_t, uint32_t, uint8_t
+#include <stdio.h>      // for snprintf, rename
+#include <stdlib.h>     // for mkstemp
+#include <string.h>     // for memcpy, memcmp, strlen
+#include <unistd.h>     // for close, read, write, unlink, ssize_t
+#include <sys/stat.h>   // for mkdir, fstat, stat
+
+#include "alloc.h"      // for fort_alloc, fort_free, ALLOC_DRIVER, ALLOC_EMIT
+#include "build_id.h"   // for FORT_BUILD_ID
+#include "common.h"     // for buf_t, FORT_OUTCOME_OK, FORT_OUTCOME_ERR, FORT_UNUSED
+#include "jit.h"        // for jit_prog_t, jit_func_t
+
+#ifndef FORT_VERSION
+#error "FORT_VERSION must be defined by the build"
+#endif
+
+#ifndef FORT_BUILD_ID
+#error "FORT_BUILD_ID must be generated by the build"
+#endif
+
+#define CACHE_PATH_MAX 4096
+#define CACHE_MAGIC "FORTJIT1"
+#define CACHE_MAGIC_LEN 8
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// Shared by all batch workers, hence the atomic counters.
+struct cache {
+    char* dir;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+};
+
+// On-disk entry: header, then the function name, then the code bytes.
+typedef struct {
+    char magic[CACHE_MAGIC_LEN];
+    uint64_t key;
+    uint32_t name_len;
+    uint32_t code_len;
+} cache_entry_header_t;
+
+static uint64_t fnv1a(uint64_t hash, const void* p, size_t len) {
+    const uint8_t* bytes = p;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint64_t cache_key(buf_t src, buf_t opts) {
+    // Lengths are mixed in so that moving bytes between fields changes the key.
+    // The build id changes with any compiler source, which the version does
+    // not, so entries from an older fort in a shared cache are never served.
+    const char* version = FORT_VERSION;
+    const size_t version_len = strlen(version);
+    const char* build_id = FORT_BUILD_ID;
+    const size_t build_id_len = strlen(build_id);
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = fnv1a(hash, &version_len, sizeof(version_len));
+    hash = fnv1a(hash, version, version_len);
+    hash = fnv1a(hash, &build_id_len, sizeof(build_id_len));
+    hash = fnv1a(hash, build_id, build_id_len);
+    hash = fnv1a(hash, &opts.len, sizeof(opts.len));
+    hash = fnv1a(hash, opts.p, opts.len);
+    hash = fnv1a(hash, &src.len, sizeof(src.len));
+    hash = fnv1a(hash, src.p, src.len);
+
+    return hash;
+}
+
+static fort_outcome_t entry_path(const cache_t* cache, uint64_t key, char* path, size_t len) {
+    const int path_len =
+        snprintf(path, len, "%s/%016llx.fjit", cache->dir, (unsigned long long)key);
+    if (path_len < 0 || (size_t)path_len >= len) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+cache_t* mkcache(const char* dir) {
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (stat(dir, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        return NULL;
+    }
+
+    const size_t dir_len = strlen(dir);
+    cache_t* cache = fort_alloc(ALLOC_DRIVER, sizeof(cache_t));
+    cache->dir = fort_alloc(ALLOC_DRIVER, dir_len + 1);
+    memcpy(cache->dir, dir, dir_len + 1);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+
+    return cache;
+}
+
+void cache_fini(cache_t* cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    fort_free(cache->dir);
+    fort_free(cache);
+}
+
+static fort_outcome_t read_all(int fd, void* p, size_t len) {
+    char* bytes = p;
+    while (len > 0) {
+        ssize_t nbytes = read(fd, bytes, len);
+        if (nbytes <= 0) {
+            return FORT_OUTCOME_ERR;
+        }
+        bytes += nbytes;
+        len -= (size_t)nbytes;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t write_all(int fd, const void* p, size_t len) {
+    const char* bytes = p;
+    while (len > 0) {
+        ssize_t nbytes = write(fd, bytes, len);
+        if (nbytes < 0) {
+            return FORT_OUTCOME_ERR;
+        }
+        bytes += nbytes;
+        len -= (size_t)nbytes;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t read_entry(int fd, uint64_t key, jit_prog_t* jit_prog) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    cache_entry_header_t header;
+    FORT_OUTCOME_NOK_RET(read_all(fd, &header, sizeof(header)));
+
+    if (memcmp(header.magic, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0 || header.key != key) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    const size_t payload_len = (size_t)header.name_len + header.code_len;
+    if ((size_t)st.st_size != sizeof(header) + payload_len || header.code_len == 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    // Same layout jit_run produces: code, then the NUL-terminated name.
+    uint8_t* code = fort_alloc(ALLOC_EMIT, payload_len + 1);
+    char* name = (char*)code + header.code_len;
+    if (read_all(fd, name, header.name_len) != FORT_OUTCOME_OK ||
+        read_all(fd, code, header.code_len) != FORT_OUTCOME_OK) {
+        fort_free(code);
+        return FORT_OUTCOME_ERR;
+    }
+    name[header.name_len] = '\0';
+
+    jit_prog->func = (jit_func_t){{name, header.name_len}, code, header.code_len};
+
+    return FORT_OUTCOME_OK;
+}
+
+fort_outcome_t cache_lookup(cache_t* cache, uint64_t key, jit_prog_t* jit_prog) {
+    if (cache == NULL || jit_prog == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    char path[CACHE_PATH_MAX];
+    // A path too long to build cannot name an entry, so it is a miss.
+    fort_outcome_t outcome = entry_path(cache, key, path, sizeof(path));
+    if (outcome == FORT_OUTCOME_OK) {
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+            outcome = read_entry(fd, key, jit_prog);
+            FORT_UNUSED(close(fd));
+        } else {
+            outcome = FORT_OUTCOME_ERR;
+        }
+    }
+
+    if (outcome == FORT_OUTCOME_OK) {
+        FORT_UNUSED(atomic_fetch_add(&cache->hits, 1));
+    } else {
+        FORT_UNUSED(atomic_fetch_add(&cache->misses, 1));
+    }
+
+    return outcome;
+}
+
+fort_outcome_t cache_store(cache_t* cache, uint64_t key, const jit_prog_t* jit_prog) {
+    if (cache == NULL || jit_prog == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    const jit_func_t* func = &jit_prog->func;
+    cache_entry_header_t header = {
+        .key = key,
+        .name_len = (uint32_t)func->name.len,
+        .code_len = (uint32_t)func->len,
+    };
+    memcpy(header.magic, CACHE_MAGIC, CACHE_MAGIC_LEN);
+
+    char path[CACHE_PATH_MAX];
+    if (entry_path(cache, key, path, sizeof(path)) != FORT_OUTCOME_OK) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    // Readers must never observe a partially written entry, and concurrent
+    // writers of the same key produce identical bytes, so write a private temp
+    // file and rename it into place; the last rename wins.
+    char tmp_path[CACHE_PATH_MAX];
+    const int tmp_len = snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+    if (tmp_len < 0 || (size_t)tmp_len >= sizeof(tmp_path)) {
+        return FORT_OUTCOME_ERR;
+    }
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    fort_outcome_t outcome = write_all(fd, &header, sizeof(header));
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = write_all(fd, func->name.p, func->name.len);
+    }
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = write_all(fd, func->code, func->len);
+    }
+    if (close(fd) < 0) {
+        outcome = FORT_OUTCOME_ERR;
+    }
+    if (outcome == FORT_OUTCOME_OK && rename(tmp_path, path) < 0) {
+        outcome = FORT_OUTCOME_ERR;
+    }
+    if (outcome != FORT_OUTCOME_OK) {
+        FORT_UNUSED(unlink(tmp_path));
+    }
+
+    return outcome;
+}
+
+void cache_stats(const cache_t* cache, cache_stats_t* stats) {
+    stats->hits = atomic_load(&cache->hits);
+    stats->misses = atomic_load(&cache->misses);
+}
@@ -0,0 +1,33 @@
+#ifndef FORT_CACHE_H
+#define FORT_CACHE_H
+
+#include <stdint.h>  // for uint64_t
+
+#include "common.h"  // for buf_t, fort_outcome_t
+#include "jit.h"     // for jit_prog_t
+
+typedef struct cache cache_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+} cache_stats_t;
+
+// Hash of everything the generated code depends on: the compiler version and
+// a hash of its sources, the code-affecting options and the source bytes.
+uint64_t cache_key(buf_t src, buf_t opts);
+
+// Returns NULL if `dir` does not exist and cannot be created.
+cache_t* mkcache(const char* dir);
+
+void cache_fini(cache_t* cache);
+
+// FORT_OUTCOME_OK on a hit, FORT_OUTCOME_ERR on a miss. Unreadable or
+// corrupt entries count as misses.
+fort_outcome_t cache_lookup(cache_t* cache, uint64_t key, jit_prog_t* jit_prog);
+
+fort_outcome_t cache_store(cache_t* cache, uint64_t key, const jit_prog_t* jit_prog);
+
+void cache_stats(const cache_t* cache, cache_stats_t* stats);
+
+#endif // FORT_CACHE_H
@@ -0,0 +1,232 @@
+#include "cfg.h"
+
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for size_t, NULL
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for asm_func_t, inst_t, INST_RET
+
+static bool is_terminator(const inst_t* inst) {
+    return inst->kind == INST_RET;
+}
+
+static void* alloc_array(size_t n, size_t sz) {
+    // Zero-length arrays still get a distinct pointer so fini stays uniform.
+    return fort_alloc(ALLOC_CODEGEN, (n > 0 ? n : 1) * sz);
+}
+
+// A terminator closes its block, and the next instruction, if any, opens
+// another.
+static size_t count_blocks(const asm_func_t* func) {
+    if (func->inst == NULL) {
+        return 0;
+    }
+
+    size_t n = 1;
+    for (const inst_t* inst = func->inst; inst != NULL; inst = inst->next) {
+        if (is_terminator(inst) && inst->next != NULL) {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+static void split_blocks(const asm_func_t* func, cfg_t* cfg) {
+    size_t b = 0;
+    for (inst_t* inst = func->inst; inst != NULL; inst = inst->next) {
+        block_t* block = &cfg->blocks[b];
+        if (block->first == NULL) {
+            block->first = inst;
+        }
+        block->last = inst;
+        block->ninsts++;
+        if (is_terminator(inst) && inst->next != NULL) {
+            b++;
+        }
+    }
+
+    // Falling through is the only edge until there are jumps.
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        block_t* block = &cfg->blocks[i];
+        if (!is_terminator(block->last) && i + 1 < cfg->nblocks) {
+            block->succs[block->nsuccs++] = i + 1;
+        }
+    }
+}
+
+static void link_preds(cfg_t* cfg) {
+    size_t nedges = 0;
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        const block_t* block = &cfg->blocks[i];
+        for (size_t s = 0; s < block->nsuccs; ++s) {
+            cfg->blocks[block->succs[s]].npreds++;
+        }
+        nedges += block->nsuccs;
+    }
+
+    size_t start = 0;
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        block_t* block = &cfg->blocks[i];
+        block->pred_start = start;
+        start += block->npreds;
+        block->npreds = 0;
+    }
+
+    cfg->preds = alloc_array(nedges, sizeof(size_t));
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        const block_t* block = &cfg->blocks[i];
+        for (size_t s = 0; s < block->nsuccs; ++s) {
+            block_t* succ = &cfg->blocks[block->succs[s]];
+            cfg->preds[succ->pred_start + succ->npreds++] = i;
+        }
+    }
+}
+
+// Depth-first from the entry with an explicit stack, so deep graphs cannot
+// overflow the C stack.
+static void number_blocks(cfg_t* cfg) {
+    cfg->rpo = alloc_array(cfg->nblocks, sizeof(size_t));
+    cfg->rpo_index = alloc_array(cfg->nblocks, sizeof(size_t));
+    cfg->nrpo = 0;
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        cfg->rpo_index[i] = CFG_NONE;
+    }
+    if (cfg->nblocks == 0) {
+        return;
+    }
+
+    size_t* stack = alloc_array(cfg->nblocks, sizeof(size_t));
+    size_t* next_succ = alloc_array(cfg->nblocks, sizeof(size_t));
+    bool* seen = alloc_array(cfg->nblocks, sizeof(bool));
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        next_succ[i] = 0;
+        seen[i] = false;
+    }
+
+    // Blocks are written to the back of `rpo` as they finish.
+    size_t npost = 0;
+    size_t depth = 0;
+    stack[depth++] = 0;
+    seen[0] = true;
+    while (depth > 0) {
+        const size_t b = stack[depth - 1];
+        const block_t* block = &cfg->blocks[b];
+        if (next_succ[b] < block->nsuccs) {
+            const size_t succ = block->succs[next_succ[b]++];
+            if (!seen[succ]) {
+                seen[succ] = true;
+                stack[depth++] = succ;
+            }
+            continue;
+        }
+        depth--;
+        cfg->rpo[cfg->nblocks - 1 - npost++] = b;
+    }
+
+    // Unreachable blocks never finished, so the order sits at the back.
+    const size_t skip = cfg->nblocks - npost;
+    for (size_t i = 0; i < npost; ++i) {
+        cfg->rpo[i] = cfg->rpo[skip + i];
+        cfg->rpo_index[cfg->rpo[i]] = i;
+    }
+    cfg->nrpo = npost;
+
+    fort_free(seen);
+    fort_free(next_succ);
+    fort_free(stack);
+}
+
+void cfg_build(const asm_func_t* func, cfg_t* cfg) {
+    *cfg = (cfg_t){0};
+    cfg->nblocks = count_blocks(func);
+    cfg->blocks = alloc_array(cfg->nblocks, sizeof(block_t));
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        cfg->blocks[i] = (block_t){0};
+    }
+
+    split_blocks(func, cfg);
+    link_preds(cfg);
+    number_blocks(cfg);
+}
+
+void cfg_fini(cfg_t* cfg) {
+    fort_free(cfg->rpo_index);
+    fort_free(cfg->rpo);
+    fort_free(cfg->preds);
+    fort_free(cfg->blocks);
+    *cfg = (cfg_t){0};
+}
+
+static size_t intersect(const cfg_t* cfg, const size_t* idom, size_t a, size_t b) {
+    while (a != b) {
+        while (cfg->rpo_index[a] > cfg->rpo_index[b]) {
+            a = idom[a];
+        }
+        while (cfg->rpo_index[b] > cfg->rpo_index[a]) {
+            b = idom[b];
+        }
+    }
+
+    return a;
+}
+
+void dom_build(const cfg_t* cfg, dom_t* dom) {
+    dom->nblocks = cfg->nblocks;
+    dom->idom = alloc_array(cfg->nblocks, sizeof(size_t));
+    for (size_t i = 0; i < cfg->nblocks; ++i) {
+        dom->idom[i] = CFG_NONE;
+    }
+    if (cfg->nrpo == 0) {
+        return;
+    }
+
+    // The entry is its own dominator while iterating; that is what stops
+    // intersect at the root.
+    const size_t entry = cfg->rpo[0];
+    dom->idom[entry] = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < cfg->nrpo; ++i) {
+            const size_t b = cfg->rpo[i];
+            const block_t* block = &cfg->blocks[b];
+            size_t new_idom = CFG_NONE;
+            for (size_t p = 0; p < block->npreds; ++p) {
+                const size_t pred = cfg->preds[block->pred_start + p];
+                if (dom->idom[pred] == CFG_NONE) {
+                    continue;
+                }
+                new_idom = new_idom == CFG_NONE ? pred : intersect(cfg, dom->idom, pred, new_idom);
+            }
+            if (dom->idom[b] != new_idom) {
+                dom->idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    dom->idom[entry] = CFG_NONE;
+}
+
+void dom_fini(dom_t* dom) {
+    fort_free(dom->idom);
+    *dom = (dom_t){0};
+}
+
+bool dom_dominates(const dom_t* dom, size_t a, size_t b) {
+    if (a >= dom->nblocks || b >= dom->nblocks) {
+        return false;
+    }
+    // Besides the entry, only unreachable blocks lack a dominator.
+    if (b != 0 && dom->idom[b] == CFG_NONE) {
+        return false;
+    }
+
+    for (size_t x = b; x != CFG_NONE; x = dom->idom[x]) {
+        if (x == a) {
+            return true;
+        }
+    }
+
+    return false;
+}
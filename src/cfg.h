@@ -0,0 +1,66 @@
+#ifndef FORT_CFG_H
+#define FORT_CFG_H
+
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for SIZE_MAX
+
+#include "assemble.h"  // for asm_func_t, inst_t
+
+// Stands for "no block": the immediate dominator of the entry block and of
+// unreachable blocks, and the reverse postorder index of unreachable blocks.
+#define CFG_NONE SIZE_MAX
+
+#define CFG_SUCCS_MAX 2
+
+// A maximal run of instructions that is entered only at `first` and left only
+// after `last`. The instructions stay in the function's list; a block only
+// marks where it starts and ends.
+typedef struct {
+    inst_t* first;
+    inst_t* last;
+    size_t ninsts;
+    size_t succs[CFG_SUCCS_MAX];
+    size_t nsuccs;
+    // This block's predecessors are preds[pred_start, pred_start + npreds).
+    size_t pred_start;
+    size_t npreds;
+} block_t;
+
+// Control flow graph of one function. Block 0 is the entry.
+typedef struct {
+    block_t* blocks;
+    size_t nblocks;
+    size_t* preds;
+    // Blocks reachable from the entry in reverse postorder, and the position
+    // of each block in that order, CFG_NONE when it is unreachable.
+    size_t* rpo;
+    size_t nrpo;
+    size_t* rpo_index;
+} cfg_t;
+
+void cfg_build(const asm_func_t* func, cfg_t* cfg);
+
+void cfg_fini(cfg_t* cfg);
+
+static inline bool cfg_reachable(const cfg_t* cfg, size_t block) {
+    return cfg->rpo_index[block] != CFG_NONE;
+}
+
+// Immediate dominators, one per block of the CFG they were computed from.
+typedef struct {
+    size_t* idom;
+    size_t nblocks;
+} dom_t;
+
+// Cooper, Harvey and Kennedy's iterative algorithm over reverse postorder.
+void dom_build(const cfg_t* cfg, dom_t* dom);
+
+void dom_fini(dom_t* dom);
+
+// Whether every path from the entry to `b` goes through `a`. Every reachable
+// block dominates itself; unreachable blocks dominate nothing and are
+// dominated by nothing.
+bool dom_dominates(const dom_t* dom, size_t a, size_t b);
+
+#endif // FORT_CFG_H
@@ -2,7 +2,7 @@
 #define FORT_COMMON_H
 
 #include <stdarg.h>  // for va_end, va_list, va_start
-#include <stdio.h>   // for fprintf, stderr, vfprintf, size_t
+#include <stdio.h>   // for fprintf, fputc, stderr, vfprintf, size_t
 
 #define FORT_UNUSED(x) (void)(x)
 
@@ -21,6 +21,22 @@ static inline void eprintln(const char* fmt, ...) {
     FORT_UNUSED(fprintf(stderr, "\n"));
 }
 
+// Writes `s` as a quoted JSON string.
+static inline void json_print_str(FILE* out, const char* s) {
+    FORT_UNUSED(fputc('"', out));
+    for (; *s != '\0'; ++s) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            FORT_UNUSED(fprintf(out, "\\%c", c));
+        } else if (c < 0x20) {
+            FORT_UNUSED(fprintf(out, "\\u%04x", c));
+        } else {
+            FORT_UNUSED(fputc(c, out));
+        }
+    }
+    FORT_UNUSED(fputc('"', out));
+}
+
 typedef enum {
     FORT_OUTCOME_OK,
     FORT_OUTCOME_ERR,
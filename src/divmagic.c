@@ -0,0 +1,138 @@
+#include "divmagic.h"
+
+#include <stdbool.h>  // for bool, false, true
+#include <stdint.h>   // for int32_t, int64_t, uint32_t
+
+#include "common.h"   // for FORT_OUTCOME_OK, FORT_OUTCOME_ERR
+
+#define TWO_31 0x80000000U
+
+// Two's complement reinterpretation both ways, without relying on
+// implementation-defined conversions of out-of-range values.
+static int32_t to_signed(uint32_t x) {
+    return x < TWO_31 ? (int32_t)x : (int32_t)(x - TWO_31) - INT32_MAX - 1;
+}
+
+static uint32_t to_unsigned(int32_t x) {
+    return (uint32_t)x;
+}
+
+// sar: shifts in copies of the sign bit.
+static int32_t sar(int32_t x, unsigned n) {
+    const uint32_t u = to_unsigned(x);
+    const uint32_t fill = x < 0 ? ~(UINT32_MAX >> n) : 0;
+    return to_signed((u >> n) | fill);
+}
+
+// imul's high half.
+static int32_t mulhs(int32_t a, int32_t b) {
+    const int64_t product = (int64_t)a * (int64_t)b;
+    const int64_t high = product < 0 ? -((-(product + 1)) >> 32) - 1 : product >> 32;
+    return (int32_t)high;
+}
+
+static bool is_pow2(uint32_t x) {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+static unsigned log2_pow2(uint32_t x) {
+    unsigned n = 0;
+    while (x > 1) {
+        x >>= 1;
+        n++;
+    }
+
+    return n;
+}
+
+// The smallest magic number and shift for which the high-half product
+// truncates like division, from Hacker's Delight figure 10-1.
+static void magic(int32_t d, divmagic_t* plan) {
+    const uint32_t ad = d < 0 ? 0U - to_unsigned(d) : to_unsigned(d);
+    const uint32_t t = TWO_31 + (to_unsigned(d) >> 31);
+    const uint32_t anc = t - 1 - t % ad;
+    unsigned p = 31;
+    uint32_t q1 = TWO_31 / anc;
+    uint32_t r1 = TWO_31 - q1 * anc;
+    uint32_t q2 = TWO_31 / ad;
+    uint32_t r2 = TWO_31 - q2 * ad;
+    uint32_t delta = 0;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    const uint32_t m = q2 + 1;
+    plan->magic = to_signed(d < 0 ? 0U - m : m);
+    plan->shift = p - 32;
+    plan->add = d > 0 && plan->magic < 0;
+    plan->sub = d < 0 && plan->magic > 0;
+}
+
+fort_outcome_t divmagic_plan(int32_t divisor, divmagic_t* plan) {
+    if (divisor == 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    *plan = (divmagic_t){.divisor = divisor};
+    const uint32_t abs_divisor = divisor < 0 ? 0U - to_unsigned(divisor) : to_unsigned(divisor);
+    if (divisor == 1) {
+        plan->kind = DIVMAGIC_IDENTITY;
+    } else if (divisor == -1) {
+        plan->kind = DIVMAGIC_NEGATE;
+    } else if (is_pow2(abs_divisor)) {
+        plan->kind = DIVMAGIC_POW2;
+        plan->shift = log2_pow2(abs_divisor);
+        plan->negate = divisor < 0;
+    } else {
+        plan->kind = DIVMAGIC_MUL;
+        magic(divisor, plan);
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+int32_t divmagic_div(const divmagic_t* plan, int32_t x) {
+    switch (plan->kind) {
+    case DIVMAGIC_IDENTITY:
+        return x;
+    case DIVMAGIC_NEGATE:
+        return to_signed(0U - to_unsigned(x));
+    case DIVMAGIC_POW2: {
+        // sar $shift-1; shr $32-shift; add; sar $shift; [neg]
+        const uint32_t bias = to_unsigned(sar(x, plan->shift - 1)) >> (32 - plan->shift);
+        const int32_t q = sar(to_signed(to_unsigned(x) + bias), plan->shift);
+        return plan->negate ? to_signed(0U - to_unsigned(q)) : q;
+    }
+    case DIVMAGIC_MUL: {
+        // imul; [add|sub]; sar $shift; shr $31; add
+        uint32_t q = to_unsigned(mulhs(plan->magic, x));
+        if (plan->add) {
+            q += to_unsigned(x);
+        } else if (plan->sub) {
+            q -= to_unsigned(x);
+        }
+        q = to_unsigned(sar(to_signed(q), plan->shift));
+        return to_signed(q + (q >> 31));
+    }
+    }
+
+    return 0;
+}
+
+int32_t divmagic_mod(const divmagic_t* plan, int32_t x) {
+    const uint32_t q = to_unsigned(divmagic_div(plan, x));
+    return to_signed(to_unsigned(x) - q * to_unsigned(plan->divisor));
+}
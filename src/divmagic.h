@@ -0,0 +1,49 @@
+#ifndef FORT_DIVMAGIC_H
+#define FORT_DIVMAGIC_H
+
+#include <stdbool.h>  // for bool
+#include <stdint.h>   // for int32_t
+
+#include "common.h"   // for fort_outcome_t
+
+// How to divide a signed 32-bit value by a constant without idiv.
+typedef enum {
+    // x / 1 is x.
+    DIVMAGIC_IDENTITY,
+    // x / -1 is -x, wrapping: INT_MIN / -1 gives INT_MIN where idiv would
+    // fault.
+    DIVMAGIC_NEGATE,
+    // |d| = 2^shift: bias negative x by 2^shift - 1 so the arithmetic
+    // shift rounds toward zero, then shift.
+    DIVMAGIC_POW2,
+    // The high half of magic * x, corrected by x when the magic number's
+    // sign differs from the divisor's, shifted right, plus one when the
+    // result is negative (Granlund and Montgomery, as in Hacker's Delight
+    // 10-1).
+    DIVMAGIC_MUL,
+} divmagic_kind_t;
+
+typedef struct {
+    divmagic_kind_t kind;
+    int32_t divisor;
+    int32_t magic;
+    unsigned shift;
+    // DIVMAGIC_MUL: add x to, or subtract it from, the high half.
+    bool add;
+    bool sub;
+    // Negate the quotient: DIVMAGIC_POW2 with a negative divisor.
+    bool negate;
+} divmagic_t;
+
+// Fails only for a zero divisor.
+fort_outcome_t divmagic_plan(int32_t divisor, divmagic_t* plan);
+
+// What the instructions the plan describes compute, written with the same
+// operations so that they can be checked against C's / and %, which
+// truncate toward zero.
+int32_t divmagic_div(const divmagic_t* plan, int32_t x);
+
+// x - (x / d) * d, with the multiplication wrapping.
+int32_t divmagic_mod(const divmagic_t* plan, int32_t x);
+
+#endif // FORT_DIVMAGIC_H
@@ -1,24 +1,67 @@
 
-#define _XOPEN_SOURCE 500 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
-#include <fcntl.h>     // for open, O_RDONLY
-#include <getopt.h>    // for no_argument, getopt_long, option
-#include <stdio.h>     // for perror, size_t
-#include <stdlib.h>    // for EXIT_FAILURE, free, EXIT_SUCCESS, malloc
-#include <unistd.h>    // for NULL, close, optind, pread, off_t, ssize_t
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <errno.h>     // for errno
+#include <fcntl.h>     // for open, openat, AT_FDCWD, O_CREAT, O_DIRECTORY, O_RDONLY
+#include <getopt.h>    // for no_argument, required_argument, getopt_long, optarg
+#include <inttypes.h>  // for PRIu64, PRId32
+#include <signal.h>    // for sigaction, sigemptyset, SIGINT, SIGTERM
+#include <stdarg.h>    // for va_end, va_list, va_start
+#include <stdbool.h>   // for false, true
+#include <stdint.h>    // for int32_t, uint64_t
+#include <stdio.h>     // for fdopen, fflush, fprintf, open_memstream, vsnprintf, FILE
+#include <stdlib.h>    // for EXIT_FAILURE, free, EXIT_SUCCESS, getenv, strtoul
+#include <string.h>    // for strerror_r, memchr, memcpy, strcmp
+#include <pthread.h>   // for pthread_mutex_lock, pthread_rwlock_rdlock, pthread_rwlock_t
+#include <unistd.h>    // for NULL, close, optind, pread, off_t
 #include <sys/stat.h>  // for stat, fstat
 
+#include "alloc.h"     // for alloc_stats_t, alloc_stats, alloc_print, fort_alloc, fort_free
+#include "arena.h"     // for arena_t, arena_fini, arena_reset, mkarena
 #include "assemble.h"
+#include "cache.h"     // for cache_t, cache_key, cache_lookup, cache_store, mkcache
 #include "common.h"    // for eprintln, FORT_OUTCOME_OK, fort_outcome_t, FOR...
+#include "jit.h"       // for jit_prog_t, jit_opts_t, jit_exec, jit_prog_fini, mkjit
 #include "lex.h"       // for tok_stream_t, lexer_fini, lexer_run, mklexer
+#include "opt.h"       // for opt_pipeline_t, opt_stats_t, opt_pipeline_level, opt_print
 #include "parse.h"     // for mkparser, parser_fini, parser_run, prog_t, par...
+#include "perf.h"      // for mkjitdump, mkperf_map, jitdump_fini, perf_map_fini
+#include "pool.h"      // for mkpool, pool_fini, pool_run, pool_t
+#include "server.h"    // for server_t, mkserver, server_run, server_forward, SERVER_PATH_MAX
+#include "stats.h"     // for stats_t, stats_ast_nodes, stats_count_toks, st...
+#include "timing.h"    // for timing_t, timing_now, timing_lap, timing_merge
+#include "trace.h"     // for trace_begin, trace_end, trace_start, trace_stop
 
 typedef enum {
     STAGE_LEX,
     STAGE_PARSE,
     STAGE_CODEGEN,
     STAGE_COMPILE,
+    STAGE_JIT,
 } stage_t;
 
+typedef enum {
+    OPT_PERF_MAP = STAGE_JIT + 1,
+    OPT_JITDUMP,
+    OPT_CACHE_DIR,
+    OPT_CACHE_STATS,
+    OPT_SERVER,
+    OPT_CLIENT,
+    OPT_SOCKET,
+    OPT_TIME_REPORT,
+    OPT_MEM_REPORT,
+    OPT_STATS,
+    OPT_TRACE,
+    OPT_PASSES,
+    OPT_JOBS = 'j',
+    OPT_LEVEL = 'O',
+} opt_t;
+
+typedef enum {
+    REPORT_NONE,
+    REPORT_TEXT,
+    REPORT_JSON,
+} report_t;
+
 #define FMTstage "STAGE(%s)"
 
 static inline const char* ARGstage(stage_t stage) {
@@ -31,35 +74,77 @@ static inline const char* ARGstage(stage_t stage) {
         return "codegen";
     case STAGE_COMPILE:
         return "compile";
+    case STAGE_JIT:
+        return "jit";
     default:
         return "unknown";
     }
 }
 
-static char* load_src(const char* filepath) {
-    int fd = open(filepath, O_RDONLY);
+#define DIAG_MAX 1024
+
+// Diagnostics for one source file. Files are compiled concurrently, so
+// messages are buffered and printed in input order once all workers are done.
+typedef struct {
+    char buf[DIAG_MAX];
+    size_t len;
+} diag_t;
+
+static void diag_println(diag_t* diag, const char* fmt, ...) {
+    const size_t rem = DIAG_MAX - diag->len;
+    if (rem <= 1) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+    const int n = vsnprintf(diag->buf + diag->len, rem - 1, fmt, args);
+#pragma GCC diagnostic pop
+    va_end(args);
+
+    if (n < 0) {
+        return;
+    }
+    diag->len += (size_t)n < rem - 1 ? (size_t)n : rem - 2;
+    diag->buf[diag->len++] = '\n';
+}
+
+static void diag_perror(diag_t* diag, const char* what) {
+    char msg[DIAG_MAX];
+    if (strerror_r(errno, msg, sizeof(msg)) != 0) {
+        msg[0] = '\0';
+    }
+    diag_println(diag, "%s: %s", what, msg);
+}
+
+// Relative paths are resolved against `dirfd`, which is the client's working
+// directory when serving requests and AT_FDCWD otherwise.
+static char* load_src(int dirfd, const char* filepath, size_t* len, diag_t* diag) {
+    int fd = openat(dirfd, filepath, O_RDONLY);
     if (fd < 0) {
-        perror("open");
+        diag_perror(diag, "open");
         return NULL;
     }
 
     struct stat st;
     if (fstat(fd, &st) < 0) {
-        perror("fstat");
+        diag_perror(diag, "fstat");
         FORT_UNUSED(close(fd));
         return NULL;
     }
 
     if (st.st_size < 0) {
-        eprintln("error: unexpected file size: %zd", st.st_size);
+        diag_println(diag, "error: unexpected file size: %zd", st.st_size);
         FORT_UNUSED(close(fd));
         return NULL;
     }
 
     size_t file_sz = (size_t)st.st_size;
-    char* src = malloc(file_sz + 1);
+    char* src = fort_alloc(ALLOC_LOAD, file_sz + 1);
     if (src == NULL) {
-        perror("malloc");
+        diag_perror(diag, "malloc");
         FORT_UNUSED(close(fd));
         return NULL;
     }
@@ -70,8 +155,8 @@ static char* load_src(const char* filepath) {
     while (nbytes_rem > 0) {
         ssize_t nbytes = pread(fd, src + off, nbytes_rem, off);
         if (nbytes < 0) {
-            perror("pread");
-            free(src);
+            diag_perror(diag, "pread");
+            fort_free(src);
             FORT_UNUSED(close(fd));
             return NULL;
         }
@@ -80,151 +165,911 @@ static char* load_src(const char* filepath) {
     }
 
     FORT_UNUSED(close(fd));
+    *len = file_sz;
 
     return src;
 }
 
 static void print_usage(void) {
-    eprintln("Usage: fort [OPTIONS] <source_file>");
+    eprintln("Usage: fort [OPTIONS] <source_file>...");
     eprintln("Options:");
     eprintln("  --lex       Tokenize the source file");
     eprintln("  --parse     Parse the source file\n");
     eprintln("  --codegen   Generate code from the source file");
     eprintln("  --compile   Compile the source file (default)");
+    eprintln("  --jit       Compile the source file in memory and run it");
+    eprintln("  --perf-map  With --jit, write /tmp/perf-<pid>.map for perf report");
+    eprintln("  --jitdump   With --jit, write jit-<pid>.dump for perf inject --jit");
+    eprintln("  -O0, -O1, -O2");
+    eprintln("              Optimize the generated code: not at all (default), with cleanups");
+    eprintln("              that only shrink it, or with every pass");
+    eprintln("  --passes=LIST");
+    eprintln("              Run exactly the comma-separated passes in LIST instead of an -O");
+    eprintln("              preset: unreachable, gvn, dead-def, zero-idiom");
+    eprintln("  --cache-dir=DIR");
+    eprintln("              Reuse code generated for identical sources (default: $FORT_CACHE_DIR)");
+    eprintln("  --cache-stats");
+    eprintln("              Report code cache hits and misses");
+    eprintln("  -j, --jobs=N");
+    eprintln("              Compile up to N source files, or the functions of a single");
+    eprintln("              file, in parallel (default: 1)");
+    eprintln("  --server    Serve compile requests on a Unix socket until interrupted,");
+    eprintln("              up to --jobs of them at once, with --cache-dir for all of them");
+    eprintln("  --client    Have a running server compile the source files; fort-client");
+    eprintln("              does the same without loading the compiler");
+    eprintln("  --socket=PATH");
+    eprintln("              Socket for --server and --client");
+    eprintln("              (default: $XDG_RUNTIME_DIR/fort.sock or /tmp/fort-<uid>/fort.sock)");
+    eprintln("  --time-report[=json]");
+    eprintln("              Report time and throughput per compiler phase, and time per");
+    eprintln("              optimization pass and analysis, on stderr");
+    eprintln("  --mem-report[=json]");
+    eprintln("              Report allocations and peak memory per compiler stage on stderr");
+    eprintln("  --stats[=json]");
+    eprintln("              Count tokens, AST nodes, instructions before and after each pass,");
+    eprintln("              and code bytes of each file's entry function on stderr, as");
+    eprintln("              key=value lines or one JSON object per file");
+    eprintln("  --trace=FILE");
+    eprintln("              Write a Chrome trace of every file, phase and function to FILE");
 }
 
 typedef struct {
-    const char* filepath;
+    char* const* filepaths;
+    size_t nfiles;
     stage_t stage;
+    bool perf_map;
+    bool jitdump;
+    const char* cache_dir;
+    bool cache_stats;
+    size_t jobs;
+    bool server;
+    bool client;
+    const char* socket_path;
+    report_t time_report;
+    report_t mem_report;
+    report_t stats;
+    const char* trace_path;
+    unsigned opt_level;
+    const char* passes;
+    opt_pipeline_t pipeline;
 } opts_t;
 
+static fort_outcome_t parse_jobs(const char* arg, size_t* jobs) {
+    const int base = 10;
+    char* end = NULL;
+    errno = 0;
+    const unsigned long val = strtoul(arg, &end, base);
+    if (errno != 0 || end == arg || *end != '\0' || val == 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    *jobs = val;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_level(const char* arg, unsigned* level) {
+    if (arg[0] < '0' || arg[0] > '0' + OPT_LEVEL_MAX || arg[1] != '\0') {
+        return FORT_OUTCOME_ERR;
+    }
+
+    *level = (unsigned)(arg[0] - '0');
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t parse_report(const char* arg, report_t* report) {
+    if (arg == NULL) {
+        *report = REPORT_TEXT;
+    } else if (strcmp(arg, "json") == 0) {
+        *report = REPORT_JSON;
+    } else {
+        return FORT_OUTCOME_ERR;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
 static fort_outcome_t parse_opts(int argc, char* argv[], opts_t* opts) {
     static const struct option long_opts[] = {{"lex", no_argument, NULL, STAGE_LEX},
                                               {"parse", no_argument, NULL, STAGE_PARSE},
                                               {"codegen", no_argument, NULL, STAGE_CODEGEN},
                                               {"compile", no_argument, NULL, STAGE_COMPILE},
+                                              {"jit", no_argument, NULL, STAGE_JIT},
+                                              {"perf-map", no_argument, NULL, OPT_PERF_MAP},
+                                              {"jitdump", no_argument, NULL, OPT_JITDUMP},
+                                              {"cache-dir", required_argument, NULL, OPT_CACHE_DIR},
+                                              {"cache-stats", no_argument, NULL, OPT_CACHE_STATS},
+                                              {"jobs", required_argument, NULL, OPT_JOBS},
+                                              {"server", no_argument, NULL, OPT_SERVER},
+                                              {"client", no_argument, NULL, OPT_CLIENT},
+                                              {"socket", required_argument, NULL, OPT_SOCKET},
+                                              {"time-report", optional_argument, NULL, OPT_TIME_REPORT},
+                                              {"mem-report", optional_argument, NULL, OPT_MEM_REPORT},
+                                              {"stats", optional_argument, NULL, OPT_STATS},
+                                              {"trace", required_argument, NULL, OPT_TRACE},
+                                              {"passes", required_argument, NULL, OPT_PASSES},
                                               {NULL, 0, NULL, 0}};
     int opt = -1;
-    while ((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "j:O:", long_opts, NULL)) != -1) {
         switch (opt) {
         case STAGE_LEX:
         case STAGE_PARSE:
         case STAGE_CODEGEN:
         case STAGE_COMPILE:
+        case STAGE_JIT:
             opts->stage = (stage_t)opt;
             break;
+        case OPT_PERF_MAP:
+            opts->perf_map = true;
+            break;
+        case OPT_JITDUMP:
+            opts->jitdump = true;
+            break;
+        case OPT_CACHE_DIR:
+            opts->cache_dir = optarg;
+            break;
+        case OPT_CACHE_STATS:
+            opts->cache_stats = true;
+            break;
+        case OPT_JOBS:
+            FORT_OUTCOME_NOK_RET(parse_jobs(optarg, &opts->jobs));
+            break;
+        case OPT_SERVER:
+            opts->server = true;
+            break;
+        case OPT_CLIENT:
+            opts->client = true;
+            break;
+        case OPT_SOCKET:
+            opts->socket_path = optarg;
+            break;
+        case OPT_TIME_REPORT:
+            FORT_OUTCOME_NOK_RET(parse_report(optarg, &opts->time_report));
+            break;
+        case OPT_MEM_REPORT:
+            FORT_OUTCOME_NOK_RET(parse_report(optarg, &opts->mem_report));
+            break;
+        case OPT_STATS:
+            FORT_OUTCOME_NOK_RET(parse_report(optarg, &opts->stats));
+            break;
+        case OPT_TRACE:
+            opts->trace_path = optarg;
+            break;
+        case OPT_LEVEL:
+            FORT_OUTCOME_NOK_RET(parse_level(optarg, &opts->opt_level));
+            break;
+        case OPT_PASSES:
+            opts->passes = optarg;
+            break;
         default:
             return FORT_OUTCOME_ERR;
         }
     }
 
-    if (optind != argc - 1) {
+    // An explicit pass list wins over the preset, wherever they appear.
+    if (opts->passes != NULL) {
+        FORT_OUTCOME_NOK_RET(opt_pipeline_parse(opts->passes, &opts->pipeline));
+    } else {
+        FORT_OUTCOME_NOK_RET(opt_pipeline_level(opts->opt_level, &opts->pipeline));
+    }
+
+    // The server takes its source files from requests.
+    if (opts->server) {
+        return optind < argc || opts->client ? FORT_OUTCOME_ERR : FORT_OUTCOME_OK;
+    }
+
+    if (optind >= argc) {
         return FORT_OUTCOME_ERR;
     }
 
-    opts->filepath = argv[optind];
+    opts->filepaths = argv + optind;
+    opts->nfiles = (size_t)(argc - optind);
 
     return FORT_OUTCOME_OK;
 }
 
-static fort_outcome_t stage_lex(const char* src, tok_stream_t* toks) {
+// One source file and everything the stages report about it.
+typedef struct {
+    const char* filepath;
+    fort_outcome_t outcome;
+    int32_t ret;
+    diag_t diag;
+    timing_t timing;
+    bool count_stats;
+    stats_t stats;
+    const opt_pipeline_t* pipeline;
+    opt_stats_t opt;
+} unit_t;
+
+// Charges a phase to the unit's time report and, with --trace, records it as
+// a span on the calling thread.
+static void phase_done(unit_t* unit, phase_t phase, uint64_t start) {
+    FORT_UNUSED(timing_lap(&unit->timing, phase, start));
+
+    const char* name = phase_name(phase);
+    trace_end((buf_t){name, strlen(name)}, "phase", start);
+}
+
+static fort_outcome_t stage_lex(const char* src, tok_stream_t* toks, unit_t* unit) {
+    const uint64_t start = timing_now();
     lexer_t* lexer = mklexer(src, 0);
     fort_outcome_t outcome = lexer_run(lexer, toks);
     lexer_fini(lexer);
+    phase_done(unit, PHASE_LEX, start);
+    unit->timing.tokens = toks->ntoks;
     if (outcome != FORT_OUTCOME_OK) {
-        eprintln("error: failed to lex source file");
+        diag_println(&unit->diag, "error: failed to lex source file");
 
         return outcome;
     }
 
+    if (unit->count_stats) {
+        stats_count_toks(&unit->stats, toks);
+    }
+
     return FORT_OUTCOME_OK;
 }
 
-static fort_outcome_t stage_parse(const char* src, prog_t* prog) {
-    tok_stream_t toks = {0};
-    fort_outcome_t outcome = stage_lex(src, &toks);
+// Where a compilation allocates from, and the pool it may spread the
+// functions of a single file across. arenas[0] belongs to the calling worker;
+// with a pool there is one arena per pool worker.
+typedef struct {
+    arena_t** arenas;
+    pool_t* pool;
+} workers_t;
+
+static fort_outcome_t stage_parse(const char* src,
+                                  const workers_t* workers,
+                                  prog_t* prog,
+                                  unit_t* unit) {
+    tok_stream_t toks = {.arena = workers->arenas[0]};
+    fort_outcome_t outcome = stage_lex(src, &toks, unit);
     if (outcome != FORT_OUTCOME_OK) {
+        tok_stream_fini(&toks);
         return outcome;
     }
 
+    const uint64_t start = timing_now();
     parser_t* parser = mkparser(&toks);
     outcome = parser_run(parser, prog);
     parser_fini(parser);
     tok_stream_fini(&toks);
+    phase_done(unit, PHASE_PARSE, start);
     if (outcome != FORT_OUTCOME_OK) {
-        eprintln("error: failed to parse source file");
+        diag_println(&unit->diag, "error: failed to parse source file");
 
         return outcome;
     }
 
+    if (unit->count_stats) {
+        stats_count_prog(&unit->stats, prog);
+    }
+
     return FORT_OUTCOME_OK;
 }
 
-static fort_outcome_t stage_codegen(const char* src, asm_prog_t* asm_prog) {
+static fort_outcome_t stage_codegen(const char* src,
+                                    const workers_t* workers,
+                                    asm_prog_t* asm_prog,
+                                    unit_t* unit) {
     prog_t prog = {0};
-    fort_outcome_t outcome = stage_parse(src, &prog);
+    fort_outcome_t outcome = stage_parse(src, workers, &prog, unit);
     if (outcome != FORT_OUTCOME_OK) {
+        prog_fini(&prog);
         return outcome;
     }
 
+    const uint64_t start = timing_now();
+    asm_prog->arenas = workers->arenas;
     assembler_t* assembler = mkassembler(&prog);
+    assembler_set_pool(assembler, workers->pool);
+    assembler_set_opt(assembler, unit->pipeline, &unit->opt);
     outcome = assembler_run(assembler, asm_prog);
     assembler_fini(assembler);
+    prog_fini(&prog);
+    phase_done(unit, PHASE_CODEGEN, start);
 
     if (outcome != FORT_OUTCOME_OK) {
-        eprintln("error: failed to generate assembly");
+        diag_println(&unit->diag, "error: failed to generate assembly");
 
         return outcome;
     }
 
+    if (unit->count_stats) {
+        stats_count_asm(&unit->stats, asm_prog);
+        stats_count_opt(&unit->stats, unit->pipeline, &unit->opt);
+    }
+
     return FORT_OUTCOME_OK;
 }
 
-int main(int argc, char* argv[]) {
-    int exit_code = EXIT_FAILURE;
-    fort_outcome_t outcome = FORT_OUTCOME_ERR;
+static fort_outcome_t stage_jit(const char* src,
+                                const workers_t* workers,
+                                jit_prog_t* jit_prog,
+                                unit_t* unit) {
+    asm_prog_t asm_prog = {0};
+    fort_outcome_t outcome = stage_codegen(src, workers, &asm_prog, unit);
+    if (outcome != FORT_OUTCOME_OK) {
+        asm_prog_fini(&asm_prog);
+        return outcome;
+    }
+
+    const uint64_t start = timing_now();
+    jit_t* jit = mkjit(&asm_prog);
+    outcome = jit_run(jit, jit_prog);
+    jit_fini(jit);
+    asm_prog_fini(&asm_prog);
+    phase_done(unit, PHASE_EMIT, start);
 
-    opts_t opts = {NULL, STAGE_LEX};
-    outcome = parse_opts(argc, argv, &opts);
     if (outcome != FORT_OUTCOME_OK) {
-        print_usage();
-        return EXIT_FAILURE;
+        diag_println(&unit->diag, "error: failed to encode machine code");
+
+        return outcome;
     }
 
-    char* src = load_src(opts.filepath);
-    if (src == NULL) {
-        return EXIT_FAILURE;
+    if (unit->count_stats) {
+        stats_count_code(&unit->stats, jit_prog);
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+#define CACHE_OPTS_MAX 512
+
+// Options that change the generated code and so must be part of the cache key.
+// Passes are keyed by name rather than by -O level, so a level whose passes
+// change does not serve stale code; changes to the compiler itself are
+// covered by the build id that cache_key mixes in.
+static buf_t cache_opts(const opts_t* opts, char* buf, size_t len) {
+    const int n = snprintf(buf, len, "x86_64;passes=");
+    const size_t prefix = n > 0 ? (size_t)n : 0;
+    const size_t total = prefix + opt_pipeline_str(&opts->pipeline, buf + prefix, len - prefix);
+
+    return (buf_t){buf, total < len ? total : len - 1};
+}
+
+static fort_outcome_t stage_cached(cache_t* cache,
+                                   const opts_t* opts,
+                                   buf_t src,
+                                   const workers_t* workers,
+                                   jit_prog_t* jit_prog,
+                                   unit_t* unit) {
+    uint64_t start = timing_now();
+    char opts_buf[CACHE_OPTS_MAX];
+    const uint64_t key = cache_key(src, cache_opts(opts, opts_buf, sizeof(opts_buf)));
+    const fort_outcome_t hit = cache_lookup(cache, key, jit_prog);
+    phase_done(unit, PHASE_CACHE, start);
+    if (hit == FORT_OUTCOME_OK) {
+        if (unit->count_stats) {
+            stats_count_code(&unit->stats, jit_prog);
+        }
+        return FORT_OUTCOME_OK;
+    }
+
+    fort_outcome_t outcome = stage_jit(src.p, workers, jit_prog, unit);
+    if (outcome != FORT_OUTCOME_OK) {
+        return outcome;
     }
 
-    switch (opts.stage) {
+    start = timing_now();
+    if (cache_store(cache, key, jit_prog) != FORT_OUTCOME_OK) {
+        diag_println(&unit->diag, "warning: failed to write code cache entry");
+    }
+    phase_done(unit, PHASE_CACHE, start);
+
+    return FORT_OUTCOME_OK;
+}
+
+
+typedef struct {
+    const opts_t* opts;
+    cache_t* cache;
+    jit_opts_t jit;
+    int dirfd;
+    arena_t** arenas;
+    pool_t* pool;
+    unit_t* units;
+} batch_t;
+
+static fort_outcome_t compile_src(const batch_t* batch,
+                                  buf_t src,
+                                  const workers_t* workers,
+                                  unit_t* unit) {
+    const opts_t* opts = batch->opts;
+    fort_outcome_t outcome = FORT_OUTCOME_ERR;
+
+    switch (opts->stage) {
     case STAGE_LEX: {
-        tok_stream_t toks = {0};
-        outcome = stage_lex(src, &toks);
+        tok_stream_t toks = {.arena = workers->arenas[0]};
+        outcome = stage_lex(src.p, &toks, unit);
         tok_stream_fini(&toks);
-        exit_code = outcome == FORT_OUTCOME_OK ? EXIT_SUCCESS : EXIT_FAILURE;
         break;
     }
 
     case STAGE_PARSE: {
         prog_t prog = {0};
-        outcome = stage_parse(src, &prog);
-        exit_code = outcome == FORT_OUTCOME_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+        outcome = stage_parse(src.p, workers, &prog, unit);
+        prog_fini(&prog);
         break;
     }
 
     case STAGE_CODEGEN: {
-        asm_prog_t asm_prog = {0};
-        outcome = stage_codegen(src, &asm_prog);
-        asm_prog_fini(&asm_prog);
-        exit_code = outcome == FORT_OUTCOME_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+        if (batch->cache != NULL) {
+            jit_prog_t jit_prog = {0};
+            outcome = stage_cached(batch->cache, opts, src, workers, &jit_prog, unit);
+            jit_prog_fini(&jit_prog);
+        } else {
+            asm_prog_t asm_prog = {0};
+            outcome = stage_codegen(src.p, workers, &asm_prog, unit);
+            asm_prog_fini(&asm_prog);
+        }
         break;
     }
 
     case STAGE_COMPILE:
-        eprintln("not implemented: " FMTstage, ARGstage(opts.stage));
+        diag_println(&unit->diag, "not implemented: " FMTstage, ARGstage(opts->stage));
+        break;
+
+    case STAGE_JIT: {
+        jit_prog_t jit_prog = {0};
+        if (batch->cache != NULL) {
+            outcome = stage_cached(batch->cache, opts, src, workers, &jit_prog, unit);
+        } else {
+            outcome = stage_jit(src.p, workers, &jit_prog, unit);
+        }
+        if (outcome == FORT_OUTCOME_OK) {
+            const uint64_t start = timing_now();
+            outcome = jit_exec(&jit_prog, &batch->jit, &unit->ret);
+            phase_done(unit, PHASE_EXEC, start);
+            if (outcome != FORT_OUTCOME_OK) {
+                diag_println(&unit->diag, "error: failed to execute generated code");
+            }
+        }
+        jit_prog_fini(&jit_prog);
+        break;
+    }
+    }
+
+    return outcome;
+}
+
+// Each call builds its own lexer, parser and assembler, so files share
+// nothing but the cache and the perf sinks. Tokens and instructions come from
+// the worker's arena, which is reset rather than freed so its chunks stay
+// warm. When the batch has a pool, a single file owns all of the workers.
+static void compile_unit(void* ctx, size_t job, size_t worker) {
+    const batch_t* batch = ctx;
+    unit_t* unit = &batch->units[job];
+    const workers_t workers = {batch->arenas + (batch->pool != NULL ? 0 : worker), batch->pool};
+    const size_t narenas = batch->pool != NULL ? pool_nworkers(batch->pool) : 1;
+
+    const uint64_t file_start = trace_begin();
+    const uint64_t start = timing_now();
+    size_t src_len = 0;
+    char* src = load_src(batch->dirfd, unit->filepath, &src_len, &unit->diag);
+    if (src == NULL) {
+        unit->outcome = FORT_OUTCOME_ERR;
+        return;
+    }
+    phase_done(unit, PHASE_LOAD, start);
+    unit->timing.files = 1;
+    unit->timing.bytes = src_len;
+
+    unit->outcome = compile_src(batch, (buf_t){src, src_len}, &workers, unit);
+    for (size_t i = 0; i < narenas; ++i) {
+        arena_reset(workers.arenas[i]);
+    }
+    fort_free(src);
+
+    trace_end((buf_t){unit->filepath, strlen(unit->filepath)}, "file", file_start);
+}
+
+static void print_diag(FILE* err, const unit_t* unit, bool prefix) {
+    const char* p = unit->diag.buf;
+    const char* end = p + unit->diag.len;
+    while (p < end) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        const int len = (int)(eol - p);
+        if (prefix) {
+            FORT_UNUSED(fprintf(err, "%s: %.*s\n", unit->filepath, len, p));
+        } else {
+            FORT_UNUSED(fprintf(err, "%.*s\n", len, p));
+        }
+        p = eol + 1;
+    }
+}
+
+#define ARENA_CHUNK_SZ (64 * 1024)
+
+// Compiler state that outlives a batch. The command line tool builds one per
+// invocation; the server builds one at startup, and each request sees only its
+// worker's arena and no pool, since the pool is busy serving connections.
+typedef struct {
+    cache_t* cache;
+    pool_t* pool;
+    arena_t** arenas;
+} env_t;
+
+static fort_outcome_t env_init(env_t* env, size_t nworkers) {
+    env->pool = mkpool(nworkers);
+    if (env->pool == NULL) {
+        eprintln("error: failed to start %zu worker threads", nworkers);
+        return FORT_OUTCOME_ERR;
+    }
+
+    env->arenas = fort_alloc(ALLOC_DRIVER, sizeof(arena_t*) * nworkers);
+    for (size_t i = 0; i < nworkers; ++i) {
+        env->arenas[i] = mkarena(ARENA_CHUNK_SZ);
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static void env_fini(env_t* env) {
+    if (env->pool != NULL) {
+        for (size_t i = 0; i < pool_nworkers(env->pool); ++i) {
+            arena_fini(env->arenas[i]);
+        }
+        fort_free(env->arenas);
+        pool_fini(env->pool);
+    }
+    cache_fini(env->cache);
+}
+
+static cache_t* open_cache(const char* dir) {
+    cache_t* cache = mkcache(dir);
+    if (cache == NULL) {
+        eprintln("warning: code cache disabled: cannot use directory %s", dir);
+    }
+
+    return cache;
+}
+
+static FILE* open_trace(int dirfd, const char* path) {
+    const int fd = openat(dirfd, path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    FILE* file = fdopen(fd, "w");
+    if (file == NULL) {
+        FORT_UNUSED(close(fd));
+    }
+
+    return file;
+}
+
+// Compiles every file named in `opts` and writes what the command line tool
+// would print to `out` and `err`. Returns the process exit status.
+static int run_batch(const opts_t* opts, const env_t* env, int dirfd, FILE* out, FILE* err) {
+    const uint64_t start = timing_now();
+    int exit_code = EXIT_SUCCESS;
+
+    // Peaks are process-wide, so a server restarts them for every request.
+    alloc_stats_t alloc_before = {0};
+    alloc_reset_peak();
+    alloc_stats(&alloc_before);
+    batch_t batch = {opts, NULL, {NULL, NULL}, dirfd, env->arenas, NULL, NULL};
+
+    if (opts->stage == STAGE_CODEGEN || opts->stage == STAGE_JIT) {
+        batch.cache = env->cache;
+    }
+
+    if (opts->stage == STAGE_JIT && opts->perf_map) {
+        batch.jit.perf_map = mkperf_map();
+        if (batch.jit.perf_map == NULL) {
+            FORT_UNUSED(fprintf(err, "warning: cannot write perf map\n"));
+        }
+    }
+
+    if (opts->stage == STAGE_JIT && opts->jitdump) {
+        batch.jit.jitdump = mkjitdump();
+        if (batch.jit.jitdump == NULL) {
+            FORT_UNUSED(fprintf(err, "warning: cannot write jitdump\n"));
+        }
+    }
+
+    FILE* trace = NULL;
+    if (opts->trace_path != NULL) {
+        trace = open_trace(dirfd, opts->trace_path);
+        if (trace == NULL) {
+            FORT_UNUSED(fprintf(err, "warning: cannot write trace to %s\n", opts->trace_path));
+        } else {
+            trace_name_thread("main");
+            FORT_UNUSED(trace_start(trace));
+        }
+    }
+    const uint64_t trace_start_ts = trace_begin();
+
+    batch.units = fort_alloc(ALLOC_DRIVER, sizeof(unit_t) * opts->nfiles);
+    for (size_t i = 0; i < opts->nfiles; ++i) {
+        batch.units[i] = (unit_t){
+            .filepath = opts->filepaths[i],
+            .outcome = FORT_OUTCOME_ERR,
+            // The memory report divides by the AST nodes parsed.
+            .count_stats = opts->stats != REPORT_NONE || opts->mem_report != REPORT_NONE,
+            .pipeline = opts->pipeline.npasses > 0 ? &opts->pipeline : NULL,
+        };
+    }
+
+    // Files are spread across the workers; a lone file spreads its functions
+    // across them instead.
+    if (opts->nfiles == 1) {
+        batch.pool = env->pool;
+        compile_unit(&batch, 0, 0);
+    } else if (env->pool != NULL) {
+        FORT_UNUSED(pool_run(env->pool, opts->nfiles, compile_unit, &batch));
+    } else {
+        for (size_t i = 0; i < opts->nfiles; ++i) {
+            compile_unit(&batch, i, 0);
+        }
+    }
+
+    if (trace != NULL) {
+        static const char batch_name[] = "batch";
+        trace_end((buf_t){batch_name, sizeof(batch_name) - 1}, "batch", trace_start_ts);
+        const fort_outcome_t traced = trace_stop();
+        if (fclose(trace) != 0 || traced != FORT_OUTCOME_OK) {
+            FORT_UNUSED(fprintf(err, "warning: failed to write trace to %s\n", opts->trace_path));
+        }
+    }
+
+    const bool batch_mode = opts->nfiles > 1;
+    for (size_t i = 0; i < opts->nfiles; ++i) {
+        const unit_t* unit = &batch.units[i];
+        if (unit->diag.len > 0) {
+            FORT_UNUSED(fflush(out));
+            print_diag(err, unit, batch_mode);
+        }
+        if (unit->outcome != FORT_OUTCOME_OK) {
+            exit_code = EXIT_FAILURE;
+        } else if (opts->stage == STAGE_JIT && batch_mode) {
+            FORT_UNUSED(fprintf(out, "%s: %" PRId32 "\n", unit->filepath, unit->ret));
+        }
+    }
+
+    // A single program behaves as if it had been compiled and run.
+    if (opts->stage == STAGE_JIT && !batch_mode && exit_code == EXIT_SUCCESS) {
+        exit_code = batch.units[0].ret;
+    }
+
+    if (opts->cache_stats) {
+        cache_stats_t stats = {0};
+        if (batch.cache != NULL) {
+            cache_stats(batch.cache, &stats);
+        }
+        FORT_UNUSED(fprintf(err, "cache: hits=%" PRIu64 " misses=%" PRIu64 "\n", stats.hits,
+                            stats.misses));
+    }
+
+    if (opts->stats != REPORT_NONE) {
+        for (size_t i = 0; i < opts->nfiles; ++i) {
+            const unit_t* unit = &batch.units[i];
+            if (opts->stats == REPORT_JSON) {
+                stats_print_json(err, unit->filepath, &unit->stats);
+            } else {
+                stats_print(err, unit->filepath, &unit->stats);
+            }
+        }
+    }
+
+    timing_t timing = {0};
+    opt_stats_t opt = {0};
+    size_t nodes = 0;
+    for (size_t i = 0; i < opts->nfiles; ++i) {
+        timing_merge(&timing, &batch.units[i].timing);
+        opt_stats_merge(&opt, &batch.units[i].opt);
+        nodes += (size_t)stats_ast_nodes(&batch.units[i].stats);
+    }
+
+    if (opts->time_report != REPORT_NONE) {
+        const uint64_t wall_ns = timing_now() - start;
+        if (opts->time_report == REPORT_JSON) {
+            timing_print_json(err, &timing, wall_ns);
+        } else {
+            timing_print(err, &timing, wall_ns);
+        }
+        if (opts->pipeline.npasses > 0 && opts->time_report == REPORT_JSON) {
+            opt_print_json(err, &opt);
+        } else if (opts->pipeline.npasses > 0) {
+            opt_print(err, &opt);
+        }
+    }
+
+    if (opts->mem_report != REPORT_NONE) {
+        alloc_stats_t alloc_after = {0};
+        alloc_stats(&alloc_after);
+        if (opts->mem_report == REPORT_JSON) {
+            alloc_print_json(err, &alloc_before, &alloc_after, timing.tokens, nodes);
+        } else {
+            alloc_print(err, &alloc_before, &alloc_after, timing.tokens, nodes);
+        }
+    }
+
+    fort_free(batch.units);
+    jitdump_fini(batch.jit.jitdump);
+    perf_map_fini(batch.jit.perf_map);
+
+    return exit_code;
+}
+
+// Moves what a memstream collected into a buffer from fort_alloc, as
+// server_reply_t expects.
+static void take_stream(char* buf, size_t len, char** p, size_t* p_len) {
+    *p = NULL;
+    *p_len = 0;
+    if (buf != NULL && len > 0) {
+        *p = fort_alloc(ALLOC_DRIVER, len);
+        memcpy(*p, buf, len);
+        *p_len = len;
+    }
+    free(buf);
+}
+
+// getopt keeps its state in globals, so requests parse their options one at
+// a time.
+static pthread_mutex_t request_opts_mu = PTHREAD_MUTEX_INITIALIZER;
+// Traces, perf maps, jitdumps and memory reports cover the whole process, so
+// a request that asks for one runs while no other request does.
+static pthread_rwlock_t request_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static bool needs_whole_process(const opts_t* opts) {
+    return opts->trace_path != NULL || opts->perf_map || opts->jitdump ||
+           opts->mem_report != REPORT_NONE;
+}
+
+// A request is the client's working directory followed by its argv. Options
+// are parsed exactly as on the command line, except that the cache directory
+// and the number of jobs are fixed when the server starts.
+static void serve_request(void* ctx, size_t worker, int argc, char* argv[], server_reply_t* reply) {
+    const env_t* server_env = ctx;
+    const env_t env = {server_env->cache, NULL, server_env->arenas + worker};
+
+    char* out_buf = NULL;
+    size_t out_len = 0;
+    char* err_buf = NULL;
+    size_t err_len = 0;
+    FILE* out = open_memstream(&out_buf, &out_len);
+    FILE* err = open_memstream(&err_buf, &err_len);
+    if (out == NULL || err == NULL) {
+        if (out != NULL) {
+            FORT_UNUSED(fclose(out));
+        }
+        if (err != NULL) {
+            FORT_UNUSED(fclose(err));
+        }
+        free(out_buf);
+        free(err_buf);
+        reply->status = EXIT_FAILURE;
+        return;
+    }
+
+    opts_t opts = {.stage = STAGE_LEX, .jobs = 1};
+    FORT_UNUSED(pthread_mutex_lock(&request_opts_mu));
+    optind = 0;
+    opterr = 0;
+    const fort_outcome_t parsed = parse_opts(argc - 1, argv + 1, &opts);
+    FORT_UNUSED(pthread_mutex_unlock(&request_opts_mu));
+
+    const int dirfd = open(argv[0], O_RDONLY | O_DIRECTORY);
+    if (dirfd < 0) {
+        FORT_UNUSED(fprintf(err, "error: server cannot open directory %s\n", argv[0]));
+        reply->status = EXIT_FAILURE;
+    } else if (parsed != FORT_OUTCOME_OK || opts.server) {
+        FORT_UNUSED(fprintf(err, "error: server rejected the request options\n"));
+        reply->status = EXIT_FAILURE;
+    } else if (needs_whole_process(&opts)) {
+        FORT_UNUSED(pthread_rwlock_wrlock(&request_lock));
+        reply->status = run_batch(&opts, &env, dirfd, out, err);
+        FORT_UNUSED(pthread_rwlock_unlock(&request_lock));
+    } else {
+        FORT_UNUSED(pthread_rwlock_rdlock(&request_lock));
+        reply->status = run_batch(&opts, &env, dirfd, out, err);
+        FORT_UNUSED(pthread_rwlock_unlock(&request_lock));
+    }
+
+    if (dirfd >= 0) {
+        FORT_UNUSED(close(dirfd));
+    }
+    FORT_UNUSED(fclose(out));
+    FORT_UNUSED(fclose(err));
+    take_stream(out_buf, out_len, &reply->out, &reply->out_len);
+    take_stream(err_buf, err_len, &reply->err, &reply->err_len);
+}
+
+static server_t* running_server = NULL;
+
+static void stop_server(int sig) {
+    FORT_UNUSED(sig);
+    server_stop(running_server);
+}
+
+static int run_server(const opts_t* opts, const char* socket_path) {
+    env_t env = {0};
+    if (opts->cache_dir != NULL) {
+        env.cache = open_cache(opts->cache_dir);
+    }
+
+    if (env_init(&env, opts->jobs) != FORT_OUTCOME_OK) {
+        env_fini(&env);
+        return EXIT_FAILURE;
+    }
+
+    running_server = mkserver(socket_path);
+    if (running_server == NULL) {
+        char msg[DIAG_MAX];
+        if (strerror_r(errno, msg, sizeof(msg)) != 0) {
+            msg[0] = '\0';
+        }
+        eprintln("error: cannot listen on %s: %s", socket_path, msg);
+        env_fini(&env);
+        return EXIT_FAILURE;
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = stop_server;
+    FORT_UNUSED(sigemptyset(&sa.sa_mask));
+    FORT_UNUSED(sigaction(SIGINT, &sa, NULL));
+    FORT_UNUSED(sigaction(SIGTERM, &sa, NULL));
+
+    eprintln("fort: listening on %s", socket_path);
+    const fort_outcome_t outcome = server_run(running_server, env.pool, serve_request, &env);
+
+    server_fini(running_server);
+    running_server = NULL;
+    env_fini(&env);
+
+    return outcome == FORT_OUTCOME_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int run_client(int argc, char* argv[], const char* socket_path) {
+    int status = EXIT_FAILURE;
+    if (server_forward(socket_path, argc, argv, &status) != FORT_OUTCOME_OK) {
+        eprintln("error: no fort server answering on %s", socket_path);
+        return EXIT_FAILURE;
+    }
+
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    opts_t opts = {.stage = STAGE_LEX, .cache_dir = getenv("FORT_CACHE_DIR"), .jobs = 1};
+    if (parse_opts(argc, argv, &opts) != FORT_OUTCOME_OK) {
+        print_usage();
         return EXIT_FAILURE;
     }
 
-    free(src);
+    char socket_buf[SERVER_PATH_MAX];
+    const char* socket_path = opts.socket_path;
+    if (socket_path == NULL && (opts.server || opts.client)) {
+        socket_path = server_default_path(socket_buf, sizeof(socket_buf), opts.server);
+        if (socket_path == NULL) {
+            eprintln("error: cannot pick a private socket path; use --socket=PATH");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (opts.server) {
+        return run_server(&opts, socket_path);
+    }
+
+    if (opts.client) {
+        return run_client(argc, argv, socket_path);
+    }
+
+    env_t env = {0};
+    if (opts.cache_dir != NULL && (opts.stage == STAGE_CODEGEN || opts.stage == STAGE_JIT)) {
+        env.cache = open_cache(opts.cache_dir);
+    }
+
+    int exit_code = EXIT_FAILURE;
+    // A single file can use every worker for its functions.
+    const size_t nworkers = opts.nfiles > 1 && opts.nfiles < opts.jobs ? opts.nfiles : opts.jobs;
+    if (env_init(&env, nworkers) == FORT_OUTCOME_OK) {
+        exit_code = run_batch(&opts, &env, AT_FDCWD, stdout, stderr);
+    }
+
+    env_fini(&env);
     return exit_code;
 }
@@ -0,0 +1,54 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include <stdlib.h>    // for EXIT_FAILURE
+#include <string.h>    // for strcmp, strncmp
+
+#include "common.h"    // for eprintln, FORT_OUTCOME_OK
+#include "server.h"    // for server_default_path, server_forward, SERVER_PATH_MAX
+
+// Sends its arguments to a running `fort --server`, exactly as
+// `fort --client` does, but links none of the compiler, so that a request
+// costs little more than starting a small process.
+//
+//   fort-client [--socket=PATH] [OPTION]... FILE...
+//
+// The server parses the options, so any fort option works here.
+
+static const char SOCKET_OPT[] = "--socket";
+
+// The socket named on the command line in either getopt form, or NULL.
+static const char* find_socket(int argc, char* argv[]) {
+    const size_t opt_len = sizeof(SOCKET_OPT) - 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--") == 0) {
+            break;
+        }
+        if (strncmp(argv[i], SOCKET_OPT, opt_len) == 0 && argv[i][opt_len] == '=') {
+            return argv[i] + opt_len + 1;
+        }
+        if (strcmp(argv[i], SOCKET_OPT) == 0 && i + 1 < argc) {
+            return argv[i + 1];
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    char socket_buf[SERVER_PATH_MAX];
+    const char* socket_path = find_socket(argc, argv);
+    if (socket_path == NULL) {
+        socket_path = server_default_path(socket_buf, sizeof(socket_buf), false);
+    }
+    if (socket_path == NULL) {
+        eprintln("error: cannot pick a private socket path; use --socket=PATH");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_FAILURE;
+    if (server_forward(socket_path, argc, argv, &status) != FORT_OUTCOME_OK) {
+        eprintln("error: no fort server answering on %s", socket_path);
+        return EXIT_FAILURE;
+    }
+
+    return status;
+}
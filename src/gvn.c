@@ -0,0 +1,302 @@
+#include "gvn.h"
+
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for size_t, NULL
+#include <stdint.h>    // for uint32_t, uint64_t
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for asm_func_t, inst_t, op_t, INST_MOV, INST_XOR, OP_IMM, OP_REG
+#include "cfg.h"       // for cfg_t, dom_t, block_t, CFG_NONE
+#include "live.h"      // for inst_regs_t, inst_regs
+
+// Value number 0 means "unknown".
+#define VN_NONE 0
+
+#define GVN_TABLE_MIN 16
+
+typedef enum {
+    VALUE_CONST,
+    VALUE_XOR,
+} value_op_t;
+
+// A hash-consed value: an operation and the numbers of its operands, or the
+// bits of a constant. Slots with vn == VN_NONE are empty.
+typedef struct {
+    value_op_t op;
+    size_t vn;
+    uint64_t a;
+    uint64_t b;
+} value_key_t;
+
+// What a register held before an instruction in the current block wrote it.
+typedef struct {
+    size_t reg;
+    size_t vn;
+    size_t depth;
+} undo_t;
+
+typedef struct {
+    value_key_t* keys;
+    size_t cap;
+    size_t next_vn;
+    // The value in each register and the depth in the dominator tree of the
+    // block that put it there.
+    size_t* reg_vn;
+    size_t* reg_depth;
+    undo_t* undo;
+    size_t nundo;
+    size_t depth;
+    // Values set by blocks shallower than this are not known to hold here.
+    size_t barrier;
+} gvn_t;
+
+// A block on the dominator tree walk: the child to visit next, and how much
+// of the undo log and which barrier to restore when it is left.
+typedef struct {
+    size_t block;
+    size_t next;
+    size_t mark;
+    size_t barrier;
+} frame_t;
+
+static uint64_t hash_key(value_op_t op, uint64_t a, uint64_t b) {
+    // The finalizer of splitmix64 over a simple combination.
+    uint64_t h = (uint64_t)op * 0x9E3779B97F4A7C15ULL ^ a ^ (b * 0xC2B2AE3D27D4EB4FULL);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+
+    return h;
+}
+
+static size_t intern(gvn_t* gvn, value_op_t op, uint64_t a, uint64_t b) {
+    size_t slot = (size_t)hash_key(op, a, b) & (gvn->cap - 1);
+    for (;;) {
+        value_key_t* key = &gvn->keys[slot];
+        if (key->vn == VN_NONE) {
+            *key = (value_key_t){op, gvn->next_vn++, a, b};
+            return key->vn;
+        }
+        if (key->op == op && key->a == a && key->b == b) {
+            return key->vn;
+        }
+        slot = (slot + 1) & (gvn->cap - 1);
+    }
+}
+
+static size_t current(const gvn_t* gvn, size_t reg) {
+    return gvn->reg_depth[reg] >= gvn->barrier ? gvn->reg_vn[reg] : VN_NONE;
+}
+
+static void set_reg(gvn_t* gvn, size_t reg, size_t vn) {
+    gvn->undo[gvn->nundo++] = (undo_t){reg, gvn->reg_vn[reg], gvn->reg_depth[reg]};
+    gvn->reg_vn[reg] = vn;
+    gvn->reg_depth[reg] = gvn->depth;
+}
+
+// A register nothing is known about holds some value of its own.
+static size_t read_reg(gvn_t* gvn, size_t reg) {
+    size_t vn = current(gvn, reg);
+    if (vn == VN_NONE) {
+        vn = gvn->next_vn++;
+        set_reg(gvn, reg, vn);
+    }
+
+    return vn;
+}
+
+static size_t read_op(gvn_t* gvn, const op_t* op) {
+    if (op->kind == OP_IMM) {
+        return intern(gvn, VALUE_CONST, (uint32_t)op->u.imm.val, 0);
+    }
+
+    return read_reg(gvn, (size_t)op->u.reg);
+}
+
+// Returns whether `inst` is redundant; otherwise records what it computes.
+static bool number_inst(gvn_t* gvn, const inst_t* inst) {
+    const op_t* dst = NULL;
+    size_t vn = VN_NONE;
+    switch (inst->kind) {
+    case INST_MOV:
+        dst = &inst->u.mov.dst;
+        if (dst->kind == OP_REG) {
+            vn = read_op(gvn, &inst->u.mov.src);
+        }
+        break;
+    case INST_XOR: {
+        dst = &inst->u.xor.dst;
+        const op_t* src = &inst->u.xor.src;
+        if (dst->kind != OP_REG) {
+            break;
+        }
+        if (src->kind == OP_REG && src->u.reg == dst->u.reg) {
+            vn = intern(gvn, VALUE_CONST, 0, 0);
+            break;
+        }
+        // Commutative, so the operands are put in a fixed order.
+        size_t a = read_op(gvn, src);
+        size_t b = read_reg(gvn, (size_t)dst->u.reg);
+        if (a > b) {
+            const size_t tmp = a;
+            a = b;
+            b = tmp;
+        }
+        vn = intern(gvn, VALUE_XOR, a, b);
+        break;
+    }
+    case INST_RET:
+    case INST_KIND_COUNT:
+        break;
+    }
+
+    if (vn == VN_NONE) {
+        return false;
+    }
+
+    const size_t reg = (size_t)dst->u.reg;
+    if (current(gvn, reg) == vn) {
+        return true;
+    }
+    set_reg(gvn, reg, vn);
+
+    return false;
+}
+
+static size_t count_regs(const asm_func_t* func, size_t* ninsts) {
+    size_t nregs = 0;
+    *ninsts = 0;
+    for (const inst_t* inst = func->inst; inst != NULL; inst = inst->next) {
+        inst_regs_t regs;
+        inst_regs(inst, &regs);
+        for (size_t u = 0; u < regs.nuses; ++u) {
+            nregs = (size_t)regs.uses[u] >= nregs ? (size_t)regs.uses[u] + 1 : nregs;
+        }
+        if (regs.has_def) {
+            nregs = (size_t)regs.def >= nregs ? (size_t)regs.def + 1 : nregs;
+        }
+        (*ninsts)++;
+    }
+
+    return nregs;
+}
+
+// A block continues its dominator's knowledge only when it cannot be entered
+// from anywhere else.
+static bool extends_idom(const cfg_t* cfg, const dom_t* dom, size_t b) {
+    const block_t* block = &cfg->blocks[b];
+    return dom->idom[b] != CFG_NONE && block->npreds == 1 &&
+           cfg->preds[block->pred_start] == dom->idom[b];
+}
+
+size_t gvn_find(const asm_func_t* func, const cfg_t* cfg, const dom_t* dom, bool* redundant) {
+    size_t ninsts = 0;
+    const size_t nregs = count_regs(func, &ninsts);
+    for (size_t i = 0; i < ninsts; ++i) {
+        redundant[i] = false;
+    }
+    if (cfg->nrpo == 0) {
+        return 0;
+    }
+
+    // An xor with an immediate interns two keys, the constant and the xor, so
+    // room for four per instruction keeps the table at most half full.
+    gvn_t gvn = {0};
+    gvn.cap = GVN_TABLE_MIN;
+    while (gvn.cap < 4 * ninsts) {
+        gvn.cap *= 2;
+    }
+    gvn.keys = fort_alloc(ALLOC_CODEGEN, gvn.cap * sizeof(value_key_t));
+    for (size_t i = 0; i < gvn.cap; ++i) {
+        gvn.keys[i] = (value_key_t){0};
+    }
+    gvn.next_vn = VN_NONE + 1;
+    gvn.reg_vn = fort_alloc(ALLOC_CODEGEN, (nregs > 0 ? nregs : 1) * sizeof(size_t));
+    gvn.reg_depth = fort_alloc(ALLOC_CODEGEN, (nregs > 0 ? nregs : 1) * sizeof(size_t));
+    for (size_t r = 0; r < nregs; ++r) {
+        gvn.reg_vn[r] = VN_NONE;
+        gvn.reg_depth[r] = 0;
+    }
+    // Each instruction writes at most three registers: its destination, and
+    // each operand the first time it is read.
+    gvn.undo = fort_alloc(ALLOC_CODEGEN, (3 * ninsts + 1) * sizeof(undo_t));
+
+    // Where each block's instructions start in list order, and the dominator
+    // tree as first-child and next-sibling links.
+    const size_t nblocks = cfg->nblocks;
+    size_t* start = fort_alloc(ALLOC_CODEGEN, nblocks * sizeof(size_t));
+    size_t* child = fort_alloc(ALLOC_CODEGEN, nblocks * sizeof(size_t));
+    size_t* sibling = fort_alloc(ALLOC_CODEGEN, nblocks * sizeof(size_t));
+    size_t pos = 0;
+    for (size_t b = 0; b < nblocks; ++b) {
+        start[b] = pos;
+        pos += cfg->blocks[b].ninsts;
+        child[b] = CFG_NONE;
+        sibling[b] = CFG_NONE;
+    }
+    for (size_t b = nblocks; b > 0; --b) {
+        const size_t idom = dom->idom[b - 1];
+        if (idom != CFG_NONE) {
+            sibling[b - 1] = child[idom];
+            child[idom] = b - 1;
+        }
+    }
+
+    // Preorder walk with an explicit stack.
+    frame_t* stack = fort_alloc(ALLOC_CODEGEN, nblocks * sizeof(frame_t));
+    size_t depth = 0;
+    size_t found = 0;
+    size_t enter = cfg->rpo[0];
+    for (;;) {
+        if (enter != CFG_NONE) {
+            stack[depth] = (frame_t){enter, child[enter], gvn.nundo, gvn.barrier};
+            depth++;
+            gvn.depth = depth;
+            if (!extends_idom(cfg, dom, enter)) {
+                gvn.barrier = depth;
+            }
+
+            const block_t* block = &cfg->blocks[enter];
+            const inst_t* inst = block->first;
+            for (size_t i = 0; i < block->ninsts; ++i, inst = inst->next) {
+                if (number_inst(&gvn, inst)) {
+                    redundant[start[enter] + i] = true;
+                    found++;
+                }
+            }
+        }
+
+        frame_t* top = &stack[depth - 1];
+        if (top->next != CFG_NONE) {
+            enter = top->next;
+            top->next = sibling[enter];
+            continue;
+        }
+
+        while (gvn.nundo > top->mark) {
+            const undo_t* undo = &gvn.undo[--gvn.nundo];
+            gvn.reg_vn[undo->reg] = undo->vn;
+            gvn.reg_depth[undo->reg] = undo->depth;
+        }
+        gvn.barrier = top->barrier;
+        depth--;
+        gvn.depth = depth;
+        if (depth == 0) {
+            break;
+        }
+        enter = CFG_NONE;
+    }
+
+    fort_free(stack);
+    fort_free(sibling);
+    fort_free(child);
+    fort_free(start);
+    fort_free(gvn.undo);
+    fort_free(gvn.reg_depth);
+    fort_free(gvn.reg_vn);
+    fort_free(gvn.keys);
+
+    return found;
+}
@@ -0,0 +1,24 @@
+#ifndef FORT_GVN_H
+#define FORT_GVN_H
+
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+
+#include "assemble.h"  // for asm_func_t
+#include "cfg.h"       // for cfg_t, dom_t
+
+// Global value numbering. Every value a register can hold gets a number; a
+// constant or an operation on numbered operands is hash-consed, so computing
+// it twice yields the same number. Blocks are visited in dominator tree
+// order and an instruction is redundant when its destination already holds
+// the number it would compute.
+//
+// Registers are not SSA values: they can be written on any path. A block
+// therefore starts from what its immediate dominator knew only when that
+// dominator is its sole predecessor, and from nothing otherwise.
+//
+// Sets redundant[i] for the i-th instruction of `func` in list order, which
+// must have room for every instruction, and returns how many it set.
+size_t gvn_find(const asm_func_t* func, const cfg_t* cfg, const dom_t* dom, bool* redundant);
+
+#endif // FORT_GVN_H
@@ -0,0 +1,237 @@
+#define _DEFAULT_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "jit.h"
+
+#include <stdint.h>    // for uint8_t, int32_t, uint32_t
+#include <stddef.h>    // for NULL, size_t
+#include <string.h>    // for memcmp, memcpy
+#include <unistd.h>    // for sysconf, _SC_PAGESIZE
+#include <sys/mman.h>  // for mmap, mprotect, munmap, MAP_ANONYMOUS, MAP_FAILED
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_EMIT
+#include "assemble.h"  // for inst_t, op_t, asm_func_t, asm_prog_t, INST_MOV, INST_XOR
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_OUTCOME_FATAL, fort_outcome_t
+#include "perf.h"      // for perf_map_add, jitdump_code_load
+
+#define X86_MOV_IMM32_REG 0xB8
+#define X86_MOV_REG_RM32 0x89
+#define X86_XOR_REG_RM32 0x31
+#define X86_MODRM_REG_REG 0xC0
+#define X86_RET 0xC3
+
+// Longest encoding among the instructions we emit: B8+rd id.
+#define X86_INST_MAX_LEN 5
+
+struct jit {
+    asm_prog_t* asm_prog;
+};
+
+typedef struct {
+    uint8_t* p;
+    size_t len;
+} code_buf_t;
+
+static inline void emit_u8(code_buf_t* buf, uint8_t b) {
+    buf->p[buf->len++] = b;
+}
+
+static inline void emit_imm32(code_buf_t* buf, int32_t val) {
+    const uint32_t u = (uint32_t)val;
+    emit_u8(buf, (uint8_t)(u & 0xFF));
+    emit_u8(buf, (uint8_t)((u >> 8) & 0xFF));
+    emit_u8(buf, (uint8_t)((u >> 16) & 0xFF));
+    emit_u8(buf, (uint8_t)((u >> 24) & 0xFF));
+}
+
+static fort_outcome_t reg_code(reg_t reg, uint8_t* code) {
+    switch (reg) {
+    case REG_EAX:
+        *code = 0;
+        return FORT_OUTCOME_OK;
+    default:
+        return FORT_OUTCOME_FATAL;
+    }
+}
+
+static fort_outcome_t encode_mov(code_buf_t* buf, const op_t* src, const op_t* dst) {
+    if (dst->kind != OP_REG) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    uint8_t dst_code = 0;
+    FORT_OUTCOME_NOK_RET(reg_code(dst->u.reg, &dst_code));
+
+    switch (src->kind) {
+    case OP_IMM:
+        emit_u8(buf, (uint8_t)(X86_MOV_IMM32_REG + dst_code));
+        emit_imm32(buf, src->u.imm.val);
+        return FORT_OUTCOME_OK;
+    case OP_REG: {
+        uint8_t src_code = 0;
+        FORT_OUTCOME_NOK_RET(reg_code(src->u.reg, &src_code));
+        emit_u8(buf, X86_MOV_REG_RM32);
+        emit_u8(buf, (uint8_t)(X86_MODRM_REG_REG | (src_code << 3) | dst_code));
+        return FORT_OUTCOME_OK;
+    }
+    default:
+        return FORT_OUTCOME_FATAL;
+    }
+}
+
+static fort_outcome_t encode_xor(code_buf_t* buf, const op_t* src, const op_t* dst) {
+    if (src->kind != OP_REG || dst->kind != OP_REG) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    uint8_t src_code = 0;
+    uint8_t dst_code = 0;
+    FORT_OUTCOME_NOK_RET(reg_code(src->u.reg, &src_code));
+    FORT_OUTCOME_NOK_RET(reg_code(dst->u.reg, &dst_code));
+    emit_u8(buf, X86_XOR_REG_RM32);
+    emit_u8(buf, (uint8_t)(X86_MODRM_REG_REG | (src_code << 3) | dst_code));
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t encode_inst(code_buf_t* buf, const inst_t* inst) {
+    switch (inst->kind) {
+    case INST_MOV:
+        return encode_mov(buf, &inst->u.mov.src, &inst->u.mov.dst);
+    case INST_RET:
+        emit_u8(buf, X86_RET);
+        return FORT_OUTCOME_OK;
+    case INST_XOR:
+        return encode_xor(buf, &inst->u.xor.src, &inst->u.xor.dst);
+    default:
+        return FORT_OUTCOME_FATAL;
+    }
+}
+
+static fort_outcome_t encode_func(const asm_func_t* asm_func, jit_func_t* jit_func) {
+    size_t ninst = 0;
+    for (const inst_t* inst = asm_func->inst; inst != NULL; inst = inst->next) {
+        ninst++;
+    }
+
+    const size_t cap = ninst * X86_INST_MAX_LEN;
+    code_buf_t buf = {fort_alloc(ALLOC_EMIT, cap + asm_func->name.len + 1), 0};
+
+    for (const inst_t* inst = asm_func->inst; inst != NULL; inst = inst->next) {
+        fort_outcome_t outcome = encode_inst(&buf, inst);
+        if (outcome != FORT_OUTCOME_OK) {
+            fort_free(buf.p);
+            return outcome;
+        }
+    }
+
+    char* name = (char*)buf.p + buf.len;
+    memcpy(name, asm_func->name.p, asm_func->name.len);
+    name[asm_func->name.len] = '\0';
+
+    jit_func->name = (buf_t){name, asm_func->name.len};
+    jit_func->code = buf.p;
+    jit_func->len = buf.len;
+
+    return FORT_OUTCOME_OK;
+}
+
+jit_t* mkjit(asm_prog_t* asm_prog) {
+    jit_t* jit = fort_alloc(ALLOC_EMIT, sizeof(jit_t));
+    jit->asm_prog = asm_prog;
+
+    return jit;
+}
+
+void jit_fini(jit_t* jit) {
+    fort_free(jit);
+}
+
+// Calls between functions are not supported yet, so only the entry point is
+// encoded: `main` if the program has one, otherwise its first function.
+static const asm_func_t* entry_func(const asm_prog_t* asm_prog) {
+    static const char entry[] = "main";
+    const asm_func_t* func = &asm_prog->func;
+    // Tested at the bottom: the first function is never NULL, and checking
+    // it anyway makes gcc -O2 warn that encode_func may dereference NULL.
+    do {
+        if (func->name.len == sizeof(entry) - 1 && memcmp(func->name.p, entry, func->name.len) == 0) {
+            return func;
+        }
+        func = func->next;
+    } while (func != NULL);
+
+    return &asm_prog->func;
+}
+
+fort_outcome_t jit_run(jit_t* jit, jit_prog_t* jit_prog) {
+    fort_outcome_t outcome = FORT_OUTCOME_FATAL;
+
+    if (jit == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    if (jit_prog == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    outcome = encode_func(entry_func(jit->asm_prog), &jit_prog->func);
+    FORT_OUTCOME_NOK_RET(outcome);
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t announce(const jit_func_t* func, const void* addr, const jit_opts_t* opts) {
+    if (opts->perf_map != NULL) {
+        FORT_OUTCOME_NOK_RET(perf_map_add(opts->perf_map, addr, func->len, func->name));
+    }
+
+    if (opts->jitdump != NULL) {
+        FORT_OUTCOME_NOK_RET(jitdump_code_load(opts->jitdump, addr, func->len, func->name));
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+fort_outcome_t jit_exec(const jit_prog_t* jit_prog, const jit_opts_t* opts, int32_t* ret) {
+    if (jit_prog == NULL || opts == NULL || ret == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    const jit_func_t* func = &jit_prog->func;
+    if (func->code == NULL || func->len == 0) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t map_sz = (func->len + page_sz - 1) / page_sz * page_sz;
+    void* mem = mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    memcpy(mem, func->code, func->len);
+    if (mprotect(mem, map_sz, PROT_READ | PROT_EXEC) < 0) {
+        FORT_UNUSED(munmap(mem, map_sz));
+        return FORT_OUTCOME_ERR;
+    }
+
+    fort_outcome_t outcome = announce(func, mem, opts);
+    if (outcome != FORT_OUTCOME_OK) {
+        FORT_UNUSED(munmap(mem, map_sz));
+        return outcome;
+    }
+
+    // ISO C has no object-to-function pointer conversion; POSIX guarantees this
+    // one works (see dlsym).
+    int32_t (*entry)(void) = NULL;
+    memcpy(&entry, &mem, sizeof(entry));
+    *ret = entry();
+
+    FORT_UNUSED(munmap(mem, map_sz));
+
+    return FORT_OUTCOME_OK;
+}
+
+void jit_prog_fini(jit_prog_t* jit_prog) {
+    fort_free(jit_prog->func.code);
+    jit_prog->func = (jit_func_t){0};
+}
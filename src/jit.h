@@ -0,0 +1,42 @@
+#ifndef FORT_JIT_H
+#define FORT_JIT_H
+
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for int32_t, uint8_t
+
+#include "assemble.h"  // for asm_prog_t
+#include "common.h"    // for buf_t, fort_outcome_t
+#include "perf.h"      // for jitdump_t, perf_map_t
+
+typedef struct jit jit_t;
+
+// Machine code for a single function. `code` owns both the instruction bytes
+// and a NUL-terminated copy of the function name, which `name` points into.
+typedef struct {
+    buf_t name;
+    uint8_t* code;
+    size_t len;
+} jit_func_t;
+
+typedef struct {
+    jit_func_t func;
+} jit_prog_t;
+
+// Where to announce mapped code for perf; NULL skips it. Both sinks may be
+// shared by concurrent jit_exec calls.
+typedef struct {
+    perf_map_t* perf_map;
+    jitdump_t* jitdump;
+} jit_opts_t;
+
+jit_t* mkjit(asm_prog_t* asm_prog);
+
+void jit_fini(jit_t* jit);
+
+fort_outcome_t jit_run(jit_t* jit, jit_prog_t* jit_prog);
+
+fort_outcome_t jit_exec(const jit_prog_t* jit_prog, const jit_opts_t* opts, int32_t* ret);
+
+void jit_prog_fini(jit_prog_t* jit_prog);
+
+#endif // FORT_JIT_H
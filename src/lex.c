@@ -3,9 +3,9 @@
 #include <stdbool.h>  // for bool
 #include <stddef.h>   // for NULL, size_t
 #include <stdint.h>   // for uint32_t
-#include <stdlib.h>   // for free, malloc
 #include <string.h>   // for strncmp
 
+#include "alloc.h"    // for fort_alloc, fort_alloc_from, fort_free, ALLOC_LEX
 #include "common.h"   // for FORT_UNUSED, FORT_OUTCOME_ERR, FORT_OUTCOME_OK
 
 typedef struct {
@@ -165,7 +165,7 @@ static tok_t lexer_next(lexer_t* lexer) {
 }
 
 lexer_t* mklexer(const char* const src, const size_t len) {
-    lexer_t* lexer = malloc(sizeof(lexer_t));
+    lexer_t* lexer = fort_alloc(ALLOC_LEX, sizeof(lexer_t));
 
     lexer->src = src;
     FORT_UNUSED(len);
@@ -177,17 +177,18 @@ lexer_t* mklexer(const char* const src, const size_t len) {
 }
 
 void lexer_fini(lexer_t* lexer) {
-    free(lexer);
+    fort_free(lexer);
 }
 
 fort_outcome_t lexer_run(lexer_t* lexer, tok_stream_t* toks) {
     tok_t* ip = &toks->head;
 
     for (;;) {
-        tok_t* tok = malloc(sizeof(tok_t));
+        tok_t* tok = fort_alloc_from(toks->arena, ALLOC_LEX, sizeof(tok_t));
         *tok = lexer_next(lexer);
         ip->next = tok;
         ip = ip->next;
+        toks->ntoks++;
 
         if (tok->type == TOKT_ERROR) {
             return FORT_OUTCOME_ERR;
@@ -204,10 +205,14 @@ fort_outcome_t lexer_run(lexer_t* lexer, tok_stream_t* toks) {
 }
 
 void tok_stream_fini(tok_stream_t* toks) {
+    if (toks->arena != NULL) {
+        return;
+    }
+
     tok_t* tok = toks->head.next;
     while (tok != NULL) {
         tok_t* next = tok->next;
-        free(tok);
+        fort_free(tok);
         tok = next;
     }
 }
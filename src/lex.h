@@ -4,6 +4,7 @@
 #include <stddef.h>  // for size_t
 #include <stdint.h>  // for uint32_t
 
+#include "arena.h"   // for arena_t
 #include "common.h"  // for buf_t, fort_outcome_t
 
 typedef struct lexer lexer_t;
@@ -21,6 +22,7 @@ typedef enum {
     TOKT_SEMICOLON,
     TOKT_EOF,
     TOKT_ERROR,
+    TOKT_COUNT,
 } tokt_t;
 
 typedef struct tok {
@@ -30,9 +32,13 @@ typedef struct tok {
     struct tok* next;
 } tok_t;
 
+// Tokens are malloc'd one by one unless `arena` is set, in which case they
+// are carved out of it and live until the arena is reset.
 typedef struct {
     tok_t head;
     tok_t* next;
+    arena_t* arena;
+    size_t ntoks;
 } tok_stream_t;
 
 lexer_t* mklexer(const char* src, size_t len);
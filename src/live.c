@@ -0,0 +1,179 @@
+#include "live.h"
+
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for size_t, NULL
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for inst_t, op_t, INST_MOV, INST_RET, INST_XOR, OP_REG, REG_EAX
+#include "bitset.h"    // for bitset_set, bitset_clear, bitset_union, bitset_transfer
+#include "cfg.h"       // for cfg_t, block_t, cfg_reachable
+#include "common.h"    // for FORT_UNUSED
+
+void inst_regs(const inst_t* inst, inst_regs_t* regs) {
+    *regs = (inst_regs_t){0};
+
+    switch (inst->kind) {
+    case INST_MOV:
+        if (inst->u.mov.src.kind == OP_REG) {
+            regs->uses[regs->nuses++] = inst->u.mov.src.u.reg;
+        }
+        if (inst->u.mov.dst.kind == OP_REG) {
+            regs->def = inst->u.mov.dst.u.reg;
+            regs->has_def = true;
+        }
+        break;
+    case INST_XOR: {
+        const op_t* src = &inst->u.xor.src;
+        const op_t* dst = &inst->u.xor.dst;
+        // xor %r, %r reads nothing: the result is zero whatever %r held.
+        const bool idiom = src->kind == OP_REG && dst->kind == OP_REG && src->u.reg == dst->u.reg;
+        if (!idiom && src->kind == OP_REG) {
+            regs->uses[regs->nuses++] = src->u.reg;
+        }
+        if (dst->kind == OP_REG) {
+            if (!idiom) {
+                regs->uses[regs->nuses++] = dst->u.reg;
+            }
+            regs->def = dst->u.reg;
+            regs->has_def = true;
+        }
+        break;
+    }
+    case INST_RET:
+        // The return value.
+        regs->uses[regs->nuses++] = REG_EAX;
+        break;
+    case INST_KIND_COUNT:
+        break;
+    }
+}
+
+void live_step(const inst_t* inst, bitset_word_t* live) {
+    inst_regs_t regs;
+    inst_regs(inst, &regs);
+    if (regs.has_def) {
+        bitset_clear(live, (size_t)regs.def);
+    }
+    for (size_t i = 0; i < regs.nuses; ++i) {
+        bitset_set(live, (size_t)regs.uses[i]);
+    }
+}
+
+static size_t count_regs(const cfg_t* cfg) {
+    size_t nregs = 0;
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        const inst_t* inst = cfg->blocks[b].first;
+        for (size_t i = 0; i < cfg->blocks[b].ninsts; ++i, inst = inst->next) {
+            inst_regs_t regs;
+            inst_regs(inst, &regs);
+            for (size_t u = 0; u < regs.nuses; ++u) {
+                if ((size_t)regs.uses[u] >= nregs) {
+                    nregs = (size_t)regs.uses[u] + 1;
+                }
+            }
+            if (regs.has_def && (size_t)regs.def >= nregs) {
+                nregs = (size_t)regs.def + 1;
+            }
+        }
+    }
+
+    return nregs;
+}
+
+static bitset_word_t* block_uses(const live_t* live, size_t block) {
+    return live->sets + (4 * block) * live->nwords;
+}
+
+static bitset_word_t* block_defs(const live_t* live, size_t block) {
+    return live->sets + (4 * block + 1) * live->nwords;
+}
+
+// Registers the block reads before writing them, and those it writes.
+static void summarize_block(const block_t* block, const live_t* live, size_t b) {
+    bitset_word_t* uses = block_uses(live, b);
+    bitset_word_t* defs = block_defs(live, b);
+    const inst_t* inst = block->first;
+    for (size_t i = 0; i < block->ninsts; ++i, inst = inst->next) {
+        inst_regs_t regs;
+        inst_regs(inst, &regs);
+        for (size_t u = 0; u < regs.nuses; ++u) {
+            if (!bitset_test(defs, (size_t)regs.uses[u])) {
+                bitset_set(uses, (size_t)regs.uses[u]);
+            }
+        }
+        if (regs.has_def) {
+            bitset_set(defs, (size_t)regs.def);
+        }
+    }
+}
+
+void live_build(const cfg_t* cfg, live_t* live) {
+    *live = (live_t){0};
+    live->nblocks = cfg->nblocks;
+    live->nregs = count_regs(cfg);
+    live->nwords = bitset_words(live->nregs);
+
+    const size_t nsets_words = 4 * cfg->nblocks * live->nwords;
+    live->sets =
+        fort_alloc(ALLOC_CODEGEN, (nsets_words > 0 ? nsets_words : 1) * sizeof(bitset_word_t));
+    bitset_zero(live->sets, nsets_words);
+    if (cfg->nblocks == 0) {
+        return;
+    }
+
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        summarize_block(&cfg->blocks[b], live, b);
+    }
+
+    // A ring of blocks waiting to be visited; each is in it at most once.
+    size_t* queue = fort_alloc(ALLOC_CODEGEN, sizeof(size_t) * cfg->nblocks);
+    bool* queued = fort_alloc(ALLOC_CODEGEN, sizeof(bool) * cfg->nblocks);
+    size_t head = 0;
+    size_t len = 0;
+    for (size_t i = cfg->nrpo; i > 0; --i) {
+        queue[len++] = cfg->rpo[i - 1];
+    }
+    // Unreachable blocks go last: no reachable block depends on them.
+    for (size_t b = cfg->nblocks; b > 0; --b) {
+        if (!cfg_reachable(cfg, b - 1)) {
+            queue[len++] = b - 1;
+        }
+    }
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        queued[b] = true;
+    }
+
+    while (len > 0) {
+        const size_t b = queue[head];
+        head = (head + 1) % cfg->nblocks;
+        len--;
+        queued[b] = false;
+
+        const block_t* block = &cfg->blocks[b];
+        bitset_word_t* out = live_out(live, b);
+        bitset_zero(out, live->nwords);
+        for (size_t s = 0; s < block->nsuccs; ++s) {
+            FORT_UNUSED(bitset_union(out, live_in(live, block->succs[s]), live->nwords));
+        }
+        if (!bitset_transfer(live_in(live, b), block_uses(live, b), out, block_defs(live, b),
+                             live->nwords)) {
+            continue;
+        }
+
+        for (size_t p = 0; p < block->npreds; ++p) {
+            const size_t pred = cfg->preds[block->pred_start + p];
+            if (!queued[pred]) {
+                queued[pred] = true;
+                queue[(head + len++) % cfg->nblocks] = pred;
+            }
+        }
+    }
+
+    fort_free(queued);
+    fort_free(queue);
+}
+
+void live_fini(live_t* live) {
+    fort_free(live->sets);
+    *live = (live_t){0};
+}
@@ -0,0 +1,50 @@
+#ifndef FORT_LIVE_H
+#define FORT_LIVE_H
+
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+
+#include "assemble.h"  // for inst_t, reg_t
+#include "bitset.h"    // for bitset_word_t
+#include "cfg.h"       // for cfg_t
+
+// The registers an instruction reads and the one it writes, if any.
+typedef struct {
+    reg_t uses[2];
+    size_t nuses;
+    reg_t def;
+    bool has_def;
+} inst_regs_t;
+
+void inst_regs(const inst_t* inst, inst_regs_t* regs);
+
+// Registers live on entry to and exit from each block of a CFG, as bit sets
+// over register numbers. A register is live at a point when some path from
+// there reads it before writing it.
+typedef struct {
+    size_t nblocks;
+    // One more than the highest register the function mentions.
+    size_t nregs;
+    size_t nwords;
+    // Four sets per block: upward-exposed uses, defs, live-in and live-out.
+    bitset_word_t* sets;
+} live_t;
+
+// Iterates to a fixed point with a worklist seeded in postorder, which for a
+// backward problem visits successors before their predecessors.
+void live_build(const cfg_t* cfg, live_t* live);
+
+void live_fini(live_t* live);
+
+static inline bitset_word_t* live_in(const live_t* live, size_t block) {
+    return live->sets + (4 * block + 2) * live->nwords;
+}
+
+static inline bitset_word_t* live_out(const live_t* live, size_t block) {
+    return live->sets + (4 * block + 3) * live->nwords;
+}
+
+// Moves `live` from after `inst` to before it.
+void live_step(const inst_t* inst, bitset_word_t* live);
+
+#endif // FORT_LIVE_H
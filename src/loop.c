@@ -0,0 +1,155 @@
+#include "loop.h"
+
+#include <stdbool.h>  // for bool, false, true
+#include <stddef.h>   // for size_t, NULL
+
+#include "alloc.h"    // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "bitset.h"   // for bitset_word_t, bitset_set, bitset_test, bitset_words
+#include "cfg.h"      // for cfg_t, dom_t, block_t, cfg_reachable, dom_dominates, CFG_NONE
+
+static void* alloc_array(size_t n, size_t sz) {
+    return fort_alloc(ALLOC_CODEGEN, (n > 0 ? n : 1) * sz);
+}
+
+static bool is_header(const cfg_t* cfg, const dom_t* dom, size_t h) {
+    const block_t* block = &cfg->blocks[h];
+    for (size_t p = 0; p < block->npreds; ++p) {
+        const size_t tail = cfg->preds[block->pred_start + p];
+        if (cfg_reachable(cfg, tail) && dom_dominates(dom, h, tail)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bitset_word_t* body(const loops_t* loops, size_t loop) {
+    return loops->bodies + loop * loops->nwords;
+}
+
+// Walks backwards from the tails of the back edges; the header, marked
+// first, stops the walk.
+static void collect_body(const cfg_t* cfg, const dom_t* dom, size_t h, bitset_word_t* set,
+                         size_t* stack) {
+    size_t depth = 0;
+    bitset_set(set, h);
+    const block_t* header = &cfg->blocks[h];
+    for (size_t p = 0; p < header->npreds; ++p) {
+        const size_t tail = cfg->preds[header->pred_start + p];
+        if (cfg_reachable(cfg, tail) && dom_dominates(dom, h, tail) && !bitset_test(set, tail)) {
+            bitset_set(set, tail);
+            stack[depth++] = tail;
+        }
+    }
+
+    while (depth > 0) {
+        const block_t* block = &cfg->blocks[stack[--depth]];
+        for (size_t p = 0; p < block->npreds; ++p) {
+            const size_t pred = cfg->preds[block->pred_start + p];
+            if (cfg_reachable(cfg, pred) && !bitset_test(set, pred)) {
+                bitset_set(set, pred);
+                stack[depth++] = pred;
+            }
+        }
+    }
+}
+
+static size_t find_preheader(const cfg_t* cfg, const loops_t* loops, size_t loop) {
+    const size_t h = loops->loops[loop].header;
+    const block_t* header = &cfg->blocks[h];
+    size_t preheader = CFG_NONE;
+    for (size_t p = 0; p < header->npreds; ++p) {
+        const size_t pred = cfg->preds[header->pred_start + p];
+        if (bitset_test(body(loops, loop), pred)) {
+            continue;
+        }
+        if (preheader != CFG_NONE && preheader != pred) {
+            return CFG_NONE;
+        }
+        preheader = pred;
+    }
+
+    if (preheader == CFG_NONE || cfg->blocks[preheader].nsuccs != 1) {
+        return CFG_NONE;
+    }
+
+    return preheader;
+}
+
+void loops_build(const cfg_t* cfg, const dom_t* dom, loops_t* loops) {
+    *loops = (loops_t){0};
+    loops->nblocks = cfg->nblocks;
+    loops->nwords = bitset_words(cfg->nblocks);
+    loops->innermost = alloc_array(cfg->nblocks, sizeof(size_t));
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        loops->innermost[b] = CFG_NONE;
+    }
+
+    for (size_t i = 0; i < cfg->nrpo; ++i) {
+        loops->nloops += is_header(cfg, dom, cfg->rpo[i]) ? 1 : 0;
+    }
+    loops->loops = alloc_array(loops->nloops, sizeof(loop_t));
+    loops->bodies = alloc_array(loops->nloops * loops->nwords, sizeof(bitset_word_t));
+    bitset_zero(loops->bodies, loops->nloops * loops->nwords);
+
+    size_t* stack = alloc_array(cfg->nblocks, sizeof(size_t));
+    size_t n = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < cfg->nrpo; ++i) {
+        const size_t h = cfg->rpo[i];
+        if (!is_header(cfg, dom, h)) {
+            continue;
+        }
+        loop_t* loop = &loops->loops[n];
+        *loop = (loop_t){.header = h, .parent = CFG_NONE, .depth = 1};
+        collect_body(cfg, dom, h, body(loops, n), stack);
+        loop->nblocks = bitset_count(body(loops, n), loops->nwords);
+        loop->block_start = total;
+        total += loop->nblocks;
+
+        // Loops containing this header form a chain, and the innermost has
+        // the latest header in reverse postorder.
+        for (size_t j = n; j > 0; --j) {
+            if (bitset_test(body(loops, j - 1), h)) {
+                loop->parent = j - 1;
+                loop->depth = loops->loops[j - 1].depth + 1;
+                break;
+            }
+        }
+        n++;
+    }
+    fort_free(stack);
+
+    loops->blocks = alloc_array(total, sizeof(size_t));
+    for (size_t l = 0; l < loops->nloops; ++l) {
+        loop_t* loop = &loops->loops[l];
+        size_t* out = loops->blocks + loop->block_start;
+        *out++ = loop->header;
+        for (size_t b = 0; b < cfg->nblocks; ++b) {
+            if (b != loop->header && bitset_test(body(loops, l), b)) {
+                *out++ = b;
+            }
+            // Later loops are nested deeper, so the last one wins.
+            if (bitset_test(body(loops, l), b)) {
+                loops->innermost[b] = l;
+            }
+        }
+        loop->preheader = find_preheader(cfg, loops, l);
+    }
+}
+
+void loops_fini(loops_t* loops) {
+    fort_free(loops->bodies);
+    fort_free(loops->blocks);
+    fort_free(loops->innermost);
+    fort_free(loops->loops);
+    *loops = (loops_t){0};
+}
+
+bool loops_contains(const loops_t* loops, size_t loop, size_t block) {
+    if (loop >= loops->nloops || block >= loops->nblocks) {
+        return false;
+    }
+
+    return bitset_test(body(loops, loop), block);
+}
@@ -0,0 +1,49 @@
+#ifndef FORT_LOOP_H
+#define FORT_LOOP_H
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+
+#include "bitset.h"   // for bitset_word_t
+#include "cfg.h"      // for cfg_t, dom_t
+
+// A natural loop: a header that dominates the source of at least one edge
+// back into it, and every block that reaches such an edge without going
+// through the header. Back edges into the same header make one loop.
+typedef struct {
+    size_t header;
+    // The innermost loop containing this one, or CFG_NONE.
+    size_t parent;
+    // 1 for outermost loops.
+    size_t depth;
+    // The header's only predecessor outside the loop when that block has no
+    // other successor, so code placed at its end runs once before the loop.
+    // CFG_NONE when there is no such block.
+    size_t preheader;
+    // This loop's blocks are blocks[block_start, block_start + nblocks),
+    // header first.
+    size_t block_start;
+    size_t nblocks;
+} loop_t;
+
+// Loops are numbered in reverse postorder of their headers, so a loop comes
+// after every loop that contains it.
+typedef struct {
+    loop_t* loops;
+    size_t nloops;
+    size_t* blocks;
+    // The innermost loop each block of the CFG is in, or CFG_NONE.
+    size_t* innermost;
+    size_t nblocks;
+    // One bit set per loop over the blocks of the CFG.
+    bitset_word_t* bodies;
+    size_t nwords;
+} loops_t;
+
+void loops_build(const cfg_t* cfg, const dom_t* dom, loops_t* loops);
+
+void loops_fini(loops_t* loops);
+
+bool loops_contains(const loops_t* loops, size_t loop, size_t block);
+
+#endif // FORT_LOOP_H
@@ -0,0 +1,441 @@
+#include "opt.h"
+
+#include <inttypes.h>  // for PRIu64
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for size_t, NULL
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for fprintf, snprintf, FILE
+#include <string.h>    // for strchr, strlen, strncmp
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for asm_func_t, inst_t, op_t, INST_MOV, INST_XOR, OP_IMM, OP_REG
+#include "bitset.h"    // for bitset_word_t, bitset_copy, bitset_test
+#include "cfg.h"       // for cfg_t, dom_t, cfg_build, cfg_fini, dom_build, dom_fini
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_OUTCOME_ERR, FORT_UNUSED, NELEM
+#include "gvn.h"       // for gvn_find
+#include "live.h"      // for live_t, inst_regs, live_build, live_fini, live_out, live_step
+#include "loop.h"      // for loops_t, loops_build, loops_fini
+#include "timing.h"    // for timing_now
+
+#define NS_PER_MS 1e6
+
+#define BIT(x) (1U << (x))
+#define ALL_ANALYSES (BIT(ANALYSIS_COUNT) - 1)
+
+// One function on its way through the pipeline, with the analyses that are
+// currently valid for it.
+typedef struct {
+    asm_func_t* func;
+    arena_t* arena;
+    opt_stats_t* stats;
+    unsigned valid;
+    cfg_t cfg;
+    dom_t dom;
+    live_t live;
+    loops_t loops;
+} opt_ctx_t;
+
+typedef struct {
+    const char* name;
+    // Analyses this one is computed from; it goes stale with any of them.
+    unsigned deps;
+    void (*compute)(opt_ctx_t* ctx);
+    void (*release)(opt_ctx_t* ctx);
+} analysis_info_t;
+
+// `run` returns whether it changed the function and adds the instructions it
+// removed to `removed`. When it changed something, only the analyses in
+// `preserves` stay valid.
+typedef struct {
+    const char* name;
+    unsigned level;
+    unsigned requires;
+    unsigned preserves;
+    bool (*run)(opt_ctx_t* ctx, uint64_t* removed);
+} pass_info_t;
+
+static void compute_cfg(opt_ctx_t* ctx) {
+    cfg_build(ctx->func, &ctx->cfg);
+}
+
+static void release_cfg(opt_ctx_t* ctx) {
+    cfg_fini(&ctx->cfg);
+}
+
+static void compute_dom(opt_ctx_t* ctx) {
+    dom_build(&ctx->cfg, &ctx->dom);
+}
+
+static void release_dom(opt_ctx_t* ctx) {
+    dom_fini(&ctx->dom);
+}
+
+static void compute_live(opt_ctx_t* ctx) {
+    live_build(&ctx->cfg, &ctx->live);
+}
+
+static void release_live(opt_ctx_t* ctx) {
+    live_fini(&ctx->live);
+}
+
+static void compute_loops(opt_ctx_t* ctx) {
+    loops_build(&ctx->cfg, &ctx->dom, &ctx->loops);
+}
+
+static void release_loops(opt_ctx_t* ctx) {
+    loops_fini(&ctx->loops);
+}
+
+// Dependencies come before what depends on them.
+static const analysis_info_t ANALYSES[] = {
+    [ANALYSIS_CFG] = {"cfg", 0, compute_cfg, release_cfg},
+    [ANALYSIS_DOM] = {"dom", BIT(ANALYSIS_CFG), compute_dom, release_dom},
+    [ANALYSIS_LIVE] = {"live", BIT(ANALYSIS_CFG), compute_live, release_live},
+    [ANALYSIS_LOOPS] = {"loops", BIT(ANALYSIS_CFG) | BIT(ANALYSIS_DOM), compute_loops,
+                        release_loops},
+};
+_Static_assert(NELEM(ANALYSES) == ANALYSIS_COUNT, "every analysis needs an entry");
+
+static void release_inst(opt_ctx_t* ctx, inst_t* inst) {
+    if (ctx->arena == NULL) {
+        fort_free(inst);
+    }
+}
+
+// Drops every block the entry cannot reach, such as code after a return.
+static bool run_unreachable(opt_ctx_t* ctx, uint64_t* removed) {
+    const cfg_t* cfg = &ctx->cfg;
+    if (cfg->nrpo == cfg->nblocks) {
+        return false;
+    }
+
+    inst_t** link = &ctx->func->inst;
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        const block_t* block = &cfg->blocks[b];
+        if (cfg_reachable(cfg, b)) {
+            *link = block->first;
+            link = &block->last->next;
+            continue;
+        }
+
+        inst_t* inst = block->first;
+        for (size_t i = 0; i < block->ninsts; ++i) {
+            inst_t* next = inst->next;
+            release_inst(ctx, inst);
+            inst = next;
+        }
+        *removed += block->ninsts;
+    }
+    *link = NULL;
+
+    return true;
+}
+
+// Drops instructions that recompute a value their destination already holds.
+static bool run_gvn(opt_ctx_t* ctx, uint64_t* removed) {
+    size_t ninsts = 0;
+    for (const inst_t* inst = ctx->func->inst; inst != NULL; inst = inst->next) {
+        ninsts++;
+    }
+    bool* redundant = fort_alloc(ALLOC_CODEGEN, (ninsts > 0 ? ninsts : 1) * sizeof(bool));
+    const size_t found = gvn_find(ctx->func, &ctx->cfg, &ctx->dom, redundant);
+
+    if (found > 0) {
+        inst_t** link = &ctx->func->inst;
+        inst_t* inst = ctx->func->inst;
+        for (size_t i = 0; i < ninsts; ++i) {
+            inst_t* next = inst->next;
+            if (redundant[i]) {
+                release_inst(ctx, inst);
+            } else {
+                *link = inst;
+                link = &inst->next;
+            }
+            inst = next;
+        }
+        *link = NULL;
+    }
+
+    fort_free(redundant);
+    *removed += found;
+
+    return found > 0;
+}
+
+// Drops instructions whose only effect is writing a register that is dead
+// afterwards. Blocks are walked backwards from their live-out sets.
+static bool run_dead_def(opt_ctx_t* ctx, uint64_t* removed) {
+    const cfg_t* cfg = &ctx->cfg;
+    const live_t* live = &ctx->live;
+    bitset_word_t* now = fort_alloc(ALLOC_CODEGEN, (live->nwords > 0 ? live->nwords : 1) *
+                                                       sizeof(bitset_word_t));
+    size_t max_insts = 0;
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        if (cfg->blocks[b].ninsts > max_insts) {
+            max_insts = cfg->blocks[b].ninsts;
+        }
+    }
+    inst_t** insts = fort_alloc(ALLOC_CODEGEN, (max_insts > 0 ? max_insts : 1) * sizeof(inst_t*));
+
+    uint64_t ndead = 0;
+    inst_t** link = &ctx->func->inst;
+    for (size_t b = 0; b < cfg->nblocks; ++b) {
+        const block_t* block = &cfg->blocks[b];
+        inst_t* inst = block->first;
+        for (size_t i = 0; i < block->ninsts; ++i, inst = inst->next) {
+            insts[i] = inst;
+        }
+
+        // Dead instructions are marked by clearing their slot.
+        bitset_copy(now, live_out(live, b), live->nwords);
+        for (size_t i = block->ninsts; i > 0; --i) {
+            inst_regs_t regs;
+            inst_regs(insts[i - 1], &regs);
+            if (regs.has_def && !bitset_test(now, (size_t)regs.def)) {
+                release_inst(ctx, insts[i - 1]);
+                insts[i - 1] = NULL;
+                ndead++;
+                continue;
+            }
+            live_step(insts[i - 1], now);
+        }
+
+        for (size_t i = 0; i < block->ninsts; ++i) {
+            if (insts[i] != NULL) {
+                *link = insts[i];
+                link = &insts[i]->next;
+            }
+        }
+    }
+    *link = NULL;
+
+    fort_free(insts);
+    fort_free(now);
+    *removed += ndead;
+
+    return ndead > 0;
+}
+
+// mov $0, %reg becomes xor %reg, %reg: three bytes shorter, and recognized
+// by the CPU as independent of the register's old value.
+static bool run_zero_idiom(opt_ctx_t* ctx, uint64_t* removed) {
+    FORT_UNUSED(removed);
+
+    bool changed = false;
+    for (inst_t* inst = ctx->func->inst; inst != NULL; inst = inst->next) {
+        if (inst->kind != INST_MOV || inst->u.mov.src.kind != OP_IMM ||
+            inst->u.mov.src.u.imm.val != 0 || inst->u.mov.dst.kind != OP_REG) {
+            continue;
+        }
+
+        const op_t reg = inst->u.mov.dst;
+        inst->kind = INST_XOR;
+        inst->u.xor.src = reg;
+        inst->u.xor.dst = reg;
+        changed = true;
+    }
+
+    return changed;
+}
+
+static const pass_info_t PASSES[] = {
+    [PASS_UNREACHABLE] = {"unreachable", 1, BIT(ANALYSIS_CFG), 0, run_unreachable},
+    [PASS_GVN] = {"gvn", 2, BIT(ANALYSIS_DOM), 0, run_gvn},
+    [PASS_DEAD_DEF] = {"dead-def", 1, BIT(ANALYSIS_LIVE), 0, run_dead_def},
+    [PASS_ZERO_IDIOM] = {"zero-idiom", 2, 0, ALL_ANALYSES, run_zero_idiom},
+};
+_Static_assert(NELEM(PASSES) == PASS_COUNT, "every pass needs an entry");
+
+const char* pass_name(pass_t pass) {
+    return pass < PASS_COUNT ? PASSES[pass].name : "unknown";
+}
+
+const char* analysis_name(analysis_t analysis) {
+    return analysis < ANALYSIS_COUNT ? ANALYSES[analysis].name : "unknown";
+}
+
+fort_outcome_t opt_pipeline_level(unsigned level, opt_pipeline_t* pipeline) {
+    if (level > OPT_LEVEL_MAX) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    pipeline->npasses = 0;
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        if (PASSES[i].level <= level) {
+            pipeline->passes[pipeline->npasses++] = (pass_t)i;
+        }
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t lookup_pass(const char* name, size_t len, pass_t* pass) {
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        if (strlen(PASSES[i].name) == len && strncmp(PASSES[i].name, name, len) == 0) {
+            *pass = (pass_t)i;
+            return FORT_OUTCOME_OK;
+        }
+    }
+
+    return FORT_OUTCOME_ERR;
+}
+
+fort_outcome_t opt_pipeline_parse(const char* spec, opt_pipeline_t* pipeline) {
+    pipeline->npasses = 0;
+    if (*spec == '\0') {
+        return FORT_OUTCOME_OK;
+    }
+
+    for (;;) {
+        const char* comma = strchr(spec, ',');
+        const size_t len = comma != NULL ? (size_t)(comma - spec) : strlen(spec);
+        if (pipeline->npasses == OPT_PIPELINE_MAX) {
+            return FORT_OUTCOME_ERR;
+        }
+        FORT_OUTCOME_NOK_RET(lookup_pass(spec, len, &pipeline->passes[pipeline->npasses++]));
+        if (comma == NULL) {
+            return FORT_OUTCOME_OK;
+        }
+        spec = comma + 1;
+    }
+}
+
+size_t opt_pipeline_str(const opt_pipeline_t* pipeline, char* buf, size_t len) {
+    size_t n = 0;
+    if (len > 0) {
+        buf[0] = '\0';
+    }
+    for (size_t i = 0; i < pipeline->npasses; ++i) {
+        const int written = snprintf(buf + (n < len ? n : len), n < len ? len - n : 0, "%s%s",
+                                     i > 0 ? "," : "", pass_name(pipeline->passes[i]));
+        n += written > 0 ? (size_t)written : 0;
+    }
+
+    return n;
+}
+
+static void require(opt_ctx_t* ctx, analysis_t analysis) {
+    if ((ctx->valid & BIT(analysis)) != 0) {
+        return;
+    }
+
+    const analysis_info_t* info = &ANALYSES[analysis];
+    for (size_t i = 0; i < ANALYSIS_COUNT; ++i) {
+        if ((info->deps & BIT(i)) != 0) {
+            require(ctx, (analysis_t)i);
+        }
+    }
+
+    const uint64_t start = timing_now();
+    info->compute(ctx);
+    ctx->stats->analysis_ns[analysis] += timing_now() - start;
+    ctx->stats->analysis_runs[analysis]++;
+    ctx->valid |= BIT(analysis);
+}
+
+// Releases every analysis not in `keep`, and everything computed from one.
+static void invalidate(opt_ctx_t* ctx, unsigned keep) {
+    for (size_t i = 0; i < ANALYSIS_COUNT; ++i) {
+        const analysis_info_t* info = &ANALYSES[i];
+        if ((ctx->valid & BIT(i)) == 0) {
+            continue;
+        }
+        if ((keep & BIT(i)) == 0 || (info->deps & ~ctx->valid) != 0) {
+            info->release(ctx);
+            ctx->valid &= ~BIT(i);
+        }
+    }
+}
+
+void opt_run(const opt_pipeline_t* pipeline, asm_func_t* func, arena_t* arena, opt_stats_t* stats) {
+    opt_stats_t scratch = {0};
+    opt_ctx_t ctx = {
+        .func = func,
+        .arena = arena,
+        .stats = stats != NULL ? stats : &scratch,
+    };
+
+    for (size_t i = 0; i < pipeline->npasses; ++i) {
+        const pass_t pass = pipeline->passes[i];
+        const pass_info_t* info = &PASSES[pass];
+
+        const uint64_t start = timing_now();
+        for (size_t a = 0; a < ANALYSIS_COUNT; ++a) {
+            if ((info->requires & BIT(a)) != 0) {
+                require(&ctx, (analysis_t)a);
+            }
+        }
+        uint64_t removed = 0;
+        const bool changed = info->run(&ctx, &removed);
+        if (changed) {
+            invalidate(&ctx, info->preserves);
+        }
+        // Analyses computed on the pass's behalf are charged to it as well,
+        // so pass times add up to the time spent optimizing.
+        ctx.stats->pass_ns[pass] += timing_now() - start;
+        ctx.stats->pass_runs[pass]++;
+        ctx.stats->pass_changes[pass] += changed ? 1 : 0;
+        ctx.stats->pass_removed[pass] += removed;
+        ctx.stats->step_removed[i] += removed;
+    }
+
+    invalidate(&ctx, 0);
+}
+
+uint64_t opt_removed(const opt_stats_t* stats) {
+    uint64_t removed = 0;
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        removed += stats->pass_removed[i];
+    }
+
+    return removed;
+}
+
+void opt_stats_merge(opt_stats_t* dst, const opt_stats_t* src) {
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        dst->pass_ns[i] += src->pass_ns[i];
+        dst->pass_runs[i] += src->pass_runs[i];
+        dst->pass_changes[i] += src->pass_changes[i];
+        dst->pass_removed[i] += src->pass_removed[i];
+    }
+    for (size_t i = 0; i < OPT_PIPELINE_MAX; ++i) {
+        dst->step_removed[i] += src->step_removed[i];
+    }
+    for (size_t i = 0; i < ANALYSIS_COUNT; ++i) {
+        dst->analysis_ns[i] += src->analysis_ns[i];
+        dst->analysis_runs[i] += src->analysis_runs[i];
+    }
+}
+
+void opt_print(FILE* out, const opt_stats_t* stats) {
+    FORT_UNUSED(fprintf(out, "%-10s %-12s %12s %10s %10s %10s\n", "kind", "name", "time_ms", "runs",
+                        "changed", "removed"));
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        FORT_UNUSED(fprintf(out, "%-10s %-12s %12.3f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                            "pass", pass_name((pass_t)i), (double)stats->pass_ns[i] / NS_PER_MS,
+                            stats->pass_runs[i], stats->pass_changes[i], stats->pass_removed[i]));
+    }
+    for (size_t i = 0; i < ANALYSIS_COUNT; ++i) {
+        FORT_UNUSED(fprintf(out, "%-10s %-12s %12.3f %10" PRIu64 " %10s %10s\n", "analysis",
+                            analysis_name((analysis_t)i), (double)stats->analysis_ns[i] / NS_PER_MS,
+                            stats->analysis_runs[i], "-", "-"));
+    }
+}
+
+void opt_print_json(FILE* out, const opt_stats_t* stats) {
+    FORT_UNUSED(fprintf(out, "{\"passes\":["));
+    for (size_t i = 0; i < PASS_COUNT; ++i) {
+        FORT_UNUSED(fprintf(out,
+                            "%s{\"name\":\"%s\",\"ns\":%" PRIu64 ",\"runs\":%" PRIu64
+                            ",\"changed\":%" PRIu64 ",\"removed\":%" PRIu64 "}",
+                            i > 0 ? "," : "", pass_name((pass_t)i), stats->pass_ns[i],
+                            stats->pass_runs[i], stats->pass_changes[i], stats->pass_removed[i]));
+    }
+    FORT_UNUSED(fprintf(out, "],\"analyses\":["));
+    for (size_t i = 0; i < ANALYSIS_COUNT; ++i) {
+        FORT_UNUSED(fprintf(out, "%s{\"name\":\"%s\",\"ns\":%" PRIu64 ",\"runs\":%" PRIu64 "}",
+                            i > 0 ? "," : "", analysis_name((analysis_t)i),
+                            stats->analysis_ns[i], stats->analysis_runs[i]));
+    }
+    FORT_UNUSED(fprintf(out, "]}\n"));
+}
@@ -0,0 +1,83 @@
+#ifndef FORT_OPT_H
+#define FORT_OPT_H
+
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for FILE
+
+#include "arena.h"     // for arena_t
+#include "assemble.h"  // for asm_func_t
+#include "common.h"    // for fort_outcome_t
+
+// Transformations of a function's instructions after lowering.
+typedef enum {
+    PASS_UNREACHABLE,
+    PASS_GVN,
+    PASS_DEAD_DEF,
+    PASS_ZERO_IDIOM,
+    PASS_COUNT,
+} pass_t;
+
+// Facts about a function that passes read. Each is computed on first use and
+// kept until a pass changes something it depends on.
+typedef enum {
+    ANALYSIS_CFG,
+    ANALYSIS_DOM,
+    ANALYSIS_LIVE,
+    ANALYSIS_LOOPS,
+    ANALYSIS_COUNT,
+} analysis_t;
+
+#define OPT_LEVEL_MAX 2
+#define OPT_PIPELINE_MAX 32
+
+// The passes to run on every function, in order. A pass may appear more than
+// once.
+typedef struct opt_pipeline {
+    pass_t passes[OPT_PIPELINE_MAX];
+    size_t npasses;
+} opt_pipeline_t;
+
+// What the pass manager did, summed over functions. A pass counts as changing
+// a function when it rewrote or removed at least one instruction.
+typedef struct opt_stats {
+    uint64_t pass_ns[PASS_COUNT];
+    uint64_t pass_runs[PASS_COUNT];
+    uint64_t pass_changes[PASS_COUNT];
+    uint64_t pass_removed[PASS_COUNT];
+    // The same by position in the pipeline, for passes that run twice.
+    uint64_t step_removed[OPT_PIPELINE_MAX];
+    uint64_t analysis_ns[ANALYSIS_COUNT];
+    uint64_t analysis_runs[ANALYSIS_COUNT];
+} opt_stats_t;
+
+const char* pass_name(pass_t pass);
+
+const char* analysis_name(analysis_t analysis);
+
+// The preset pipeline for -O<level>: none at 0, cleanups that only make code
+// smaller at 1, and everything at 2.
+fort_outcome_t opt_pipeline_level(unsigned level, opt_pipeline_t* pipeline);
+
+// A comma-separated list of pass names; an empty string runs no passes.
+fort_outcome_t opt_pipeline_parse(const char* spec, opt_pipeline_t* pipeline);
+
+// The pipeline in the form opt_pipeline_parse reads, for cache keys and
+// reports. Returns the length it needed, as snprintf does.
+size_t opt_pipeline_str(const opt_pipeline_t* pipeline, char* buf, size_t len);
+
+// Instructions the passes in `stats` removed, summed over passes.
+uint64_t opt_removed(const opt_stats_t* stats);
+
+// Runs `pipeline` on `func`. Removed instructions are released with
+// fort_free unless they came from `arena`. `stats` may be NULL.
+void opt_run(const opt_pipeline_t* pipeline, asm_func_t* func, arena_t* arena, opt_stats_t* stats);
+
+void opt_stats_merge(opt_stats_t* dst, const opt_stats_t* src);
+
+// Time per pass and analysis, in the layout of the time report.
+void opt_print(FILE* out, const opt_stats_t* stats);
+
+void opt_print_json(FILE* out, const opt_stats_t* stats);
+
+#endif // FORT_OPT_H
@@ -1,8 +1,9 @@
 #include "parse.h"
 
 #include <inttypes.h>  // for int32_t, INT32_MAX
-#include <stdlib.h>    // for NULL, free, malloc, size_t
+#include <stddef.h>    // for NULL, size_t
 
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_PARSE
 #include "lex.h"       // for tok_stream_t, tok_t, TOKT_CLOSE_BRACE, TOKT_CL...
 
 typedef enum {
@@ -164,6 +165,17 @@ static fort_outcome_t parse_prog(tok_stream_t* toks, prog_t* prog) {
     outcome = parse_func(toks, &prog->func);
     FORT_OUTCOME_NOK_RET(outcome);
 
+    func_t* tail = &prog->func;
+    while (toks->next != NULL && toks->next->type != TOKT_EOF) {
+        func_t* func = fort_alloc(ALLOC_PARSE, sizeof(func_t));
+        *func = (func_t){0};
+        tail->next = func;
+        tail = func;
+
+        outcome = parse_func(toks, func);
+        FORT_OUTCOME_NOK_RET(outcome);
+    }
+
     outcome = expect(toks, TOKT_EOF, NULL);
     FORT_OUTCOME_NOK_RET(outcome);
 
@@ -171,14 +183,14 @@ static fort_outcome_t parse_prog(tok_stream_t* toks, prog_t* prog) {
 }
 
 parser_t* mkparser(tok_stream_t* toks) {
-    parser_t* parser = malloc(sizeof(parser_t));
+    parser_t* parser = fort_alloc(ALLOC_PARSE, sizeof(parser_t));
     parser->toks = toks;
 
     return parser;
 }
 
 void parser_fini(parser_t* parser) {
-    free(parser);
+    fort_free(parser);
 }
 
 fort_outcome_t parser_run(parser_t* parser, prog_t* prog) {
@@ -197,3 +209,13 @@ fort_outcome_t parser_run(parser_t* parser, prog_t* prog) {
 
     return FORT_OUTCOME_OK;
 }
+
+void prog_fini(prog_t* prog) {
+    func_t* func = prog->func.next;
+    while (func != NULL) {
+        func_t* next = func->next;
+        fort_free(func);
+        func = next;
+    }
+    prog->func.next = NULL;
+}
@@ -10,6 +10,7 @@ typedef struct parser parser_t;
 
 typedef enum {
     EXPR_CONST,
+    EXPR_KIND_COUNT,
 } expr_kind_t;
 
 typedef struct {
@@ -23,6 +24,7 @@ typedef struct {
 
 typedef enum {
     STMT_RET,
+    STMT_KIND_COUNT,
 } stmt_kind_t;
 
 typedef struct {
@@ -34,11 +36,14 @@ typedef struct {
     stmt_kind_t kind;
 } stmt_t;
 
-typedef struct {
+typedef struct func {
     buf_t name;
     stmt_t body;
+    struct func* next;
 } func_t;
 
+// Functions in source order. The first one is stored inline; the rest are
+// malloc'd and released by prog_fini.
 typedef struct {
     func_t func;
 } prog_t;
@@ -49,4 +54,6 @@ void parser_fini(parser_t* parser);
 
 fort_outcome_t parser_run(parser_t* parser, prog_t* prog);
 
+void prog_fini(prog_t* prog);
+
 #endif // FORT_PARSE_H
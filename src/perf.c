@@ -0,0 +1,225 @@
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "perf.h"
+
+#include <fcntl.h>     // for open, O_CREAT, O_RDWR, O_TRUNC
+#include <pthread.h>   // for pthread_mutex_lock, pthread_mutex_unlock, pthr...
+#include <stdint.h>    // for uint32_t, uint64_t, uintptr_t
+#include <stdio.h>     // for fclose, fopen, fprintf, snprintf, flockfile, FILE
+#include <stdlib.h>    // for getenv
+#include <string.h>    // for memcpy
+#include <unistd.h>    // for close, getpid, sysconf, write, gettid
+#include <sys/mman.h>  // for mmap, munmap, MAP_FAILED, MAP_PRIVATE, PROT_EXEC
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_EMIT
+#include "common.h"    // for FORT_OUTCOME_OK, FORT_OUTCOME_ERR, FORT_UNUSED
+#include "timing.h"    // for timing_now
+
+#define PERF_PATH_MAX 4096
+
+struct perf_map {
+    FILE* file;
+};
+
+perf_map_t* mkperf_map(void) {
+    char path[PERF_PATH_MAX];
+    FORT_UNUSED(snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid()));
+
+    FILE* file = fopen(path, "a");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    perf_map_t* map = fort_alloc(ALLOC_EMIT, sizeof(perf_map_t));
+    map->file = file;
+
+    return map;
+}
+
+void perf_map_fini(perf_map_t* map) {
+    if (map == NULL) {
+        return;
+    }
+
+    FORT_UNUSED(fclose(map->file));
+    fort_free(map);
+}
+
+fort_outcome_t perf_map_add(perf_map_t* map, const void* addr, size_t len, buf_t name) {
+    if (map == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    fort_outcome_t outcome = FORT_OUTCOME_OK;
+
+    // perf may read the map while we are still running, so flush whole lines,
+    // and keep concurrent JIT threads from interleaving theirs.
+    flockfile(map->file);
+    if (fprintf(map->file, "%lx %zx %.*s\n", (unsigned long)addr, len, (int)name.len, name.p) < 0 ||
+        fflush(map->file) != 0) {
+        outcome = FORT_OUTCOME_ERR;
+    }
+    funlockfile(map->file);
+
+    return outcome;
+}
+
+// Layouts from tools/perf/Documentation/jitdump-specification.txt in the Linux tree.
+#define JITDUMP_MAGIC 0x4A695444U
+#define JITDUMP_VERSION 1U
+#define JITDUMP_ELF_MACH_X86_64 62U
+
+typedef enum {
+    JIT_CODE_LOAD = 0,
+    JIT_CODE_CLOSE = 3,
+} jitdump_rec_id_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+} jitdump_header_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+} jitdump_rec_header_t;
+
+typedef struct {
+    jitdump_rec_header_t header;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+} jitdump_code_load_t;
+
+struct jitdump {
+    pthread_mutex_t mu;
+    int fd;
+    void* marker;
+    size_t marker_len;
+    uint64_t code_index;
+};
+
+static fort_outcome_t write_all(int fd, const void* p, size_t len) {
+    const char* bytes = p;
+    while (len > 0) {
+        ssize_t nbytes = write(fd, bytes, len);
+        if (nbytes < 0) {
+            return FORT_OUTCOME_ERR;
+        }
+        bytes += nbytes;
+        len -= (size_t)nbytes;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+jitdump_t* mkjitdump(void) {
+    const char* dir = getenv("JITDUMPDIR");
+    if (dir == NULL) {
+        dir = "/tmp";
+    }
+
+    char path[PERF_PATH_MAX];
+    FORT_UNUSED(snprintf(path, sizeof(path), "%s/jit-%d.dump", dir, (int)getpid()));
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // `perf inject --jit` only picks up dump files that show up as an executable
+    // mapping in the recorded process, so map one page of it and keep it mapped.
+    size_t marker_len = (size_t)sysconf(_SC_PAGESIZE);
+    void* marker = mmap(NULL, marker_len, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    if (marker == MAP_FAILED) {
+        FORT_UNUSED(close(fd));
+        return NULL;
+    }
+
+    jitdump_header_t header = {
+        .magic = JITDUMP_MAGIC,
+        .version = JITDUMP_VERSION,
+        .total_size = sizeof(jitdump_header_t),
+        .elf_mach = JITDUMP_ELF_MACH_X86_64,
+        .pid = (uint32_t)getpid(),
+        .timestamp = timing_now(),
+    };
+    if (write_all(fd, &header, sizeof(header)) != FORT_OUTCOME_OK) {
+        FORT_UNUSED(munmap(marker, marker_len));
+        FORT_UNUSED(close(fd));
+        return NULL;
+    }
+
+    jitdump_t* dump = fort_alloc(ALLOC_EMIT, sizeof(jitdump_t));
+    FORT_UNUSED(pthread_mutex_init(&dump->mu, NULL));
+    dump->fd = fd;
+    dump->marker = marker;
+    dump->marker_len = marker_len;
+    dump->code_index = 0;
+
+    return dump;
+}
+
+void jitdump_fini(jitdump_t* dump) {
+    if (dump == NULL) {
+        return;
+    }
+
+    jitdump_rec_header_t close_rec = {
+        .id = JIT_CODE_CLOSE,
+        .total_size = sizeof(jitdump_rec_header_t),
+        .timestamp = timing_now(),
+    };
+    FORT_UNUSED(write_all(dump->fd, &close_rec, sizeof(close_rec)));
+
+    FORT_UNUSED(munmap(dump->marker, dump->marker_len));
+    FORT_UNUSED(close(dump->fd));
+    FORT_UNUSED(pthread_mutex_destroy(&dump->mu));
+    fort_free(dump);
+}
+
+fort_outcome_t jitdump_code_load(jitdump_t* dump, const void* addr, size_t len, buf_t name) {
+    if (dump == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    // The name is stored NUL-terminated between the fixed fields and the code.
+    size_t rec_sz = sizeof(jitdump_code_load_t) + name.len + 1 + len;
+    char* rec = fort_alloc(ALLOC_EMIT, rec_sz);
+
+    // Records must not interleave, and code_index must increase in file order.
+    FORT_UNUSED(pthread_mutex_lock(&dump->mu));
+
+    jitdump_code_load_t load = {
+        .header = {JIT_CODE_LOAD, (uint32_t)rec_sz, timing_now()},
+        .pid = (uint32_t)getpid(),
+        .tid = (uint32_t)gettid(),
+        .vma = (uint64_t)(uintptr_t)addr,
+        .code_addr = (uint64_t)(uintptr_t)addr,
+        .code_size = len,
+        .code_index = dump->code_index++,
+    };
+
+    char* p = rec;
+    memcpy(p, &load, sizeof(load));
+    p += sizeof(load);
+    memcpy(p, name.p, name.len);
+    p += name.len;
+    *p++ = '\0';
+    memcpy(p, addr, len);
+
+    fort_outcome_t outcome = write_all(dump->fd, rec, rec_sz);
+    FORT_UNUSED(pthread_mutex_unlock(&dump->mu));
+    fort_free(rec);
+
+    return outcome;
+}
@@ -0,0 +1,28 @@
+#ifndef FORT_PERF_H
+#define FORT_PERF_H
+
+#include <stddef.h>  // for size_t
+
+#include "common.h"  // for buf_t, fort_outcome_t
+
+// Symbol map read by `perf report` for anonymous executable memory:
+// /tmp/perf-<pid>.map, one "<start> <size> <name>" line per function.
+typedef struct perf_map perf_map_t;
+
+perf_map_t* mkperf_map(void);
+
+void perf_map_fini(perf_map_t* map);
+
+fort_outcome_t perf_map_add(perf_map_t* map, const void* addr, size_t len, buf_t name);
+
+// jit-<pid>.dump in $JITDUMPDIR (or /tmp), consumed by `perf inject --jit`.
+// Unlike the perf map it carries the code bytes, so `perf annotate` works.
+typedef struct jitdump jitdump_t;
+
+jitdump_t* mkjitdump(void);
+
+void jitdump_fini(jitdump_t* dump);
+
+fort_outcome_t jitdump_code_load(jitdump_t* dump, const void* addr, size_t len, buf_t name);
+
+#endif // FORT_PERF_H
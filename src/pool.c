@@ -0,0 +1,183 @@
+#include "pool.h"
+
+#include <pthread.h>    // for pthread_cond_wait, pthread_mutex_lock, pthread_...
+#include <stdatomic.h>  // for atomic_fetch_add, atomic_store, atomic_size_t
+#include <stdbool.h>    // for bool, false, true
+#include <stdint.h>     // for uint64_t
+#include <stdio.h>      // for snprintf
+#include <stddef.h>     // for NULL, size_t
+
+#include "alloc.h"      // for fort_alloc, fort_free, ALLOC_DRIVER
+#include "common.h"     // for FORT_OUTCOME_OK, FORT_OUTCOME_FATAL, fort_outcome_t
+#include "trace.h"      // for trace_name_thread
+
+typedef struct {
+    pool_t* pool;
+    size_t id;
+} worker_t;
+
+struct pool {
+    size_t nworkers;
+    pthread_t* threads;
+    worker_t* workers;
+
+    pthread_mutex_t mu;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+
+    // Current batch, published under `mu` by bumping `generation`.
+    pool_fn_t fn;
+    void* ctx;
+    size_t njobs;
+    uint64_t generation;
+    size_t nfinished;
+    bool stop;
+
+    atomic_size_t next;
+};
+
+static void drain(pool_t* pool, pool_fn_t fn, void* ctx, size_t njobs, size_t worker) {
+    for (;;) {
+        const size_t job = atomic_fetch_add(&pool->next, 1);
+        if (job >= njobs) {
+            return;
+        }
+        fn(ctx, job, worker);
+    }
+}
+
+static void* worker_main(void* arg) {
+    const worker_t* worker = arg;
+    pool_t* pool = worker->pool;
+    uint64_t seen = 0;
+
+    char name[32];
+    FORT_UNUSED(snprintf(name, sizeof(name), "worker %zu", worker->id));
+    trace_name_thread(name);
+
+    FORT_UNUSED(pthread_mutex_lock(&pool->mu));
+    for (;;) {
+        while (!pool->stop && seen == pool->generation) {
+            FORT_UNUSED(pthread_cond_wait(&pool->work_cv, &pool->mu));
+        }
+        if (pool->stop) {
+            break;
+        }
+
+        seen = pool->generation;
+        const pool_fn_t fn = pool->fn;
+        void* ctx = pool->ctx;
+        const size_t njobs = pool->njobs;
+        FORT_UNUSED(pthread_mutex_unlock(&pool->mu));
+
+        drain(pool, fn, ctx, njobs, worker->id);
+
+        FORT_UNUSED(pthread_mutex_lock(&pool->mu));
+        // Every worker checks in for every batch. Otherwise a straggler from the
+        // previous batch could claim a job index from the next one.
+        if (++pool->nfinished == pool->nworkers - 1) {
+            FORT_UNUSED(pthread_cond_signal(&pool->done_cv));
+        }
+    }
+    FORT_UNUSED(pthread_mutex_unlock(&pool->mu));
+
+    return NULL;
+}
+
+static void pool_stop(pool_t* pool, size_t nthreads) {
+    FORT_UNUSED(pthread_mutex_lock(&pool->mu));
+    pool->stop = true;
+    FORT_UNUSED(pthread_cond_broadcast(&pool->work_cv));
+    FORT_UNUSED(pthread_mutex_unlock(&pool->mu));
+
+    for (size_t i = 0; i < nthreads; ++i) {
+        FORT_UNUSED(pthread_join(pool->threads[i], NULL));
+    }
+}
+
+pool_t* mkpool(size_t nworkers) {
+    if (nworkers == 0) {
+        return NULL;
+    }
+
+    pool_t* pool = fort_alloc(ALLOC_DRIVER, sizeof(pool_t));
+    pool->nworkers = nworkers;
+    pool->threads = fort_alloc(ALLOC_DRIVER, sizeof(pthread_t) * nworkers);
+    pool->workers = fort_alloc(ALLOC_DRIVER, sizeof(worker_t) * nworkers);
+    FORT_UNUSED(pthread_mutex_init(&pool->mu, NULL));
+    FORT_UNUSED(pthread_cond_init(&pool->work_cv, NULL));
+    FORT_UNUSED(pthread_cond_init(&pool->done_cv, NULL));
+    pool->fn = NULL;
+    pool->ctx = NULL;
+    pool->njobs = 0;
+    pool->generation = 0;
+    pool->nfinished = 0;
+    pool->stop = false;
+    atomic_store(&pool->next, 0);
+
+    for (size_t i = 1; i < nworkers; ++i) {
+        pool->workers[i] = (worker_t){pool, i};
+        if (pthread_create(&pool->threads[i - 1], NULL, worker_main, &pool->workers[i]) != 0) {
+            pool_stop(pool, i - 1);
+            pool->nworkers = i;
+            pool_fini(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void pool_fini(pool_t* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    if (!pool->stop) {
+        pool_stop(pool, pool->nworkers - 1);
+    }
+
+    FORT_UNUSED(pthread_cond_destroy(&pool->done_cv));
+    FORT_UNUSED(pthread_cond_destroy(&pool->work_cv));
+    FORT_UNUSED(pthread_mutex_destroy(&pool->mu));
+    fort_free(pool->workers);
+    fort_free(pool->threads);
+    fort_free(pool);
+}
+
+size_t pool_nworkers(const pool_t* pool) {
+    return pool->nworkers;
+}
+
+fort_outcome_t pool_run(pool_t* pool, size_t njobs, pool_fn_t fn, void* ctx) {
+    if (pool == NULL || fn == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    if (pool->nworkers == 1) {
+        for (size_t job = 0; job < njobs; ++job) {
+            fn(ctx, job, 0);
+        }
+        return FORT_OUTCOME_OK;
+    }
+
+    FORT_UNUSED(pthread_mutex_lock(&pool->mu));
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->njobs = njobs;
+    pool->nfinished = 0;
+    atomic_store(&pool->next, 0);
+    pool->generation++;
+    FORT_UNUSED(pthread_cond_broadcast(&pool->work_cv));
+    FORT_UNUSED(pthread_mutex_unlock(&pool->mu));
+
+    drain(pool, fn, ctx, njobs, 0);
+
+    FORT_UNUSED(pthread_mutex_lock(&pool->mu));
+    while (pool->nfinished < pool->nworkers - 1) {
+        FORT_UNUSED(pthread_cond_wait(&pool->done_cv, &pool->mu));
+    }
+    FORT_UNUSED(pthread_mutex_unlock(&pool->mu));
+
+    return FORT_OUTCOME_OK;
+}
@@ -0,0 +1,27 @@
+#ifndef FORT_POOL_H
+#define FORT_POOL_H
+
+#include <stddef.h>  // for size_t
+
+#include "common.h"  // for fort_outcome_t
+
+typedef struct pool pool_t;
+
+// Called once per job. `worker` is in [0, nworkers) and is stable for the
+// thread running the job, so callers can keep per-worker state in an array.
+typedef void (*pool_fn_t)(void* ctx, size_t job, size_t worker);
+
+// Spawns nworkers - 1 threads; the thread calling pool_run is worker 0.
+// Returns NULL if a thread cannot be created.
+pool_t* mkpool(size_t nworkers);
+
+void pool_fini(pool_t* pool);
+
+size_t pool_nworkers(const pool_t* pool);
+
+// Runs fn for every job in [0, njobs) and returns once all of them are done.
+// Jobs are handed out one at a time, so uneven job sizes balance themselves.
+// Not reentrant: a job must not call pool_run on the pool that is running it.
+fort_outcome_t pool_run(pool_t* pool, size_t njobs, pool_fn_t fn, void* ctx);
+
+#endif // FORT_POOL_H
@@ -0,0 +1,423 @@
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "server.h"
+
+#include <errno.h>       // for errno, EADDRINUSE, ECONNABORTED, EEXIST, EINTR, ENAMETOOLONG
+#include <limits.h>      // for PATH_MAX
+#include <stdatomic.h>   // for atomic_bool, atomic_init, atomic_load, atomic_store
+#include <stdbool.h>     // for bool, false, true
+#include <stdint.h>      // for uint32_t
+#include <stdio.h>       // for fflush, fwrite, snprintf, stderr, stdout
+#include <stdlib.h>      // for getenv
+#include <string.h>      // for memcpy, strlen
+#include <unistd.h>      // for close, getcwd, getuid, unlink, ssize_t
+#include <sys/socket.h>  // for accept, bind, connect, listen, recv, send, socket, ucred
+#include <sys/stat.h>    // for chmod, lstat, mkdir, stat, S_ISDIR, S_ISSOCK
+#include <sys/time.h>    // for timeval
+#include <sys/un.h>      // for sockaddr_un
+
+#include "alloc.h"       // for fort_alloc, fort_free, ALLOC_DRIVER
+#include "common.h"      // for FORT_OUTCOME_OK, FORT_OUTCOME_ERR, FORT_UNUSED
+#include "pool.h"        // for pool_t, pool_nworkers, pool_run
+
+// A request is the argument count followed by each argument; a reply is the
+// exit status followed by the stdout and stderr text. Every count and length
+// is a uint32_t in host byte order, since both ends run on the same machine.
+#define SERVER_ARGS_MAX (1U << 16)
+#define SERVER_ARG_MAX (1U << 16)
+#define SERVER_OUTPUT_MAX (1U << 30)
+
+// A client that stalls mid-request, or never reads its reply, must not wedge
+// the server for everyone.
+#define SERVER_IO_TIMEOUT_SEC 5
+
+struct server {
+    int fd;
+    atomic_bool stopped;
+    char* path;
+};
+
+static fort_outcome_t send_all(int fd, const void* p, size_t len) {
+    const char* bytes = p;
+    while (len > 0) {
+        // A client that hung up must not take the server down with SIGPIPE.
+        ssize_t nbytes = send(fd, bytes, len, MSG_NOSIGNAL);
+        if (nbytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FORT_OUTCOME_ERR;
+        }
+        bytes += nbytes;
+        len -= (size_t)nbytes;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t recv_all(int fd, void* p, size_t len) {
+    char* bytes = p;
+    while (len > 0) {
+        ssize_t nbytes = recv(fd, bytes, len, 0);
+        if (nbytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbytes <= 0) {
+            return FORT_OUTCOME_ERR;
+        }
+        bytes += nbytes;
+        len -= (size_t)nbytes;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t send_u32(int fd, uint32_t val) {
+    return send_all(fd, &val, sizeof(val));
+}
+
+static fort_outcome_t recv_u32(int fd, uint32_t* val) {
+    return recv_all(fd, val, sizeof(*val));
+}
+
+static fort_outcome_t send_blob(int fd, const char* p, size_t len) {
+    FORT_OUTCOME_NOK_RET(send_u32(fd, (uint32_t)len));
+    return send_all(fd, p, len);
+}
+
+// The blob is NUL-terminated so that request arguments can be used as strings.
+static fort_outcome_t recv_blob(int fd, uint32_t max, char** p, size_t* len) {
+    uint32_t blob_len = 0;
+    FORT_OUTCOME_NOK_RET(recv_u32(fd, &blob_len));
+    if (blob_len > max) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    char* blob = fort_alloc(ALLOC_DRIVER, (size_t)blob_len + 1);
+    if (recv_all(fd, blob, blob_len) != FORT_OUTCOME_OK) {
+        fort_free(blob);
+        return FORT_OUTCOME_ERR;
+    }
+    blob[blob_len] = '\0';
+
+    *p = blob;
+    *len = blob_len;
+
+    return FORT_OUTCOME_OK;
+}
+
+static void free_argv(int argc, char** argv) {
+    for (int i = 0; i < argc; ++i) {
+        fort_free(argv[i]);
+    }
+    fort_free(argv);
+}
+
+static fort_outcome_t recv_request(int fd, int* argc, char*** argv) {
+    uint32_t nargs = 0;
+    FORT_OUTCOME_NOK_RET(recv_u32(fd, &nargs));
+    if (nargs == 0 || nargs > SERVER_ARGS_MAX) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    char** args = fort_alloc(ALLOC_DRIVER, sizeof(char*) * ((size_t)nargs + 1));
+    for (uint32_t i = 0; i < nargs; ++i) {
+        size_t len = 0;
+        if (recv_blob(fd, SERVER_ARG_MAX, &args[i], &len) != FORT_OUTCOME_OK) {
+            free_argv((int)i, args);
+            return FORT_OUTCOME_ERR;
+        }
+        // Arguments end up as C strings, so an embedded NUL is malformed.
+        if (strlen(args[i]) != len) {
+            free_argv((int)i + 1, args);
+            return FORT_OUTCOME_ERR;
+        }
+    }
+    args[nargs] = NULL;
+
+    *argc = (int)nargs;
+    *argv = args;
+
+    return FORT_OUTCOME_OK;
+}
+
+static fort_outcome_t send_reply(int fd, const server_reply_t* reply) {
+    FORT_OUTCOME_NOK_RET(send_u32(fd, (uint32_t)reply->status));
+    FORT_OUTCOME_NOK_RET(send_blob(fd, reply->out, reply->out_len));
+    return send_blob(fd, reply->err, reply->err_len);
+}
+
+static fort_outcome_t mkaddr(const char* path, struct sockaddr_un* addr) {
+    const size_t len = strlen(path);
+    if (len >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return FORT_OUTCOME_ERR;
+    }
+
+    *addr = (struct sockaddr_un){0};
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, len + 1);
+
+    return FORT_OUTCOME_OK;
+}
+
+// Requests carry a working directory and argv, and replies are trusted as
+// the compiler's output, so both ends talk only to their own user.
+static bool peer_is_self(int fd) {
+    struct ucred cred = {0};
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || len != sizeof(cred)) {
+        return false;
+    }
+
+    return cred.uid == getuid();
+}
+
+server_t* mkserver(const char* path) {
+    struct sockaddr_un addr;
+    if (mkaddr(path, &addr) != FORT_OUTCOME_OK) {
+        return NULL;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // Only replace the socket file if nobody answers on it, and never replace
+    // anything that is not a socket.
+    if (connect(fd, (const struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        FORT_UNUSED(close(fd));
+        errno = EADDRINUSE;
+        return NULL;
+    }
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            FORT_UNUSED(close(fd));
+            errno = EEXIST;
+            return NULL;
+        }
+        FORT_UNUSED(unlink(path));
+    }
+
+    // The peer check keeps other users out even if they can reach the file;
+    // the mode just stops them connecting at all.
+    if (bind(fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        const int err = errno;
+        FORT_UNUSED(close(fd));
+        errno = err;
+        return NULL;
+    }
+    if (chmod(path, 0600) < 0 || listen(fd, SOMAXCONN) < 0) {
+        const int err = errno;
+        FORT_UNUSED(close(fd));
+        FORT_UNUSED(unlink(path));
+        errno = err;
+        return NULL;
+    }
+
+    server_t* server = fort_alloc(ALLOC_DRIVER, sizeof(server_t));
+    server->fd = fd;
+    atomic_init(&server->stopped, false);
+    server->path = fort_alloc(ALLOC_DRIVER, strlen(path) + 1);
+    memcpy(server->path, path, strlen(path) + 1);
+
+    return server;
+}
+
+void server_fini(server_t* server) {
+    if (server == NULL) {
+        return;
+    }
+
+    FORT_UNUSED(close(server->fd));
+    FORT_UNUSED(unlink(server->path));
+    fort_free(server->path);
+    fort_free(server);
+}
+
+static void serve_conn(int fd, size_t worker, server_fn_t fn, void* ctx) {
+    if (!peer_is_self(fd)) {
+        return;
+    }
+
+    const struct timeval timeout = {SERVER_IO_TIMEOUT_SEC, 0};
+    FORT_UNUSED(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
+    FORT_UNUSED(setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)));
+
+    int argc = 0;
+    char** argv = NULL;
+    if (recv_request(fd, &argc, &argv) != FORT_OUTCOME_OK) {
+        return;
+    }
+
+    server_reply_t reply = {0};
+    fn(ctx, worker, argc, argv, &reply);
+    FORT_UNUSED(send_reply(fd, &reply));
+
+    server_reply_fini(&reply);
+    free_argv(argc, argv);
+}
+
+typedef struct {
+    server_t* server;
+    server_fn_t fn;
+    void* ctx;
+    atomic_bool failed;
+} serve_loop_t;
+
+// One accept loop per worker; the kernel hands each connection to one of
+// the workers blocked in accept.
+static void serve_loop(void* arg, size_t job, size_t worker) {
+    FORT_UNUSED(job);
+    serve_loop_t* loop = arg;
+    server_t* server = loop->server;
+
+    while (!atomic_load(&server->stopped)) {
+        int fd = accept4(server->fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (atomic_load(&server->stopped)) {
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // The other workers would otherwise keep serving without this one.
+            atomic_store(&loop->failed, true);
+            server_stop(server);
+            break;
+        }
+
+        serve_conn(fd, worker, loop->fn, loop->ctx);
+        FORT_UNUSED(close(fd));
+    }
+}
+
+fort_outcome_t server_run(server_t* server, pool_t* pool, server_fn_t fn, void* ctx) {
+    if (server == NULL || fn == NULL) {
+        return FORT_OUTCOME_FATAL;
+    }
+
+    serve_loop_t loop = {.server = server, .fn = fn, .ctx = ctx};
+    atomic_init(&loop.failed, false);
+    if (pool != NULL) {
+        // Every job is a loop that runs until server_stop, so each worker
+        // takes exactly one.
+        FORT_OUTCOME_NOK_RET(pool_run(pool, pool_nworkers(pool), serve_loop, &loop));
+    } else {
+        serve_loop(&loop, 0, 0);
+    }
+
+    return atomic_load(&loop.failed) ? FORT_OUTCOME_ERR : FORT_OUTCOME_OK;
+}
+
+void server_stop(server_t* server) {
+    atomic_store(&server->stopped, true);
+    // Wakes up a blocked accept; shutdown is async-signal-safe.
+    FORT_UNUSED(shutdown(server->fd, SHUT_RDWR));
+}
+
+fort_outcome_t server_call(const char* path, int argc, char* const argv[], server_reply_t* reply) {
+    struct sockaddr_un addr;
+    if (argc <= 0 || (uint32_t)argc > SERVER_ARGS_MAX || mkaddr(path, &addr) != FORT_OUTCOME_OK) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    if (connect(fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0 || !peer_is_self(fd)) {
+        FORT_UNUSED(close(fd));
+        return FORT_OUTCOME_ERR;
+    }
+
+    fort_outcome_t outcome = send_u32(fd, (uint32_t)argc);
+    for (int i = 0; i < argc && outcome == FORT_OUTCOME_OK; ++i) {
+        outcome = send_blob(fd, argv[i], strlen(argv[i]));
+    }
+
+    uint32_t status = 0;
+    *reply = (server_reply_t){0};
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = recv_u32(fd, &status);
+    }
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = recv_blob(fd, SERVER_OUTPUT_MAX, &reply->out, &reply->out_len);
+    }
+    if (outcome == FORT_OUTCOME_OK) {
+        outcome = recv_blob(fd, SERVER_OUTPUT_MAX, &reply->err, &reply->err_len);
+    }
+    reply->status = (int)status;
+
+    FORT_UNUSED(close(fd));
+    if (outcome != FORT_OUTCOME_OK) {
+        server_reply_fini(reply);
+    }
+
+    return outcome;
+}
+
+// /tmp is shared, so the fallback socket lives in a directory only this user
+// can enter; anyone could have created it first, so check whose it is.
+static fort_outcome_t private_dir(const char* dir, bool create) {
+    if (create && mkdir(dir, 0700) < 0 && errno != EEXIST) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    struct stat st;
+    if (lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() ||
+        (st.st_mode & 0077) != 0) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    return FORT_OUTCOME_OK;
+}
+
+const char* server_default_path(char* buf, size_t len, bool create) {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != NULL && runtime_dir[0] != '\0') {
+        const int n = snprintf(buf, len, "%s/fort.sock", runtime_dir);
+        return n > 0 && (size_t)n < len ? buf : NULL;
+    }
+
+    int n = snprintf(buf, len, "/tmp/fort-%u", (unsigned)getuid());
+    if (n <= 0 || (size_t)n >= len || private_dir(buf, create) != FORT_OUTCOME_OK) {
+        return NULL;
+    }
+    const size_t dir_len = (size_t)n;
+    n = snprintf(buf + dir_len, len - dir_len, "/fort.sock");
+
+    return n > 0 && (size_t)n < len - dir_len ? buf : NULL;
+}
+
+fort_outcome_t server_forward(const char* path, int argc, char* argv[], int* status) {
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    char** req = fort_alloc(ALLOC_DRIVER, sizeof(char*) * ((size_t)argc + 1));
+    req[0] = cwd;
+    memcpy(req + 1, argv, sizeof(char*) * (size_t)argc);
+
+    server_reply_t reply = {0};
+    const fort_outcome_t outcome = server_call(path, argc + 1, req, &reply);
+    fort_free(req);
+    FORT_OUTCOME_NOK_RET(outcome);
+
+    FORT_UNUSED(fwrite(reply.out, 1, reply.out_len, stdout));
+    FORT_UNUSED(fflush(stdout));
+    FORT_UNUSED(fwrite(reply.err, 1, reply.err_len, stderr));
+    *status = reply.status;
+    server_reply_fini(&reply);
+
+    return FORT_OUTCOME_OK;
+}
+
+void server_reply_fini(server_reply_t* reply) {
+    fort_free(reply->out);
+    fort_free(reply->err);
+    *reply = (server_reply_t){0};
+}
@@ -0,0 +1,65 @@
+#ifndef FORT_SERVER_H
+#define FORT_SERVER_H
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+
+#include "common.h"   // for fort_outcome_t
+#include "pool.h"     // for pool_t
+
+// The longest socket path a sockaddr_un holds, with its NUL.
+#define SERVER_PATH_MAX 108
+
+typedef struct server server_t;
+
+// What the client should print and exit with. `out` and `err` come from
+// fort_alloc (or are NULL when empty) and are released by server_reply_fini.
+typedef struct {
+    int status;
+    char* out;
+    size_t out_len;
+    char* err;
+    size_t err_len;
+} server_reply_t;
+
+// Handles one request on pool worker `worker`, which no other request uses
+// at the same time. argv[argc] is NULL, as for main.
+typedef void (*server_fn_t)(void* ctx,
+                            size_t worker,
+                            int argc,
+                            char* argv[],
+                            server_reply_t* reply);
+
+// Listens on the Unix socket at `path`, replacing a stale socket file left by
+// a server that is no longer running. Returns NULL with errno set on failure,
+// or with errno set to EADDRINUSE if another server is already listening.
+server_t* mkserver(const char* path);
+
+// Stops listening and removes the socket file.
+void server_fini(server_t* server);
+
+// Serves requests until server_stop is called, one per worker of `pool` at a
+// time, or one at a time on the calling thread if `pool` is NULL. The pool
+// is busy for as long as this runs.
+fort_outcome_t server_run(server_t* server, pool_t* pool, server_fn_t fn, void* ctx);
+
+// Makes server_run return after the requests in flight, if any. Safe to call
+// from a signal handler or another thread.
+void server_stop(server_t* server);
+
+// Sends argv to the server listening at `path` and waits for its reply.
+fort_outcome_t server_call(const char* path, int argc, char* const argv[], server_reply_t* reply);
+
+void server_reply_fini(server_reply_t* reply);
+
+// A socket path only the calling user can reach: $XDG_RUNTIME_DIR/fort.sock,
+// or else /tmp/fort-<uid>/fort.sock. The /tmp directory is created when
+// `create` is set, and must be private to the user either way. Returns NULL
+// if neither path works.
+const char* server_default_path(char* buf, size_t len, bool create);
+
+// Has the server at `path` run argv in the current working directory, writes
+// its output to stdout and stderr, and stores its exit status in `status`.
+fort_outcome_t server_forward(const char* path, int argc, char* argv[], int* status);
+
+#endif // FORT_SERVER_H
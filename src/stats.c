@@ -0,0 +1,196 @@
+#include "stats.h"
+
+#include <inttypes.h>  // for PRIu64
+#include <stddef.h>    // for size_t, NULL
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for fprintf, snprintf, FILE
+
+#include "common.h"    // for FORT_UNUSED, NELEM, json_print_str
+#include "opt.h"       // for pass_name
+
+#define PASS_KEY_MAX 64
+
+static const char* const TOKT_NAMES[] = {
+    [TOKT_IDENTIFIER] = "identifier",
+    [TOKT_CONSTANT] = "constant",
+    [TOKT_KEYWORD_I32] = "i32",
+    [TOKT_KEYWORD_VOID] = "void",
+    [TOKT_KEYWORD_RETURN] = "return",
+    [TOKT_OPEN_PAREN] = "open_paren",
+    [TOKT_CLOSE_PAREN] = "close_paren",
+    [TOKT_OPEN_BRACE] = "open_brace",
+    [TOKT_CLOSE_BRACE] = "close_brace",
+    [TOKT_SEMICOLON] = "semicolon",
+    [TOKT_EOF] = "eof",
+    [TOKT_ERROR] = "error",
+};
+_Static_assert(NELEM(TOKT_NAMES) == TOKT_COUNT, "every token type needs a name");
+
+static const char* const STMT_NAMES[] = {
+    [STMT_RET] = "ret",
+};
+_Static_assert(NELEM(STMT_NAMES) == STMT_KIND_COUNT, "every statement kind needs a name");
+
+static const char* const EXPR_NAMES[] = {
+    [EXPR_CONST] = "const",
+};
+_Static_assert(NELEM(EXPR_NAMES) == EXPR_KIND_COUNT, "every expression kind needs a name");
+
+static const char* const INST_NAMES[] = {
+    [INST_MOV] = "mov",
+    [INST_RET] = "ret",
+    [INST_XOR] = "xor",
+};
+_Static_assert(NELEM(INST_NAMES) == INST_KIND_COUNT, "every instruction kind needs a name");
+
+void stats_count_toks(stats_t* stats, const tok_stream_t* toks) {
+    for (const tok_t* tok = toks->head.next; tok != NULL; tok = tok->next) {
+        stats->toks[tok->type]++;
+    }
+}
+
+static void count_expr(stats_t* stats, const expr_t* expr) {
+    stats->exprs[expr->kind]++;
+}
+
+static void count_stmt(stats_t* stats, const stmt_t* stmt) {
+    stats->stmts[stmt->kind]++;
+    switch (stmt->kind) {
+    case STMT_RET:
+        count_expr(stats, &stmt->u.ret.expr);
+        break;
+    default:
+        break;
+    }
+}
+
+void stats_count_prog(stats_t* stats, const prog_t* prog) {
+    for (const func_t* func = &prog->func; func != NULL; func = func->next) {
+        stats->funcs++;
+        count_stmt(stats, &func->body);
+    }
+}
+
+uint64_t stats_ast_nodes(const stats_t* stats) {
+    uint64_t nodes = stats->funcs;
+    for (size_t i = 0; i < STMT_KIND_COUNT; ++i) {
+        nodes += stats->stmts[i];
+    }
+    for (size_t i = 0; i < EXPR_KIND_COUNT; ++i) {
+        nodes += stats->exprs[i];
+    }
+
+    return nodes;
+}
+
+void stats_count_asm(stats_t* stats, const asm_prog_t* asm_prog) {
+    for (const asm_func_t* asm_func = &asm_prog->func; asm_func != NULL;
+         asm_func = asm_func->next) {
+        for (const inst_t* inst = asm_func->inst; inst != NULL; inst = inst->next) {
+            stats->ir_lowered++;
+            stats->ir_optimized++;
+            stats->insts[inst->kind]++;
+        }
+    }
+}
+
+void stats_count_opt(stats_t* stats, const opt_pipeline_t* pipeline, const opt_stats_t* opt) {
+    if (pipeline == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < pipeline->npasses; ++i) {
+        stats->ir_lowered += opt->step_removed[i];
+    }
+
+    uint64_t insts = stats->ir_lowered;
+    stats->npasses = pipeline->npasses;
+    for (size_t i = 0; i < pipeline->npasses; ++i) {
+        stats->passes[i] = pipeline->passes[i];
+        stats->pass_before[i] = insts;
+        insts -= opt->step_removed[i];
+        stats->pass_after[i] = insts;
+    }
+}
+
+void stats_count_code(stats_t* stats, const jit_prog_t* jit_prog) {
+    stats->code_bytes += jit_prog->func.len;
+    stats->encoded = true;
+}
+
+static void print_counts(FILE* out,
+                         const char* prefix,
+                         const char* const* names,
+                         const uint64_t* counts,
+                         size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        FORT_UNUSED(fprintf(out, "%s.%s=%" PRIu64 "\n", prefix, names[i], counts[i]));
+    }
+}
+
+void stats_print(FILE* out, const char* file, const stats_t* stats) {
+    FORT_UNUSED(fprintf(out, "file=%s\n", file));
+    print_counts(out, "tokens", TOKT_NAMES, stats->toks, TOKT_COUNT);
+    FORT_UNUSED(fprintf(out, "ast.func=%" PRIu64 "\n", stats->funcs));
+    print_counts(out, "ast.stmt", STMT_NAMES, stats->stmts, STMT_KIND_COUNT);
+    print_counts(out, "ast.expr", EXPR_NAMES, stats->exprs, EXPR_KIND_COUNT);
+    FORT_UNUSED(fprintf(out, "ir.lowered=%" PRIu64 "\n", stats->ir_lowered));
+    FORT_UNUSED(fprintf(out, "ir.optimized=%" PRIu64 "\n", stats->ir_optimized));
+    for (size_t i = 0; i < stats->npasses; ++i) {
+        // A pass that runs again gets its run number: ir.pass.gvn.2.before.
+        size_t run = 1;
+        for (size_t j = 0; j < i; ++j) {
+            run += stats->passes[j] == stats->passes[i] ? 1 : 0;
+        }
+        const char* name = pass_name(stats->passes[i]);
+        char key[PASS_KEY_MAX];
+        if (run > 1) {
+            FORT_UNUSED(snprintf(key, sizeof(key), "ir.pass.%s.%zu", name, run));
+        } else {
+            FORT_UNUSED(snprintf(key, sizeof(key), "ir.pass.%s", name));
+        }
+        FORT_UNUSED(fprintf(out, "%s.before=%" PRIu64 "\n%s.after=%" PRIu64 "\n", key,
+                            stats->pass_before[i], key, stats->pass_after[i]));
+    }
+    print_counts(out, "insts", INST_NAMES, stats->insts, INST_KIND_COUNT);
+    FORT_UNUSED(fprintf(out, "spills=%" PRIu64 "\n", stats->spills));
+    if (stats->encoded) {
+        FORT_UNUSED(fprintf(out, "code_bytes=%" PRIu64 "\n", stats->code_bytes));
+    }
+}
+
+static void print_counts_json(FILE* out,
+                              const char* key,
+                              const char* const* names,
+                              const uint64_t* counts,
+                              size_t n) {
+    FORT_UNUSED(fprintf(out, ",\"%s\":{", key));
+    for (size_t i = 0; i < n; ++i) {
+        FORT_UNUSED(fprintf(out, "%s\"%s\":%" PRIu64, i > 0 ? "," : "", names[i], counts[i]));
+    }
+    FORT_UNUSED(fprintf(out, "}"));
+}
+
+void stats_print_json(FILE* out, const char* file, const stats_t* stats) {
+    FORT_UNUSED(fprintf(out, "{\"file\":"));
+    json_print_str(out, file);
+    print_counts_json(out, "tokens", TOKT_NAMES, stats->toks, TOKT_COUNT);
+    FORT_UNUSED(fprintf(out, ",\"ast\":{\"func\":%" PRIu64, stats->funcs));
+    print_counts_json(out, "stmt", STMT_NAMES, stats->stmts, STMT_KIND_COUNT);
+    print_counts_json(out, "expr", EXPR_NAMES, stats->exprs, EXPR_KIND_COUNT);
+    FORT_UNUSED(fprintf(out, "},\"ir\":{\"lowered\":%" PRIu64 ",\"optimized\":%" PRIu64,
+                        stats->ir_lowered, stats->ir_optimized));
+    FORT_UNUSED(fprintf(out, ",\"passes\":["));
+    for (size_t i = 0; i < stats->npasses; ++i) {
+        FORT_UNUSED(fprintf(out, "%s{\"name\":\"%s\",\"before\":%" PRIu64 ",\"after\":%" PRIu64 "}",
+                            i > 0 ? "," : "", pass_name(stats->passes[i]), stats->pass_before[i],
+                            stats->pass_after[i]));
+    }
+    FORT_UNUSED(fprintf(out, "]}"));
+    print_counts_json(out, "insts", INST_NAMES, stats->insts, INST_KIND_COUNT);
+    FORT_UNUSED(fprintf(out, ",\"spills\":%" PRIu64, stats->spills));
+    if (stats->encoded) {
+        FORT_UNUSED(fprintf(out, ",\"code_bytes\":%" PRIu64, stats->code_bytes));
+    }
+    FORT_UNUSED(fprintf(out, "}\n"));
+}
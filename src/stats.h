@@ -0,0 +1,66 @@
+#ifndef FORT_STATS_H
+#define FORT_STATS_H
+
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for FILE
+
+#include "assemble.h"  // for asm_prog_t, INST_KIND_COUNT
+#include "jit.h"       // for jit_prog_t
+#include "lex.h"       // for tok_stream_t, TOKT_COUNT
+#include "opt.h"       // for opt_pipeline_t, opt_stats_t, pass_t, OPT_PIPELINE_MAX
+#include "parse.h"     // for prog_t, EXPR_KIND_COUNT, STMT_KIND_COUNT
+
+// What one compilation produced at each stage. Only the stages that ran are
+// counted, so a cache hit reports the code size and nothing else.
+typedef struct {
+    uint64_t toks[TOKT_COUNT];
+    uint64_t funcs;
+    uint64_t stmts[STMT_KIND_COUNT];
+    uint64_t exprs[EXPR_KIND_COUNT];
+    // Instructions as lowered from the AST, before any optimization, and
+    // what was left of them after the passes.
+    uint64_t ir_lowered;
+    uint64_t ir_optimized;
+    // Instructions going into and coming out of each pass, in pipeline order.
+    pass_t passes[OPT_PIPELINE_MAX];
+    uint64_t pass_before[OPT_PIPELINE_MAX];
+    uint64_t pass_after[OPT_PIPELINE_MAX];
+    size_t npasses;
+    // Instructions handed to the encoder, by kind.
+    uint64_t insts[INST_KIND_COUNT];
+    // Values that had to live in memory. Every value fits in eax today, so
+    // this stays zero until there is a register allocator.
+    uint64_t spills;
+    // Machine code for the entry function, the only one the JIT encodes
+    // until there are calls; `insts` counts every function. Only reported
+    // when `encoded` is set, since --codegen stops before the encoder.
+    uint64_t code_bytes;
+    bool encoded;
+} stats_t;
+
+void stats_count_toks(stats_t* stats, const tok_stream_t* toks);
+
+void stats_count_prog(stats_t* stats, const prog_t* prog);
+
+// Functions, statements and expressions counted so far.
+uint64_t stats_ast_nodes(const stats_t* stats);
+
+// Counts the instructions that remain after optimization.
+void stats_count_asm(stats_t* stats, const asm_prog_t* asm_prog);
+
+// Adds back to ir_lowered the instructions that passes removed, and works
+// out how many each pass saw. Call after stats_count_asm; `pipeline` may be
+// NULL when no passes ran.
+void stats_count_opt(stats_t* stats, const opt_pipeline_t* pipeline, const opt_stats_t* opt);
+
+void stats_count_code(stats_t* stats, const jit_prog_t* jit_prog);
+
+// One `key=value` pair per line, starting with `file=`.
+void stats_print(FILE* out, const char* file, const stats_t* stats);
+
+// One JSON object on a single line.
+void stats_print_json(FILE* out, const char* file, const stats_t* stats);
+
+#endif // FORT_STATS_H
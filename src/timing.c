@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "timing.h"
+
+#include <inttypes.h>  // for PRIu64
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for fprintf, FILE
+#include <time.h>      // for clock_gettime, timespec, CLOCK_MONOTONIC
+
+#include "common.h"    // for FORT_UNUSED
+
+#define NS_PER_SEC 1000000000ULL
+#define NS_PER_MS 1e6
+
+const char* phase_name(phase_t phase) {
+    switch (phase) {
+    case PHASE_LOAD:
+        return "load_src";
+    case PHASE_LEX:
+        return "lex";
+    case PHASE_PARSE:
+        return "parse";
+    case PHASE_CODEGEN:
+        return "codegen";
+    case PHASE_EMIT:
+        return "emit";
+    case PHASE_CACHE:
+        return "cache";
+    case PHASE_EXEC:
+        return "exec";
+    default:
+        return "unknown";
+    }
+}
+
+uint64_t timing_now(void) {
+    struct timespec ts;
+    FORT_UNUSED(clock_gettime(CLOCK_MONOTONIC, &ts));
+
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t timing_lap(timing_t* timing, phase_t phase, uint64_t start) {
+    const uint64_t now = timing_now();
+    timing->ns[phase] += now - start;
+
+    return now;
+}
+
+void timing_merge(timing_t* dst, const timing_t* src) {
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        dst->ns[i] += src->ns[i];
+    }
+    dst->files += src->files;
+    dst->bytes += src->bytes;
+    dst->tokens += src->tokens;
+}
+
+// Units per second, or 0 for a phase that took no measurable time.
+static double rate(uint64_t units, uint64_t ns) {
+    return ns > 0 ? (double)units * (double)NS_PER_SEC / (double)ns : 0;
+}
+
+void timing_print(FILE* out, const timing_t* timing, uint64_t wall_ns) {
+    uint64_t total_ns = 0;
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        total_ns += timing->ns[i];
+    }
+
+    FORT_UNUSED(fprintf(out, "time report: %" PRIu64 " files, %" PRIu64 " bytes, %" PRIu64 " tokens\n",
+                        timing->files, timing->bytes, timing->tokens));
+    FORT_UNUSED(fprintf(out, "%-10s %12s %7s %14s %14s\n", "phase", "time_ms", "share", "bytes/s",
+                        "tokens/s"));
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        const uint64_t ns = timing->ns[i];
+        const double share = total_ns > 0 ? 100.0 * (double)ns / (double)total_ns : 0;
+        FORT_UNUSED(fprintf(out, "%-10s %12.3f %6.1f%% %14.0f %14.0f\n", phase_name((phase_t)i),
+                            (double)ns / NS_PER_MS, share, rate(timing->bytes, ns),
+                            rate(timing->tokens, ns)));
+    }
+    FORT_UNUSED(fprintf(out, "%-10s %12.3f %7s %14.0f %14.0f\n", "wall", (double)wall_ns / NS_PER_MS,
+                        "", rate(timing->bytes, wall_ns), rate(timing->tokens, wall_ns)));
+}
+
+void timing_print_json(FILE* out, const timing_t* timing, uint64_t wall_ns) {
+    FORT_UNUSED(fprintf(out,
+                        "{\"files\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"tokens\":%" PRIu64
+                        ",\"wall_ns\":%" PRIu64 ",\"phases\":[",
+                        timing->files, timing->bytes, timing->tokens, wall_ns));
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        const uint64_t ns = timing->ns[i];
+        FORT_UNUSED(fprintf(out,
+                            "%s{\"name\":\"%s\",\"ns\":%" PRIu64
+                            ",\"bytes_per_sec\":%.0f,\"tokens_per_sec\":%.0f}",
+                            i > 0 ? "," : "", phase_name((phase_t)i), ns, rate(timing->bytes, ns),
+                            rate(timing->tokens, ns)));
+    }
+    FORT_UNUSED(fprintf(out, "]}\n"));
+}
@@ -0,0 +1,45 @@
+#ifndef FORT_TIMING_H
+#define FORT_TIMING_H
+
+#include <stdint.h>  // for uint64_t
+#include <stdio.h>   // for FILE
+
+typedef enum {
+    PHASE_LOAD,
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_CODEGEN,
+    PHASE_EMIT,
+    PHASE_CACHE,
+    PHASE_EXEC,
+    PHASE_COUNT,
+} phase_t;
+
+// Time spent in each phase, with the amount of input it covers. Each source
+// file fills in its own, and timing_merge sums them, so with several workers
+// the phase times add up to more than the wall time.
+typedef struct {
+    uint64_t ns[PHASE_COUNT];
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t tokens;
+} timing_t;
+
+const char* phase_name(phase_t phase);
+
+// Monotonic clock in nanoseconds. Every timestamp fort records comes from
+// here, and jitdump records rely on it being the clock `perf record -k mono`
+// uses, which is how perf matches them against samples.
+uint64_t timing_now(void);
+
+// Charges the time since `start` to `phase` and returns the current time, so
+// consecutive phases can be timed with one clock read each.
+uint64_t timing_lap(timing_t* timing, phase_t phase, uint64_t start);
+
+void timing_merge(timing_t* dst, const timing_t* src);
+
+void timing_print(FILE* out, const timing_t* timing, uint64_t wall_ns);
+
+void timing_print_json(FILE* out, const timing_t* timing, uint64_t wall_ns);
+
+#endif // FORT_TIMING_H
@@ -0,0 +1,191 @@
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "trace.h"
+
+#include <inttypes.h>   // for PRIu64
+#include <stdatomic.h>  // for atomic_load_explicit, atomic_compare_exchange_weak
+#include <stdbool.h>    // for bool, false, true
+#include <stddef.h>     // for size_t, NULL
+#include <stdint.h>     // for uint64_t, uint32_t
+#include <stdio.h>      // for fprintf, fputc, fflush, FILE
+#include <string.h>     // for memcpy, strlen
+#include <unistd.h>     // for getpid, gettid
+
+#include "alloc.h"      // for fort_alloc, fort_free, ALLOC_DRIVER
+#include "common.h"     // for FORT_UNUSED, FORT_OUTCOME_OK, FORT_OUTCOME_ERR
+#include "timing.h"     // for timing_now
+
+#define TRACE_NAME_MAX 48
+#define TRACE_CHUNK_EVENTS 1024
+#define NS_PER_US 1000.0
+
+typedef struct {
+    uint64_t ts;
+    uint64_t dur;
+    const char* cat;
+    char name[TRACE_NAME_MAX];
+} trace_event_t;
+
+typedef struct trace_chunk {
+    struct trace_chunk* next;
+    size_t len;
+    trace_event_t events[TRACE_CHUNK_EVENTS];
+} trace_chunk_t;
+
+// Written only by its owning thread until trace_stop reads it.
+typedef struct trace_buf {
+    struct trace_buf* next;
+    uint32_t tid;
+    char thread_name[TRACE_NAME_MAX];
+    trace_chunk_t* head;
+    trace_chunk_t* tail;
+} trace_buf_t;
+
+static atomic_bool trace_on = false;
+static _Atomic(trace_buf_t*) trace_bufs = NULL;
+static atomic_uint trace_generation = 0;
+static FILE* trace_out = NULL;
+
+// A thread's buffer belongs to the generation it was created in; a later
+// trace_start makes the thread register a fresh one.
+static _Thread_local trace_buf_t* tls_buf = NULL;
+static _Thread_local unsigned tls_generation = 0;
+static _Thread_local char tls_thread_name[TRACE_NAME_MAX];
+
+static void copy_name(char* dst, const char* src, size_t len) {
+    if (len >= TRACE_NAME_MAX) {
+        len = TRACE_NAME_MAX - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static trace_chunk_t* mkchunk(void) {
+    trace_chunk_t* chunk = fort_alloc(ALLOC_DRIVER, sizeof(trace_chunk_t));
+    chunk->next = NULL;
+    chunk->len = 0;
+
+    return chunk;
+}
+
+static trace_buf_t* thread_buf(void) {
+    const unsigned generation = atomic_load_explicit(&trace_generation, memory_order_acquire);
+    if (tls_buf != NULL && tls_generation == generation) {
+        return tls_buf;
+    }
+
+    trace_buf_t* buf = fort_alloc(ALLOC_DRIVER, sizeof(trace_buf_t));
+    buf->tid = (uint32_t)gettid();
+    copy_name(buf->thread_name, tls_thread_name, strlen(tls_thread_name));
+    buf->head = mkchunk();
+    buf->tail = buf->head;
+
+    buf->next = atomic_load_explicit(&trace_bufs, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&trace_bufs, &buf->next, buf,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+
+    tls_buf = buf;
+    tls_generation = generation;
+
+    return buf;
+}
+
+fort_outcome_t trace_start(FILE* out) {
+    if (out == NULL || atomic_load(&trace_on)) {
+        return FORT_OUTCOME_ERR;
+    }
+
+    trace_out = out;
+    atomic_fetch_add(&trace_generation, 1);
+    atomic_store(&trace_on, true);
+
+    return FORT_OUTCOME_OK;
+}
+
+uint64_t trace_begin(void) {
+    if (!atomic_load_explicit(&trace_on, memory_order_relaxed)) {
+        return 0;
+    }
+
+    return timing_now();
+}
+
+void trace_end(buf_t name, const char* cat, uint64_t start) {
+    if (start == 0 || !atomic_load_explicit(&trace_on, memory_order_relaxed)) {
+        return;
+    }
+
+    const uint64_t now = timing_now();
+    trace_buf_t* buf = thread_buf();
+    if (buf->tail->len == TRACE_CHUNK_EVENTS) {
+        buf->tail->next = mkchunk();
+        buf->tail = buf->tail->next;
+    }
+
+    trace_event_t* event = &buf->tail->events[buf->tail->len++];
+    event->ts = start;
+    event->dur = now - start;
+    event->cat = cat;
+    copy_name(event->name, name.p, name.len);
+}
+
+void trace_name_thread(const char* name) {
+    copy_name(tls_thread_name, name, strlen(name));
+}
+
+static void write_events(FILE* out, const trace_buf_t* buf, int pid, bool* first) {
+    if (buf->thread_name[0] != '\0') {
+        FORT_UNUSED(fprintf(out,
+                            "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,"
+                            "\"args\":{\"name\":",
+                            *first ? "" : ",\n", pid, buf->tid));
+        json_print_str(out, buf->thread_name);
+        FORT_UNUSED(fprintf(out, "}}"));
+        *first = false;
+    }
+
+    for (const trace_chunk_t* chunk = buf->head; chunk != NULL; chunk = chunk->next) {
+        for (size_t i = 0; i < chunk->len; ++i) {
+            const trace_event_t* event = &chunk->events[i];
+            FORT_UNUSED(fprintf(out, "%s{\"ph\":\"X\",\"name\":", *first ? "" : ",\n"));
+            json_print_str(out, event->name);
+            FORT_UNUSED(fprintf(out, ",\"cat\":"));
+            json_print_str(out, event->cat);
+            FORT_UNUSED(fprintf(out, ",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+                                (double)event->ts / NS_PER_US, (double)event->dur / NS_PER_US,
+                                pid, buf->tid));
+            *first = false;
+        }
+    }
+}
+
+fort_outcome_t trace_stop(void) {
+    if (!atomic_load(&trace_on)) {
+        return FORT_OUTCOME_ERR;
+    }
+    atomic_store(&trace_on, false);
+
+    FILE* out = trace_out;
+    trace_out = NULL;
+    const int pid = (int)getpid();
+    bool first = true;
+
+    FORT_UNUSED(fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"));
+    trace_buf_t* buf = atomic_exchange(&trace_bufs, NULL);
+    while (buf != NULL) {
+        write_events(out, buf, pid, &first);
+
+        trace_buf_t* next = buf->next;
+        trace_chunk_t* chunk = buf->head;
+        while (chunk != NULL) {
+            trace_chunk_t* next_chunk = chunk->next;
+            fort_free(chunk);
+            chunk = next_chunk;
+        }
+        fort_free(buf);
+        buf = next;
+    }
+    FORT_UNUSED(fprintf(out, "\n]}\n"));
+
+    return ferror(out) || fflush(out) != 0 ? FORT_OUTCOME_ERR : FORT_OUTCOME_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef FORT_TRACE_H
+#define FORT_TRACE_H
+
+#include <stdint.h>  // for uint64_t
+#include <stdio.h>   // for FILE
+
+#include "common.h"  // for buf_t, fort_outcome_t
+
+// Chrome trace-event recorder. Each thread appends complete events to its
+// own buffer without locking; the buffers are written out as one JSON
+// document by trace_stop, which opens in Perfetto or chrome://tracing.
+//
+// Recording is off until trace_start. trace_start and trace_stop must not
+// race with threads that are recording events.
+
+// Starts recording; the trace is written to `out` by trace_stop.
+// FORT_OUTCOME_ERR if a trace is already being recorded.
+fort_outcome_t trace_start(FILE* out);
+
+// Writes every recorded event to the FILE given to trace_start, releases the
+// buffers and stops recording. The caller still owns the FILE.
+fort_outcome_t trace_stop(void);
+
+// Returns the start timestamp for trace_end, or 0 when not recording.
+uint64_t trace_begin(void);
+
+// Records a span named `name` from `start` until now. A no-op when `start`
+// is 0. Names longer than a few dozen bytes are truncated.
+void trace_end(buf_t name, const char* cat, uint64_t start);
+
+// Labels the calling thread in the trace. Threads that record events
+// without a label show up by thread id.
+void trace_name_thread(const char* name);
+
+#endif // FORT_TRACE_H
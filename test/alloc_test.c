@@ -0,0 +1,184 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "alloc.h"
+
+#include <stdalign.h>  // for alignof
+#include <stddef.h>    // for max_align_t, size_t, NULL
+#include <stdint.h>    // for uintptr_t
+#include <stdio.h>     // for fclose, open_memstream, FILE
+#include <stdlib.h>    // for free
+#include <string.h>    // for memset, strcmp, strstr
+
+#include "arena.h"     // for arena_fini, mkarena
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+static alloc_counts_t mkcounts(size_t count, size_t bytes, size_t peak) {
+    return (alloc_counts_t){.count = count, .bytes = bytes, .peak = peak};
+}
+
+TEST(counts_allocations_per_stage, {
+    alloc_stats_t before = {0};
+    alloc_stats(&before);
+
+    char* a = fort_alloc(ALLOC_LEX, 10);
+    char* b = fort_alloc(ALLOC_LEX, 20);
+    TEST_ASSERT_NONNULL(a);
+    TEST_ASSERT_NONNULL(b);
+    TEST_ASSERT_EQ_SIZE((size_t)((uintptr_t)a % alignof(max_align_t)), (size_t)0);
+    memset(a, 'a', 10);
+    memset(b, 'b', 20);
+    fort_free(a);
+    fort_free(b);
+    fort_free(NULL);
+
+    alloc_stats_t after = {0};
+    alloc_stats(&after);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_LEX].count - before.stage[ALLOC_LEX].count, (size_t)2);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_LEX].bytes - before.stage[ALLOC_LEX].bytes, (size_t)30);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_PARSE].count, before.stage[ALLOC_PARSE].count);
+})
+
+TEST(peak_restarts_from_live, {
+    alloc_reset_peak();
+    char* a = fort_alloc(ALLOC_CODEGEN, 100);
+    char* b = fort_alloc(ALLOC_CODEGEN, 50);
+    fort_free(b);
+
+    alloc_stats_t stats = {0};
+    alloc_stats(&stats);
+    TEST_ASSERT_EQ_SIZE(stats.stage[ALLOC_CODEGEN].peak, (size_t)150);
+
+    // What is still live carries over into the next peak.
+    alloc_reset_peak();
+    alloc_stats(&stats);
+    TEST_ASSERT_EQ_SIZE(stats.stage[ALLOC_CODEGEN].peak, (size_t)100);
+
+    fort_free(a);
+    alloc_reset_peak();
+    alloc_stats(&stats);
+    TEST_ASSERT_EQ_SIZE(stats.stage[ALLOC_CODEGEN].peak, (size_t)0);
+})
+
+TEST(report_peak_leaves_out_memory_live_before, {
+    char* live = fort_alloc(ALLOC_DRIVER, 100);
+    alloc_reset_peak();
+    alloc_stats_t before = {0};
+    alloc_stats(&before);
+    fort_free(fort_alloc(ALLOC_DRIVER, 40));
+    alloc_stats_t after = {0};
+    alloc_stats(&after);
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    alloc_print_json(out, &before, &after, 0, 0);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "{\"name\":\"driver\",\"allocs\":1,\"bytes\":40,"
+                                    "\"peak_bytes\":40,"));
+
+    free(buf);
+    fort_free(live);
+})
+
+TEST(arena_allocations_charge_chunks_to_arena, {
+    arena_t* arena = mkarena(1024);
+    alloc_reset_peak();
+    alloc_stats_t before = {0};
+    alloc_stats(&before);
+
+    TEST_ASSERT_NONNULL(fort_alloc_from(arena, ALLOC_PARSE, 24));
+    TEST_ASSERT_NONNULL(fort_alloc_from(arena, ALLOC_PARSE, 24));
+
+    alloc_stats_t after = {0};
+    alloc_stats(&after);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_PARSE].count - before.stage[ALLOC_PARSE].count, (size_t)2);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_PARSE].bytes - before.stage[ALLOC_PARSE].bytes, (size_t)48);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_PARSE].peak, (size_t)0);
+    TEST_ASSERT_EQ_SIZE(after.stage[ALLOC_ARENA].count - before.stage[ALLOC_ARENA].count, (size_t)1);
+    TEST_ASSERT_TRUE(after.stage[ALLOC_ARENA].peak > 1024);
+
+    arena_fini(arena);
+})
+
+TEST(stage_names, {
+    TEST_ASSERT_TRUE(strcmp(alloc_stage_name(ALLOC_LOAD), "load_src") == 0);
+    TEST_ASSERT_TRUE(strcmp(alloc_stage_name(ALLOC_DRIVER), "driver") == 0);
+    TEST_ASSERT_TRUE(strcmp(alloc_stage_name(ALLOC_ARENA), "arena") == 0);
+    TEST_ASSERT_TRUE(strcmp(alloc_stage_name(ALLOC_STAGE_COUNT), "unknown") == 0);
+})
+
+TEST(json_report, {
+    alloc_stats_t before = {0};
+    alloc_stats_t after = {0};
+    after.stage[ALLOC_LEX] = mkcounts(4, 400, 300);
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    alloc_print_json(out, &before, &after, 100, 50);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "{\"tokens\":100,\"nodes\":50,\"stages\":["));
+    TEST_ASSERT_NONNULL(strstr(buf, "{\"name\":\"lex\",\"allocs\":4,\"bytes\":400,\"peak_bytes\":300,"
+                                    "\"bytes_per_token\":4.0,\"bytes_per_node\":8.0}"));
+    TEST_ASSERT_NONNULL(strstr(buf, "{\"name\":\"parse\",\"allocs\":0,\"bytes\":0,\"peak_bytes\":0,"
+                                    "\"bytes_per_token\":0.0,\"bytes_per_node\":0.0}"));
+    TEST_ASSERT_EQ_CHAR(buf[len - 1], '\n');
+
+    free(buf);
+})
+
+TEST(text_report, {
+    alloc_stats_t before = {0};
+    alloc_stats_t after = {0};
+    after.stage[ALLOC_LEX] = mkcounts(1, 10, 10);
+    after.stage[ALLOC_EMIT] = mkcounts(2, 30, 30);
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    alloc_print(out, &before, &after, 0, 0);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "memory report: 0 tokens, 0 AST nodes\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "bytes/node"));
+    TEST_ASSERT_NONNULL(strstr(buf, "emit"));
+    TEST_ASSERT_NONNULL(strstr(buf, " 30 "));
+
+    free(buf);
+})
+
+TEST(heap_counts_skip_arena_hits, {
+    arena_t* arena = mkarena(1024);
+    TEST_ALLOCS_BEGIN();
+    TEST_ASSERT_NONNULL(fort_alloc_from(arena, ALLOC_PARSE, 24));
+    TEST_ASSERT_NONNULL(fort_alloc_from(arena, ALLOC_PARSE, 24));
+    TEST_ASSERT_ALLOCS_LE(1, 1024 + 64);
+
+    char* p = fort_alloc(ALLOC_LEX, 10);
+    fort_free(p);
+    TEST_ASSERT_ALLOCS_LE(2, 1024 + 64 + 10);
+
+    arena_fini(arena);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("alloc", argc, argv);
+
+    TEST_RUN(counts_allocations_per_stage);
+    TEST_RUN(peak_restarts_from_live);
+    TEST_RUN(report_peak_leaves_out_memory_live_before);
+    TEST_RUN(arena_allocations_charge_chunks_to_arena);
+    TEST_RUN(heap_counts_skip_arena_hits);
+    TEST_RUN(stage_names);
+    TEST_RUN(json_report);
+    TEST_RUN(text_report);
+
+    TEST_EXIT();
+}
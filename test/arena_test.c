@@ -0,0 +1,79 @@
+#include "arena.h"
+
+#include <stdalign.h>  // for alignof
+#include <stddef.h>    // for max_align_t, size_t
+#include <stdint.h>    // for uintptr_t
+#include <string.h>    // for memset
+
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+#define CHUNK_SZ 256
+
+TEST(allocations_are_aligned_and_disjoint, {
+    arena_t* arena = mkarena(CHUNK_SZ);
+    TEST_ASSERT_NONNULL(arena);
+
+    char* a = arena_alloc(arena, 1);
+    char* b = arena_alloc(arena, 3);
+    TEST_ASSERT_EQ_SIZE((size_t)((uintptr_t)a % alignof(max_align_t)), (size_t)0);
+    TEST_ASSERT_EQ_SIZE((size_t)((uintptr_t)b % alignof(max_align_t)), (size_t)0);
+    TEST_ASSERT_TRUE(b >= a + 1);
+
+    memset(a, 'a', 1);
+    memset(b, 'b', 3);
+    TEST_ASSERT_EQ_CHAR(a[0], 'a');
+
+    arena_fini(arena);
+})
+
+TEST(grows_past_chunk_size, {
+    arena_t* arena = mkarena(CHUNK_SZ);
+
+    // Both fill more than a chunk, and the oversized one must still fit.
+    char* small = NULL;
+    for (size_t i = 0; i < 3 * CHUNK_SZ / 16; ++i) {
+        small = arena_alloc(arena, 16);
+        memset(small, 's', 16);
+    }
+    char* big = arena_alloc(arena, 4 * CHUNK_SZ);
+    memset(big, 'b', 4 * CHUNK_SZ);
+    TEST_ASSERT_EQ_CHAR(small[15], 's');
+
+    arena_fini(arena);
+})
+
+TEST(reset_reuses_chunks, {
+    arena_t* arena = mkarena(CHUNK_SZ);
+
+    char* first[8];
+    for (size_t i = 0; i < NELEM(first); ++i) {
+        first[i] = arena_alloc(arena, CHUNK_SZ / 2);
+    }
+
+    // The same sequence of requests after a reset gets the same memory back.
+    arena_reset(arena);
+    for (size_t i = 0; i < NELEM(first); ++i) {
+        TEST_ASSERT_TRUE(arena_alloc(arena, CHUNK_SZ / 2) == first[i]);
+    }
+
+    arena_fini(arena);
+})
+
+TEST(reset_empty_arena, {
+    arena_t* arena = mkarena(CHUNK_SZ);
+    arena_reset(arena);
+    TEST_ASSERT_NONNULL(arena_alloc(arena, 1));
+    arena_fini(arena);
+    arena_fini(NULL);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("arena", argc, argv);
+
+    TEST_RUN(allocations_are_aligned_and_disjoint);
+    TEST_RUN(grows_past_chunk_size);
+    TEST_RUN(reset_reuses_chunks);
+    TEST_RUN(reset_empty_arena);
+
+    TEST_EXIT();
+}
@@ -1,21 +1,14 @@
 #include "assemble.h"
 
-#include <stddef.h>  // for NULL
-#include <string.h>  // for strlen
+#include <stdbool.h>  // for bool, false, true
+#include <stddef.h>   // for NULL, size_t
+#include <string.h>   // for memcmp, strlen
 
-#include "parse.h"   // for prog_t, expr_t, stmt_t
-#include "test.h"    // for TEST_ASSERT_*, TEST
-
-// Helper to create a program with a return statement
-static prog_t make_return_prog(const char* func_name, int32_t ret_val) {
-    prog_t prog = {0};
-    prog.func.name.p = func_name;
-    prog.func.name.len = strlen(func_name);
-    prog.func.body.kind = STMT_RET;
-    prog.func.body.u.ret.expr.kind = EXPR_CONST;
-    prog.func.body.u.ret.expr.u.constant.val = ret_val;
-    return prog;
-}
+#include "arena.h"    // for arena_t, arena_fini, mkarena
+#include "parse.h"    // for prog_t, expr_t, stmt_t
+#include "pool.h"     // for mkpool, pool_fini, pool_t
+#include "test.h"     // for TEST_ASSERT_*, TEST
+#include "test_ir.h"  // for make_return_prog
 
 TEST(simple_return_zero, {
     prog_t prog = make_return_prog("main", 0);
@@ -272,6 +265,111 @@ TEST(reuse_assembler, {
     assembler_fini(assembler);
 })
 
+#define NFUNCS 257
+#define NWORKERS 4
+
+static func_t many_funcs[NFUNCS];
+
+// Functions f0 ... fN-1 returning their index; f0 lives inline in the program.
+static prog_t make_many_funcs_prog(void) {
+    static const char names[] = "f";
+    for (size_t i = 0; i < NFUNCS; ++i) {
+        many_funcs[i] = (func_t){0};
+        many_funcs[i].name.p = names;
+        many_funcs[i].name.len = 1;
+        many_funcs[i].body.kind = STMT_RET;
+        many_funcs[i].body.u.ret.expr.kind = EXPR_CONST;
+        many_funcs[i].body.u.ret.expr.u.constant.val = (int32_t)i;
+        many_funcs[i].next = i + 1 < NFUNCS ? &many_funcs[i + 1] : NULL;
+    }
+
+    prog_t prog = {0};
+    prog.func = many_funcs[0];
+    return prog;
+}
+
+static bool insts_equal(const inst_t* a, const inst_t* b) {
+    for (; a != NULL && b != NULL; a = a->next, b = b->next) {
+        if (a->kind != b->kind) {
+            return false;
+        }
+        if (a->kind == INST_MOV && memcmp(&a->u.mov, &b->u.mov, sizeof(a->u.mov)) != 0) {
+            return false;
+        }
+    }
+
+    return a == NULL && b == NULL;
+}
+
+static size_t count_equal_funcs(const asm_prog_t* a, const asm_prog_t* b) {
+    size_t n = 0;
+    const asm_func_t* fa = &a->func;
+    const asm_func_t* fb = &b->func;
+    for (; fa != NULL && fb != NULL; fa = fa->next, fb = fb->next) {
+        if (fa->name.p != fb->name.p || fa->name.len != fb->name.len ||
+            !insts_equal(fa->inst, fb->inst)) {
+            return n;
+        }
+        n++;
+    }
+
+    return fa == NULL && fb == NULL ? n : 0;
+}
+
+TEST(parallel_matches_serial, {
+    prog_t prog = make_many_funcs_prog();
+
+    assembler_t* serial = mkassembler(&prog);
+    asm_prog_t expected = {0};
+    TEST_ASSERT_EQ_INT32(assembler_run(serial, &expected), FORT_OUTCOME_OK);
+    assembler_fini(serial);
+
+    pool_t* pool = mkpool(NWORKERS);
+    TEST_ASSERT_NONNULL(pool);
+    arena_t* arenas[NWORKERS];
+    for (size_t i = 0; i < NWORKERS; ++i) {
+        arenas[i] = mkarena(1024);
+    }
+
+    assembler_t* parallel = mkassembler(&prog);
+    assembler_set_pool(parallel, pool);
+
+    // Malloc'd and arena-backed results alike, however the jobs get scheduled.
+    for (int round = 0; round < 8; ++round) {
+        asm_prog_t actual = {0};
+        actual.arenas = round % 2 == 0 ? NULL : arenas;
+        TEST_ASSERT_EQ_INT32(assembler_run(parallel, &actual), FORT_OUTCOME_OK);
+        TEST_ASSERT_EQ_SIZE(count_equal_funcs(&actual, &expected), (size_t)NFUNCS);
+        asm_prog_fini(&actual);
+        for (size_t i = 0; i < NWORKERS; ++i) {
+            arena_reset(arenas[i]);
+        }
+    }
+
+    assembler_fini(parallel);
+    for (size_t i = 0; i < NWORKERS; ++i) {
+        arena_fini(arenas[i]);
+    }
+    pool_fini(pool);
+    asm_prog_fini(&expected);
+})
+
+TEST(single_worker_pool_is_serial, {
+    prog_t prog = make_many_funcs_prog();
+
+    pool_t* pool = mkpool(1);
+    assembler_t* assembler = mkassembler(&prog);
+    assembler_set_pool(assembler, pool);
+
+    asm_prog_t asm_prog = {0};
+    TEST_ASSERT_EQ_INT32(assembler_run(assembler, &asm_prog), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(asm_prog.func.next->inst->u.mov.src.u.imm.val, 1);
+
+    asm_prog_fini(&asm_prog);
+    assembler_fini(assembler);
+    pool_fini(pool);
+})
+
 int main(int argc, char* argv[]) {
     TEST_INIT("assemble", argc, argv);
 
@@ -288,6 +386,8 @@ int main(int argc, char* argv[]) {
     TEST_RUN(null_asm_prog);
     TEST_RUN(multiple_programs);
     TEST_RUN(reuse_assembler);
+    TEST_RUN(parallel_matches_serial);
+    TEST_RUN(single_worker_pool_is_serial);
 
     TEST_EXIT();
 }
@@ -0,0 +1,226 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "cache.h"
+
+#include <stdint.h>  // for uint64_t, uint8_t
+#include <stdio.h>   // for fclose, fopen, fputs, snprintf, FILE
+#include <stdlib.h>  // for mkdtemp
+#include <string.h>  // for memcmp, memcpy, strcmp, strlen
+#include <unistd.h>  // for rmdir, unlink
+
+#include "alloc.h"   // for fort_alloc, ALLOC_EMIT
+#include "jit.h"     // for jit_prog_t, jit_prog_fini
+#include "test.h"    // for TEST_ASSERT_*, TEST
+
+#define PATH_LEN 256
+// Longer than the cache's own path buffer has room for once a file name is
+// appended, but still a directory the kernel accepts.
+#define LONG_PATH_LEN 4080
+
+// mov $5, %eax; ret
+static const uint8_t CODE[] = {0xB8, 0x05, 0x00, 0x00, 0x00, 0xC3};
+
+static buf_t mkbuf(const char* s) {
+    return (buf_t){s, strlen(s)};
+}
+
+static jit_prog_t make_jit_prog(const char* name) {
+    const size_t name_len = strlen(name);
+    uint8_t* code = fort_alloc(ALLOC_EMIT, sizeof(CODE) + name_len + 1);
+    memcpy(code, CODE, sizeof(CODE));
+    memcpy(code + sizeof(CODE), name, name_len + 1);
+
+    jit_prog_t jit_prog = {0};
+    jit_prog.func.name = (buf_t){(const char*)code + sizeof(CODE), name_len};
+    jit_prog.func.code = code;
+    jit_prog.func.len = sizeof(CODE);
+    return jit_prog;
+}
+
+static void entry_path(const char* dir, uint64_t key, char* path, size_t len) {
+    FORT_UNUSED(snprintf(path, len, "%s/%016llx.fjit", dir, (unsigned long long)key));
+}
+
+TEST(key_is_deterministic, {
+    const uint64_t k1 = cache_key(mkbuf("i32 main(void) { return 1; }"), mkbuf("x86_64"));
+    const uint64_t k2 = cache_key(mkbuf("i32 main(void) { return 1; }"), mkbuf("x86_64"));
+
+    TEST_ASSERT_TRUE(k1 == k2);
+})
+
+TEST(key_depends_on_src_and_opts, {
+    const uint64_t base = cache_key(mkbuf("i32 main(void) { return 1; }"), mkbuf("x86_64"));
+    const uint64_t src = cache_key(mkbuf("i32 main(void) { return 2; }"), mkbuf("x86_64"));
+    const uint64_t opts = cache_key(mkbuf("i32 main(void) { return 1; }"), mkbuf("x86_64 -O2"));
+
+    TEST_ASSERT_TRUE(base != src);
+    TEST_ASSERT_TRUE(base != opts);
+})
+
+TEST(key_separates_fields, {
+    const uint64_t k1 = cache_key(mkbuf("ab"), mkbuf("c"));
+    const uint64_t k2 = cache_key(mkbuf("b"), mkbuf("ca"));
+
+    TEST_ASSERT_TRUE(k1 != k2);
+})
+
+TEST(store_then_lookup, {
+    char dir[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(dir));
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    const uint64_t key = cache_key(mkbuf("src"), mkbuf(""));
+    jit_prog_t stored = make_jit_prog("main");
+    fort_outcome_t outcome = cache_store(cache, key, &stored);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    jit_prog_t loaded = {0};
+    outcome = cache_lookup(cache, key, &loaded);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(loaded.func.len, sizeof(CODE));
+    TEST_ASSERT_TRUE(memcmp(loaded.func.code, CODE, sizeof(CODE)) == 0);
+    TEST_ASSERT_EQ_SIZE(loaded.func.name.len, 4);
+    TEST_ASSERT_TRUE(strcmp(loaded.func.name.p, "main") == 0);
+
+    cache_stats_t stats = {0};
+    cache_stats(cache, &stats);
+    TEST_ASSERT_EQ_INT64(stats.hits, (uint64_t)1);
+    TEST_ASSERT_EQ_INT64(stats.misses, (uint64_t)0);
+
+    char path[PATH_LEN];
+    entry_path(dir, key, path, sizeof(path));
+    FORT_UNUSED(unlink(path));
+    FORT_UNUSED(rmdir(dir));
+    jit_prog_fini(&loaded);
+    jit_prog_fini(&stored);
+    cache_fini(cache);
+})
+
+TEST(lookup_miss, {
+    char dir[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(dir));
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    jit_prog_t loaded = {0};
+    fort_outcome_t outcome = cache_lookup(cache, 42, &loaded);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_ERR);
+    TEST_ASSERT_TRUE(loaded.func.code == NULL);
+
+    cache_stats_t stats = {0};
+    cache_stats(cache, &stats);
+    TEST_ASSERT_EQ_INT64(stats.hits, (uint64_t)0);
+    TEST_ASSERT_EQ_INT64(stats.misses, (uint64_t)1);
+
+    FORT_UNUSED(rmdir(dir));
+    cache_fini(cache);
+})
+
+TEST(corrupt_entry_is_miss, {
+    char dir[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(dir));
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    const uint64_t key = 7;
+    char path[PATH_LEN];
+    entry_path(dir, key, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NONNULL(file);
+    FORT_UNUSED(fputs("FORTJIT1 truncated", file));
+    FORT_UNUSED(fclose(file));
+
+    jit_prog_t loaded = {0};
+    fort_outcome_t outcome = cache_lookup(cache, key, &loaded);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_ERR);
+
+    FORT_UNUSED(unlink(path));
+    FORT_UNUSED(rmdir(dir));
+    cache_fini(cache);
+})
+
+TEST(store_overwrites, {
+    char dir[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(dir));
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    jit_prog_t first = make_jit_prog("first");
+    jit_prog_t second = make_jit_prog("second");
+    TEST_ASSERT_EQ_INT32(cache_store(cache, 1, &first), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(cache_store(cache, 1, &second), FORT_OUTCOME_OK);
+
+    jit_prog_t loaded = {0};
+    TEST_ASSERT_EQ_INT32(cache_lookup(cache, 1, &loaded), FORT_OUTCOME_OK);
+    TEST_ASSERT_TRUE(strcmp(loaded.func.name.p, "second") == 0);
+
+    char path[PATH_LEN];
+    entry_path(dir, 1, path, sizeof(path));
+    FORT_UNUSED(unlink(path));
+    FORT_UNUSED(rmdir(dir));
+    jit_prog_fini(&loaded);
+    jit_prog_fini(&second);
+    jit_prog_fini(&first);
+    cache_fini(cache);
+})
+
+TEST(creates_missing_dir, {
+    char parent[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(parent));
+    char dir[PATH_LEN];
+    FORT_UNUSED(snprintf(dir, sizeof(dir), "%s/sub", parent));
+
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    FORT_UNUSED(rmdir(dir));
+    FORT_UNUSED(rmdir(parent));
+    cache_fini(cache);
+})
+
+TEST(path_too_long_is_error, {
+    // Padding with "/." keeps the directory valid while leaving no room for
+    // the entry's file name.
+    char base[] = "/tmp/fort-cache-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(base));
+    char dir[LONG_PATH_LEN];
+    size_t len = strlen(base);
+    memcpy(dir, base, len);
+    while (len + 2 < sizeof(dir) - 1) {
+        memcpy(dir + len, "/.", 2);
+        len += 2;
+    }
+    dir[len] = '\0';
+
+    cache_t* cache = mkcache(dir);
+    TEST_ASSERT_NONNULL(cache);
+
+    jit_prog_t jit_prog = make_jit_prog("main");
+    TEST_ASSERT_EQ_INT32(cache_store(cache, 1, &jit_prog), FORT_OUTCOME_ERR);
+    jit_prog_t loaded = {0};
+    TEST_ASSERT_EQ_INT32(cache_lookup(cache, 1, &loaded), FORT_OUTCOME_ERR);
+
+    cache_stats_t stats = {0};
+    cache_stats(cache, &stats);
+    TEST_ASSERT_EQ_INT64(stats.misses, (uint64_t)1);
+
+    FORT_UNUSED(rmdir(base));
+    jit_prog_fini(&jit_prog);
+    cache_fini(cache);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("cache", argc, argv);
+
+    TEST_RUN(key_is_deterministic);
+    TEST_RUN(key_depends_on_src_and_opts);
+    TEST_RUN(key_separates_fields);
+    TEST_RUN(store_then_lookup);
+    TEST_RUN(lookup_miss);
+    TEST_RUN(corrupt_entry_is_miss);
+    TEST_RUN(store_overwrites);
+    TEST_RUN(creates_missing_dir);
+    TEST_RUN(path_too_long_is_error);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,151 @@
+#include "cfg.h"
+
+#include <stddef.h>    // for NULL, size_t
+#include <stdint.h>    // for int32_t
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for asm_func_t, inst_t, INST_MOV, INST_RET
+#include "common.h"    // for NELEM
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+// Links `n` instructions of the given kinds into `func`.
+static void make_func(asm_func_t* func, const inst_kind_t* kinds, size_t n) {
+    *func = (asm_func_t){0};
+    inst_t** link = &func->inst;
+    for (size_t i = 0; i < n; ++i) {
+        inst_t* inst = fort_alloc(ALLOC_CODEGEN, sizeof(inst_t));
+        *inst = (inst_t){0};
+        inst->kind = kinds[i];
+        if (kinds[i] == INST_MOV) {
+            inst->u.mov.src = (op_t){{{(int32_t)i}}, OP_IMM};
+            inst->u.mov.dst = (op_t){{{REG_EAX}}, OP_REG};
+        }
+        *link = inst;
+        link = &inst->next;
+    }
+}
+
+static void free_func(asm_func_t* func) {
+    inst_t* inst = func->inst;
+    while (inst != NULL) {
+        inst_t* next = inst->next;
+        fort_free(inst);
+        inst = next;
+    }
+}
+
+// Instruction sequences; TEST bodies cannot hold brace lists with commas.
+static const inst_kind_t STRAIGHT_LINE[] = {INST_MOV, INST_MOV, INST_RET};
+static const inst_kind_t AFTER_RET[] = {INST_MOV, INST_RET, INST_MOV, INST_MOV, INST_RET, INST_RET};
+static const inst_kind_t NO_TRAILING_RET[] = {INST_RET, INST_MOV};
+static const inst_kind_t TWO_RETS[] = {INST_MOV, INST_RET, INST_MOV, INST_RET};
+
+TEST(empty_function_has_no_blocks, {
+    asm_func_t func = {0};
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+
+    TEST_ASSERT_EQ_SIZE(cfg.nblocks, 0);
+    TEST_ASSERT_EQ_SIZE(cfg.nrpo, 0);
+
+    dom_t dom = {0};
+    dom_build(&cfg, &dom);
+    TEST_ASSERT_FALSE(dom_dominates(&dom, 0, 0));
+
+    dom_fini(&dom);
+    cfg_fini(&cfg);
+})
+
+TEST(straight_line_is_one_block, {
+    asm_func_t func = {0};
+    make_func(&func, STRAIGHT_LINE, NELEM(STRAIGHT_LINE));
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+
+    TEST_ASSERT_EQ_SIZE(cfg.nblocks, 1);
+    TEST_ASSERT_TRUE(cfg.blocks[0].first == func.inst);
+    TEST_ASSERT_TRUE(cfg.blocks[0].last == func.inst->next->next);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[0].ninsts, 3);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[0].nsuccs, 0);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[0].npreds, 0);
+    TEST_ASSERT_EQ_SIZE(cfg.nrpo, 1);
+    TEST_ASSERT_TRUE(cfg_reachable(&cfg, 0));
+
+    cfg_fini(&cfg);
+    free_func(&func);
+})
+
+TEST(code_after_ret_is_unreachable, {
+    asm_func_t func = {0};
+    make_func(&func, AFTER_RET, NELEM(AFTER_RET));
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+
+    TEST_ASSERT_EQ_SIZE(cfg.nblocks, 3);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[0].ninsts, 2);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[1].ninsts, 3);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[2].ninsts, 1);
+    TEST_ASSERT_TRUE(cfg.blocks[1].first == func.inst->next->next);
+    for (size_t b = 0; b < cfg.nblocks; ++b) {
+        TEST_ASSERT_EQ_SIZE(cfg.blocks[b].nsuccs, 0);
+        TEST_ASSERT_EQ_SIZE(cfg.blocks[b].npreds, 0);
+    }
+
+    TEST_ASSERT_EQ_SIZE(cfg.nrpo, 1);
+    TEST_ASSERT_EQ_SIZE(cfg.rpo[0], 0);
+    TEST_ASSERT_TRUE(cfg_reachable(&cfg, 0));
+    TEST_ASSERT_FALSE(cfg_reachable(&cfg, 1));
+    TEST_ASSERT_FALSE(cfg_reachable(&cfg, 2));
+
+    cfg_fini(&cfg);
+    free_func(&func);
+})
+
+TEST(trailing_block_without_ret, {
+    // The last block may lack a terminator; there is nothing to fall into.
+    asm_func_t func = {0};
+    make_func(&func, NO_TRAILING_RET, NELEM(NO_TRAILING_RET));
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+
+    TEST_ASSERT_EQ_SIZE(cfg.nblocks, 2);
+    TEST_ASSERT_EQ_SIZE(cfg.blocks[1].nsuccs, 0);
+    TEST_ASSERT_FALSE(cfg_reachable(&cfg, 1));
+
+    cfg_fini(&cfg);
+    free_func(&func);
+})
+
+TEST(entry_dominates_itself_only, {
+    asm_func_t func = {0};
+    make_func(&func, TWO_RETS, NELEM(TWO_RETS));
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+    dom_t dom = {0};
+    dom_build(&cfg, &dom);
+
+    TEST_ASSERT_EQ_SIZE(dom.nblocks, 2);
+    TEST_ASSERT_TRUE(dom.idom[0] == CFG_NONE);
+    TEST_ASSERT_TRUE(dom.idom[1] == CFG_NONE);
+    TEST_ASSERT_TRUE(dom_dominates(&dom, 0, 0));
+    TEST_ASSERT_FALSE(dom_dominates(&dom, 0, 1));
+    TEST_ASSERT_FALSE(dom_dominates(&dom, 1, 1));
+    TEST_ASSERT_FALSE(dom_dominates(&dom, 1, 0));
+    TEST_ASSERT_FALSE(dom_dominates(&dom, 0, 2));
+
+    dom_fini(&dom);
+    cfg_fini(&cfg);
+    free_func(&func);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("cfg", argc, argv);
+
+    TEST_RUN(empty_function_has_no_blocks);
+    TEST_RUN(straight_line_is_one_block);
+    TEST_RUN(code_after_ret_is_unreachable);
+    TEST_RUN(trailing_block_without_ret);
+    TEST_RUN(entry_dominates_itself_only);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,228 @@
+#include "divmagic.h"
+
+#include <inttypes.h>  // for PRId32
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for int32_t, int64_t, uint32_t, INT32_MAX, INT32_MIN
+
+#include "common.h"    // for NELEM, FORT_OUTCOME_OK, FORT_OUTCOME_ERR
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+// Dividends every divisor is checked against, on top of the ones derived
+// from the divisor.
+static const int32_t EDGES[] = {
+    0, 1, -1, 2, -2, 3, -3, 7, -7, 100, -100, INT32_MAX, INT32_MAX - 1, INT32_MIN, INT32_MIN + 1,
+    INT32_MIN + 2, 0x40000000, -0x40000000, 0x3FFFFFFF, -0x3FFFFFFF,
+};
+
+// Magic numbers and shifts from Hacker's Delight table 10-1.
+typedef struct {
+    int32_t divisor;
+    uint32_t magic;
+    unsigned shift;
+} known_t;
+
+static const known_t KNOWN[] = {
+    {3, 0x55555556, 0},  {5, 0x66666667, 1},  {6, 0x2AAAAAAB, 0},  {7, 0x92492493, 2},
+    {-3, 0x55555555, 1}, {-5, 0x99999999, 1}, {-7, 0x6DB6DB6D, 2}, {1000, 0x10624DD3, 6},
+};
+
+static const int32_t ENDS[] = {INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 1};
+
+// One for each correction: none, add, subtract, and a power of two.
+static const int32_t DENSE[] = {3, 7, -7, 10, -16};
+
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// C's / and %, except that INT32_MIN / -1 wraps as in the plan.
+static int32_t c_div(int32_t x, int32_t d) {
+    return d == -1 ? (int32_t)(0U - (uint32_t)x) : x / d;
+}
+
+static int32_t c_mod(int32_t x, int32_t d) {
+    return d == -1 ? 0 : x % d;
+}
+
+static int32_t sample(int64_t x) {
+    return x < INT32_MIN ? INT32_MIN : x > INT32_MAX ? INT32_MAX : (int32_t)x;
+}
+
+// Checks the plan for `d` at the edges, around the multiples of d nearest
+// zero and both ends of the range where the rounding is decided, and on a
+// stride across the whole range. Returns the first dividend that differs
+// from C in `bad`.
+static bool check_divisor(int32_t d, int32_t* bad) {
+    divmagic_t plan;
+    if (divmagic_plan(d, &plan) != FORT_OUTCOME_OK) {
+        *bad = 0;
+        return false;
+    }
+
+    int32_t xs[NELEM(EDGES) + 25 + 1024];
+    size_t n = 0;
+    for (size_t i = 0; i < NELEM(EDGES); ++i) {
+        xs[n++] = EDGES[i];
+    }
+    const int64_t ad = d < 0 ? -(int64_t)d : d;
+    const int64_t top = (INT32_MAX / ad) * ad;
+    const int64_t centres[] = {0, ad, -ad, top, -top};
+    for (size_t c = 0; c < NELEM(centres); ++c) {
+        for (int64_t delta = -2; delta <= 2; ++delta) {
+            xs[n++] = sample(centres[c] + delta);
+        }
+    }
+    for (int64_t x = INT32_MIN; n < NELEM(xs); x += 4194301) {
+        xs[n++] = (int32_t)x;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (divmagic_div(&plan, xs[i]) != c_div(xs[i], d) ||
+            divmagic_mod(&plan, xs[i]) != c_mod(xs[i], d)) {
+            *bad = xs[i];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TEST(zero_divisor_fails, {
+    divmagic_t plan;
+    TEST_ASSERT_TRUE(divmagic_plan(0, &plan) == FORT_OUTCOME_ERR);
+})
+
+TEST(plan_kinds, {
+    divmagic_t plan;
+    divmagic_plan(1, &plan);
+    TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_IDENTITY);
+    divmagic_plan(-1, &plan);
+    TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_NEGATE);
+
+    divmagic_plan(8, &plan);
+    TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_POW2);
+    TEST_ASSERT_EQ_SIZE((size_t)plan.shift, 3);
+    TEST_ASSERT_FALSE(plan.negate);
+    divmagic_plan(INT32_MIN, &plan);
+    TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_POW2);
+    TEST_ASSERT_EQ_SIZE((size_t)plan.shift, 31);
+    TEST_ASSERT_TRUE(plan.negate);
+
+    divmagic_plan(INT32_MAX, &plan);
+    TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_MUL);
+})
+
+TEST(known_magic_numbers, {
+    for (size_t i = 0; i < NELEM(KNOWN); ++i) {
+        divmagic_t plan;
+        divmagic_plan(KNOWN[i].divisor, &plan);
+        TEST_ASSERT_TRUE(plan.kind == DIVMAGIC_MUL);
+        TEST_ASSERT_EQ_INT64((int64_t)(uint32_t)plan.magic, (int64_t)KNOWN[i].magic);
+        TEST_ASSERT_EQ_SIZE((size_t)plan.shift, (size_t)KNOWN[i].shift);
+    }
+
+    divmagic_t plan;
+    divmagic_plan(7, &plan);
+    TEST_ASSERT_TRUE(plan.add);
+    divmagic_plan(-7, &plan);
+    TEST_ASSERT_TRUE(plan.sub);
+    divmagic_plan(3, &plan);
+    TEST_ASSERT_FALSE(plan.add || plan.sub);
+})
+
+TEST(int_min_dividend, {
+    divmagic_t plan;
+    divmagic_plan(-1, &plan);
+    TEST_ASSERT_EQ_INT32(divmagic_div(&plan, INT32_MIN), INT32_MIN);
+    TEST_ASSERT_EQ_INT32(divmagic_mod(&plan, INT32_MIN), 0);
+
+    divmagic_plan(INT32_MIN, &plan);
+    TEST_ASSERT_EQ_INT32(divmagic_div(&plan, INT32_MIN), 1);
+    TEST_ASSERT_EQ_INT32(divmagic_div(&plan, INT32_MAX), 0);
+    TEST_ASSERT_EQ_INT32(divmagic_mod(&plan, INT32_MAX), INT32_MAX);
+
+    divmagic_plan(2, &plan);
+    TEST_ASSERT_EQ_INT32(divmagic_div(&plan, INT32_MIN), INT32_MIN / 2);
+    divmagic_plan(-2, &plan);
+    TEST_ASSERT_EQ_INT32(divmagic_div(&plan, INT32_MIN), 0x40000000);
+})
+
+TEST(small_divisors, {
+    int32_t bad = 0;
+    for (int32_t d = -4096; d <= 4096; ++d) {
+        if (d != 0 && !check_divisor(d, &bad)) {
+            TEST_ASSERT_EQ_INT32(d, 0);
+        }
+    }
+    TEST_ASSERT_EQ_INT32(bad, 0);
+})
+
+TEST(powers_of_two_and_neighbours, {
+    int32_t bad = 0;
+    for (unsigned k = 1; k < 31; ++k) {
+        const int32_t p = (int32_t)(1U << k);
+        for (int32_t delta = -1; delta <= 1; ++delta) {
+            if (!check_divisor(p + delta, &bad)) {
+                TEST_ASSERT_EQ_INT32(p + delta, 0);
+            }
+            if (!check_divisor(-p + delta, &bad)) {
+                TEST_ASSERT_EQ_INT32(-p + delta, 0);
+            }
+        }
+    }
+    for (size_t i = 0; i < NELEM(ENDS); ++i) {
+        if (!check_divisor(ENDS[i], &bad)) {
+            TEST_ASSERT_EQ_INT32(ENDS[i], 0);
+        }
+    }
+    TEST_ASSERT_EQ_INT32(bad, 0);
+})
+
+TEST(random_divisors, {
+    int32_t bad = 0;
+    uint32_t state = 0x2545F491;
+    for (size_t i = 0; i < 4096; ++i) {
+        // Spread over magnitudes rather than uniformly, which would give
+        // almost only divisors above 2^20.
+        const uint32_t r = next_random(&state);
+        const uint32_t u = r >> (r & 31);
+        const int32_t d = (int32_t)(u & 0x7FFFFFFF) * ((r & 0x100) != 0 ? -1 : 1);
+        if (d != 0 && !check_divisor(d, &bad)) {
+            TEST_ASSERT_EQ_INT32(d, 0);
+        }
+    }
+    TEST_ASSERT_EQ_INT32(bad, 0);
+})
+
+TEST(dense_dividends, {
+    // Every 251st dividend, so each residue class is visited many times.
+    for (size_t i = 0; i < NELEM(DENSE); ++i) {
+        divmagic_t plan;
+        divmagic_plan(DENSE[i], &plan);
+        for (int64_t x = INT32_MIN; x <= INT32_MAX; x += 251) {
+            const int32_t x32 = (int32_t)x;
+            if (divmagic_div(&plan, x32) != x32 / DENSE[i]) {
+                TEST_ASSERT_EQ_INT32(divmagic_div(&plan, x32), x32 / DENSE[i]);
+            }
+        }
+    }
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("divmagic", argc, argv);
+
+    TEST_RUN(zero_divisor_fails);
+    TEST_RUN(plan_kinds);
+    TEST_RUN(known_magic_numbers);
+    TEST_RUN(int_min_dividend);
+    TEST_RUN(small_divisors);
+    TEST_RUN(powers_of_two_and_neighbours);
+    TEST_RUN(random_divisors);
+    TEST_RUN(dense_dividends);
+
+    TEST_EXIT();
+}
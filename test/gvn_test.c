@@ -0,0 +1,195 @@
+#include "gvn.h"
+
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for NULL, size_t
+#include <stdint.h>    // for int32_t
+
+#include "assemble.h"  // for asm_func_t, inst_t, INST_MOV, INST_RET, INST_XOR, OP_IMM, OP_REG
+#include "cfg.h"       // for cfg_t, dom_t, block_t, cfg_build, cfg_fini, dom_build, dom_fini
+#include "test.h"      // for TEST_ASSERT_*, TEST
+#include "test_ir.h"   // for link_insts, set_mov_imm, set_mov_reg, set_ret, set_xor
+
+#define R1 ((size_t)REG_EAX + 1)
+#define R2 ((size_t)REG_EAX + 2)
+
+// Links insts[0, n) into `func` and finds its redundant instructions.
+static size_t find(inst_t* insts, size_t n, bool* redundant) {
+    link_insts(insts, n);
+    asm_func_t func = {0};
+    func.inst = insts;
+
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+    dom_t dom = {0};
+    dom_build(&cfg, &dom);
+    const size_t found = gvn_find(&func, &cfg, &dom, redundant);
+    dom_fini(&dom);
+    cfg_fini(&cfg);
+
+    return found;
+}
+
+TEST(same_constant_twice, {
+    inst_t insts[3];
+    set_mov_imm(&insts[0], R1, 5);
+    set_mov_imm(&insts[1], R1, 5);
+    set_ret(&insts[2]);
+    bool redundant[3];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 3, redundant), 1);
+    TEST_ASSERT_FALSE(redundant[0]);
+    TEST_ASSERT_TRUE(redundant[1]);
+    TEST_ASSERT_FALSE(redundant[2]);
+})
+
+TEST(copies_share_numbers, {
+    // After mov %r1, %r2 both hold 5, so neither writing 5 nor copying
+    // again changes anything.
+    inst_t insts[5];
+    set_mov_imm(&insts[0], R1, 5);
+    set_mov_reg(&insts[1], R2, R1);
+    set_mov_reg(&insts[2], R2, R1);
+    set_mov_imm(&insts[3], R2, 5);
+    set_ret(&insts[4]);
+    bool redundant[5];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 5, redundant), 2);
+    TEST_ASSERT_FALSE(redundant[1]);
+    TEST_ASSERT_TRUE(redundant[2]);
+    TEST_ASSERT_TRUE(redundant[3]);
+})
+
+TEST(unknown_registers_get_numbers, {
+    // Nothing is known about %r1 on entry, but copying it twice is still
+    // one copy too many.
+    inst_t insts[3];
+    set_mov_reg(&insts[0], R2, R1);
+    set_mov_reg(&insts[1], R2, R1);
+    set_ret(&insts[2]);
+    bool redundant[3];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 3, redundant), 1);
+    TEST_ASSERT_TRUE(redundant[1]);
+})
+
+TEST(zero_idiom_is_constant_zero, {
+    inst_t insts[3];
+    set_mov_imm(&insts[0], REG_EAX, 0);
+    set_xor(&insts[1], REG_EAX, REG_EAX);
+    set_ret(&insts[2]);
+    bool redundant[3];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 3, redundant), 1);
+    TEST_ASSERT_TRUE(redundant[1]);
+})
+
+TEST(overwritten_values_are_not_redundant, {
+    inst_t insts[4];
+    set_mov_imm(&insts[0], R1, 1);
+    set_mov_imm(&insts[1], R1, 2);
+    set_mov_imm(&insts[2], R1, 1);
+    set_ret(&insts[3]);
+    bool redundant[4];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 4, redundant), 0);
+})
+
+TEST(xor_changes_its_destination, {
+    // Each xor %r2, %r1 flips %r1 again, so neither is redundant even
+    // though both compute "r1 ^ r2" from the same-looking operands.
+    inst_t insts[3];
+    set_xor(&insts[0], R1, R2);
+    set_xor(&insts[1], R1, R2);
+    set_ret(&insts[2]);
+    bool redundant[3];
+
+    TEST_ASSERT_EQ_SIZE(find(insts, 3, redundant), 0);
+})
+
+TEST(dominator_tree_scopes, {
+    // b0: mov $7, %r1            -> b1, b2
+    // b1: mov $7, %r1  redundant -> b3
+    // b2: mov $8, %r1            -> b3
+    // b3: mov $7, %r1; ret       two predecessors, so nothing carries over
+    inst_t insts[5];
+    set_mov_imm(&insts[0], R1, 7);
+    set_mov_imm(&insts[1], R1, 7);
+    set_mov_imm(&insts[2], R1, 8);
+    set_mov_imm(&insts[3], R1, 7);
+    set_ret(&insts[4]);
+    for (size_t i = 0; i + 1 < 5; ++i) {
+        insts[i].next = &insts[i + 1];
+    }
+    insts[4].next = NULL;
+    asm_func_t func = {0};
+    func.inst = insts;
+
+    block_t blocks[4];
+    for (size_t b = 0; b < 4; ++b) {
+        blocks[b] = (block_t){0};
+        blocks[b].first = &insts[b];
+        blocks[b].last = &insts[b];
+        blocks[b].ninsts = 1;
+    }
+    blocks[3].last = &insts[4];
+    blocks[3].ninsts = 2;
+    blocks[0].succs[blocks[0].nsuccs++] = 1;
+    blocks[0].succs[blocks[0].nsuccs++] = 2;
+    blocks[1].succs[blocks[1].nsuccs++] = 3;
+    blocks[2].succs[blocks[2].nsuccs++] = 3;
+    size_t preds[4];
+    preds[0] = 0;
+    preds[1] = 0;
+    preds[2] = 1;
+    preds[3] = 2;
+    blocks[1].pred_start = 0;
+    blocks[1].npreds = 1;
+    blocks[2].pred_start = 1;
+    blocks[2].npreds = 1;
+    blocks[3].pred_start = 2;
+    blocks[3].npreds = 2;
+    size_t rpo[4];
+    rpo[0] = 0;
+    rpo[1] = 2;
+    rpo[2] = 1;
+    rpo[3] = 3;
+    size_t rpo_index[4];
+    for (size_t i = 0; i < 4; ++i) {
+        rpo_index[rpo[i]] = i;
+    }
+    cfg_t cfg = {0};
+    cfg.blocks = blocks;
+    cfg.nblocks = 4;
+    cfg.preds = preds;
+    cfg.rpo = rpo;
+    cfg.nrpo = 4;
+    cfg.rpo_index = rpo_index;
+
+    dom_t dom = {0};
+    dom_build(&cfg, &dom);
+    TEST_ASSERT_EQ_SIZE(dom.idom[1], 0);
+    TEST_ASSERT_EQ_SIZE(dom.idom[2], 0);
+    TEST_ASSERT_EQ_SIZE(dom.idom[3], 0);
+
+    bool redundant[5];
+    TEST_ASSERT_EQ_SIZE(gvn_find(&func, &cfg, &dom, redundant), 1);
+    TEST_ASSERT_TRUE(redundant[1]);
+    TEST_ASSERT_FALSE(redundant[2]);
+    TEST_ASSERT_FALSE(redundant[3]);
+
+    dom_fini(&dom);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("gvn", argc, argv);
+
+    TEST_RUN(same_constant_twice);
+    TEST_RUN(copies_share_numbers);
+    TEST_RUN(unknown_registers_get_numbers);
+    TEST_RUN(zero_idiom_is_constant_zero);
+    TEST_RUN(overwritten_values_are_not_redundant);
+    TEST_RUN(xor_changes_its_destination);
+    TEST_RUN(dominator_tree_scopes);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,238 @@
+#include "jit.h"
+
+#include <stddef.h>    // for NULL
+#include <stdint.h>    // for int32_t, uint8_t
+#include <string.h>    // for memcmp, strcmp, strlen
+
+#include "assemble.h"  // for asm_prog_t, mkassembler, assembler_run
+#include "parse.h"     // for prog_t
+#include "test.h"      // for TEST_ASSERT_*, TEST
+#include "test_ir.h"   // for make_return_prog
+
+// mov $42, %eax; ret
+static const uint8_t MOV_42_RET[] = {0xB8, 0x2A, 0x00, 0x00, 0x00, 0xC3};
+
+// mov $-2, %eax; ret
+static const uint8_t MOV_NEG2_RET[] = {0xB8, 0xFE, 0xFF, 0xFF, 0xFF, 0xC3};
+
+// mov %eax, %eax; ret
+static const uint8_t MOV_EAX_EAX_RET[] = {0x89, 0xC0, 0xC3};
+
+// xor %eax, %eax; ret
+static const uint8_t XOR_EAX_EAX_RET[] = {0x31, 0xC0, 0xC3};
+
+static fort_outcome_t jit_compile(prog_t* prog, jit_prog_t* jit_prog) {
+    assembler_t* assembler = mkassembler(prog);
+    asm_prog_t asm_prog = {0};
+    fort_outcome_t outcome = assembler_run(assembler, &asm_prog);
+    assembler_fini(assembler);
+    if (outcome != FORT_OUTCOME_OK) {
+        asm_prog_fini(&asm_prog);
+        return outcome;
+    }
+
+    jit_t* jit = mkjit(&asm_prog);
+    outcome = jit_run(jit, jit_prog);
+    jit_fini(jit);
+    asm_prog_fini(&asm_prog);
+
+    return outcome;
+}
+
+TEST(encode_mov_imm_ret, {
+    prog_t prog = make_return_prog("main", 42);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.len, sizeof(MOV_42_RET));
+    TEST_ASSERT_TRUE(memcmp(jit_prog.func.code, MOV_42_RET, sizeof(MOV_42_RET)) == 0);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(encode_negative_imm, {
+    prog_t prog = make_return_prog("main", -2);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.len, sizeof(MOV_NEG2_RET));
+    TEST_ASSERT_TRUE(memcmp(jit_prog.func.code, MOV_NEG2_RET, sizeof(MOV_NEG2_RET)) == 0);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(name_is_owned_and_terminated, {
+    char name[] = "foo";
+    prog_t prog = make_return_prog(name, 1);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+    name[0] = 'x';
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.name.len, 3);
+    TEST_ASSERT_TRUE(strcmp(jit_prog.func.name.p, "foo") == 0);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(encode_mov_reg_reg, {
+    inst_t ret = {0};
+    ret.kind = INST_RET;
+    inst_t mov = {0};
+    mov.kind = INST_MOV;
+    mov.u.mov.src.kind = OP_REG;
+    mov.u.mov.src.u.reg = REG_EAX;
+    mov.u.mov.dst.kind = OP_REG;
+    mov.u.mov.dst.u.reg = REG_EAX;
+    mov.next = &ret;
+    asm_prog_t asm_prog = {0};
+    asm_prog.func.name.p = "f";
+    asm_prog.func.name.len = 1;
+    asm_prog.func.inst = &mov;
+
+    jit_t* jit = mkjit(&asm_prog);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_run(jit, &jit_prog);
+    jit_fini(jit);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.len, sizeof(MOV_EAX_EAX_RET));
+    TEST_ASSERT_TRUE(memcmp(jit_prog.func.code, MOV_EAX_EAX_RET, sizeof(MOV_EAX_EAX_RET)) == 0);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(encode_xor_reg_reg, {
+    inst_t ret = {0};
+    ret.kind = INST_RET;
+    inst_t xor = {0};
+    xor.kind = INST_XOR;
+    xor.u.xor.src.kind = OP_REG;
+    xor.u.xor.src.u.reg = REG_EAX;
+    xor.u.xor.dst.kind = OP_REG;
+    xor.u.xor.dst.u.reg = REG_EAX;
+    xor.next = &ret;
+    asm_prog_t asm_prog = {0};
+    asm_prog.func.name.p = "f";
+    asm_prog.func.name.len = 1;
+    asm_prog.func.inst = &xor;
+
+    jit_t* jit = mkjit(&asm_prog);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_run(jit, &jit_prog);
+    jit_fini(jit);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.len, sizeof(XOR_EAX_EAX_RET));
+    TEST_ASSERT_TRUE(memcmp(jit_prog.func.code, XOR_EAX_EAX_RET, sizeof(XOR_EAX_EAX_RET)) == 0);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(exec_returns_value, {
+    prog_t prog = make_return_prog("main", 123);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    jit_opts_t opts = {0};
+    int32_t ret = 0;
+    outcome = jit_exec(&jit_prog, &opts, &ret);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(ret, 123);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(exec_int32_min, {
+    prog_t prog = make_return_prog("main", INT32_MIN);
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    jit_opts_t opts = {0};
+    int32_t ret = 0;
+    outcome = jit_exec(&jit_prog, &opts, &ret);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(ret, INT32_MIN);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(exec_picks_main, {
+    prog_t prog = make_return_prog("helper", 1);
+    func_t main_func = make_return_prog("main", 2).func;
+    prog.func.next = &main_func;
+
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_compile(&prog, &jit_prog);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(jit_prog.func.name.len, strlen("main"));
+
+    jit_opts_t opts = {0};
+    int32_t ret = 0;
+    outcome = jit_exec(&jit_prog, &opts, &ret);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(ret, 2);
+
+    jit_prog_fini(&jit_prog);
+})
+
+TEST(exec_empty_prog, {
+    jit_prog_t jit_prog = {0};
+    jit_opts_t opts = {0};
+    int32_t ret = 0;
+    fort_outcome_t outcome = jit_exec(&jit_prog, &opts, &ret);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_FATAL);
+})
+
+TEST(null_jit, {
+    jit_prog_t jit_prog = {0};
+    fort_outcome_t outcome = jit_run(NULL, &jit_prog);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_FATAL);
+})
+
+TEST(null_jit_prog, {
+    prog_t prog = make_return_prog("main", 0);
+    assembler_t* assembler = mkassembler(&prog);
+    asm_prog_t asm_prog = {0};
+    fort_outcome_t outcome = assembler_run(assembler, &asm_prog);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    jit_t* jit = mkjit(&asm_prog);
+    outcome = jit_run(jit, NULL);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_FATAL);
+
+    jit_fini(jit);
+    asm_prog_fini(&asm_prog);
+    assembler_fini(assembler);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("jit", argc, argv);
+
+    TEST_RUN(encode_mov_imm_ret);
+    TEST_RUN(encode_negative_imm);
+    TEST_RUN(name_is_owned_and_terminated);
+    TEST_RUN(encode_mov_reg_reg);
+    TEST_RUN(encode_xor_reg_reg);
+    TEST_RUN(exec_returns_value);
+    TEST_RUN(exec_int32_min);
+    TEST_RUN(exec_picks_main);
+    TEST_RUN(exec_empty_prog);
+    TEST_RUN(null_jit);
+    TEST_RUN(null_jit_prog);
+
+    TEST_EXIT();
+}
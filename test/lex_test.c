@@ -2,9 +2,14 @@
 
 #include <stdbool.h>  // for bool
 #include <stddef.h>   // for NULL, size_t
-#include <string.h>   // for strlen, strncmp
+#include <stdlib.h>   // for free, malloc
+#include <string.h>   // for memcpy, strlen, strncmp
 
-#include "test.h"     // for TEST_ASSERT_EQ_INT32, TEST_ASSERT_TRUE, TEST
+#include "arena.h"    // for arena_fini, arena_reset, mkarena
+#include "test.h"     // for TEST_ASSERT_EQ_INT32, TEST_ASSERT_TRUE, TEST, TEST_BENCH...
+
+#define LARGE_SRC_SZ (1024 * 1024)
+#define ARENA_CHUNK_SZ (64 * 1024)
 
 static bool lexeme_equals(const tok_t* tok, const char* expected) {
     size_t expected_len = strlen(expected);
@@ -434,6 +439,58 @@ TEST(empty_comment, {
     lexer_fini(lexer);
 })
 
+// About `sz` bytes of one function repeated, NUL-terminated.
+static char* mklarge_src(size_t sz) {
+    static const char func[] = "i32 fvalue(void) {\n    return 42; // answer\n}\n";
+    const size_t func_len = sizeof(func) - 1;
+    const size_t n = sz / func_len;
+
+    char* src = malloc(n * func_len + 1);
+    for (size_t i = 0; i < n; ++i) {
+        memcpy(src + i * func_len, func, func_len);
+    }
+    src[n * func_len] = '\0';
+
+    return src;
+}
+
+static fort_outcome_t lex_into(const char* src, arena_t* arena) {
+    lexer_t* lexer = mklexer(src, strlen(src));
+    tok_stream_t toks = {.arena = arena};
+    const fort_outcome_t outcome = lexer_run(lexer, &toks);
+    tok_stream_fini(&toks);
+    lexer_fini(lexer);
+
+    return outcome;
+}
+
+// Once an arena has grown to fit the tokens, lexing more input of the same
+// size only allocates the lexer itself.
+TEST(warm_arena_lexing_allocates_o1, {
+    char* src = mklarge_src(LARGE_SRC_SZ);
+    arena_t* arena = mkarena(ARENA_CHUNK_SZ);
+    TEST_ASSERT_EQ_INT32(lex_into(src, arena), FORT_OUTCOME_OK);
+    arena_reset(arena);
+
+    TEST_ALLOCS_BEGIN();
+    const fort_outcome_t outcome = lex_into(src, arena);
+    TEST_ASSERT_ALLOCS_LE(1, 1024);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    arena_fini(arena);
+    free(src);
+})
+
+TEST_BENCH(lex_1mb, 5, {
+    char* src = mklarge_src(LARGE_SRC_SZ);
+    arena_t* arena = mkarena(ARENA_CHUNK_SZ);
+    fort_outcome_t outcome = FORT_OUTCOME_ERR;
+    TEST_BENCH_TIMED(outcome = lex_into(src, arena));
+    arena_fini(arena);
+    free(src);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+})
+
 int main(int argc, char* argv[]) {
     TEST_INIT("lex", argc, argv);
 
@@ -454,6 +511,8 @@ int main(int argc, char* argv[]) {
     TEST_RUN(comment_with_code_like_content);
     TEST_RUN(function_with_comments);
     TEST_RUN(empty_comment);
+    TEST_RUN(warm_arena_lexing_allocates_o1);
+    TEST_RUN(lex_1mb);
 
     TEST_EXIT();
 }
@@ -0,0 +1,260 @@
+#include "live.h"
+
+#include <stdbool.h>   // for bool, false, true
+#include <stddef.h>    // for NULL, size_t
+#include <stdint.h>    // for int32_t
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "assemble.h"  // for inst_t, op_t, INST_MOV, INST_RET, INST_XOR, OP_IMM, OP_REG
+#include "bitset.h"    // for bitset_word_t, bitset_set, bitset_test, bitset_count
+#include "cfg.h"       // for cfg_t, block_t, cfg_build, cfg_fini
+#include "test.h"      // for TEST_ASSERT_*, TEST, TEST_BENCH, TEST_BENCH_TIMED
+#include "test_ir.h"   // for link_insts, set_mov_imm, set_mov_reg, set_ret
+
+// Temporaries for the large functions; far more than any real register file.
+#define NTEMPS 100000
+
+static void set_block(block_t* block, inst_t* first, size_t ninsts) {
+    *block = (block_t){0};
+    block->first = first;
+    block->last = first + ninsts - 1;
+    block->ninsts = ninsts;
+}
+
+TEST(bitset_ops, {
+    bitset_word_t a[2] = {0};
+    bitset_word_t b[2] = {0};
+    bitset_set(a, 63);
+    bitset_set(a, 64);
+    TEST_ASSERT_TRUE(bitset_test(a, 63));
+    TEST_ASSERT_TRUE(bitset_test(a, 64));
+    TEST_ASSERT_FALSE(bitset_test(a, 65));
+    TEST_ASSERT_EQ_SIZE(bitset_count(a, 2), 2);
+
+    bitset_set(b, 1);
+    TEST_ASSERT_TRUE(bitset_union(b, a, 2));
+    TEST_ASSERT_FALSE(bitset_union(b, a, 2));
+    TEST_ASSERT_EQ_SIZE(bitset_count(b, 2), 3);
+
+    // dst = gen | (src & ~kill)
+    bitset_word_t dst[2] = {0};
+    bitset_word_t kill[2] = {0};
+    bitset_set(kill, 64);
+    TEST_ASSERT_TRUE(bitset_transfer(dst, a, b, kill, 2));
+    TEST_ASSERT_TRUE(bitset_test(dst, 1));
+    TEST_ASSERT_TRUE(bitset_test(dst, 64));
+    TEST_ASSERT_FALSE(bitset_transfer(dst, a, b, kill, 2));
+
+    bitset_clear(dst, 64);
+    TEST_ASSERT_FALSE(bitset_test(dst, 64));
+    TEST_ASSERT_EQ_SIZE(bitset_words(0), 0);
+    TEST_ASSERT_EQ_SIZE(bitset_words(64), 1);
+    TEST_ASSERT_EQ_SIZE(bitset_words(65), 2);
+})
+
+TEST(inst_regs_reads_and_writes, {
+    inst_t inst;
+    inst_regs_t regs;
+
+    set_mov_reg(&inst, 1, 2);
+    inst_regs(&inst, &regs);
+    TEST_ASSERT_EQ_SIZE(regs.nuses, 1);
+    TEST_ASSERT_EQ_INT32(regs.uses[0], 2);
+    TEST_ASSERT_TRUE(regs.has_def);
+    TEST_ASSERT_EQ_INT32(regs.def, 1);
+
+    set_mov_imm(&inst, 3, 7);
+    inst_regs(&inst, &regs);
+    TEST_ASSERT_EQ_SIZE(regs.nuses, 0);
+    TEST_ASSERT_EQ_INT32(regs.def, 3);
+
+    // The zero idiom reads nothing; other xors read both operands.
+    inst.kind = INST_XOR;
+    inst.u.xor.src = inst.u.xor.dst;
+    inst_regs(&inst, &regs);
+    TEST_ASSERT_EQ_SIZE(regs.nuses, 0);
+    TEST_ASSERT_TRUE(regs.has_def);
+    inst.u.xor.src.u.reg = (reg_t)4;
+    inst_regs(&inst, &regs);
+    TEST_ASSERT_EQ_SIZE(regs.nuses, 2);
+
+    set_ret(&inst);
+    inst_regs(&inst, &regs);
+    TEST_ASSERT_EQ_SIZE(regs.nuses, 1);
+    TEST_ASSERT_EQ_INT32(regs.uses[0], REG_EAX);
+    TEST_ASSERT_FALSE(regs.has_def);
+})
+
+TEST(single_block, {
+    // mov %r2, %r1; mov %r1, %eax; ret
+    inst_t insts[3];
+    set_mov_reg(&insts[0], 1, 2);
+    set_mov_reg(&insts[1], REG_EAX, 1);
+    set_ret(&insts[2]);
+    link_insts(insts, 3);
+    asm_func_t func = {0};
+    func.inst = insts;
+
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+    live_t live = {0};
+    live_build(&cfg, &live);
+
+    TEST_ASSERT_EQ_SIZE(live.nregs, 3);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_in(&live, 0), live.nwords), 1);
+    TEST_ASSERT_TRUE(bitset_test(live_in(&live, 0), 2));
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_out(&live, 0), live.nwords), 0);
+
+    live_fini(&live);
+    cfg_fini(&cfg);
+})
+
+TEST(loop_converges, {
+    // b0: mov $0, %r1
+    // b1: mov %r1, %r2; mov %r2, %r1   -> b1, b2
+    // b2: mov %r1, %eax; ret
+    inst_t insts[5];
+    set_mov_imm(&insts[0], 1, 0);
+    set_mov_reg(&insts[1], 2, 1);
+    set_mov_reg(&insts[2], 1, 2);
+    set_mov_reg(&insts[3], REG_EAX, 1);
+    set_ret(&insts[4]);
+    link_insts(insts, 5);
+
+    block_t blocks[3];
+    set_block(&blocks[0], &insts[0], 1);
+    set_block(&blocks[1], &insts[1], 2);
+    set_block(&blocks[2], &insts[3], 2);
+    blocks[0].succs[blocks[0].nsuccs++] = 1;
+    blocks[1].succs[blocks[1].nsuccs++] = 1;
+    blocks[1].succs[blocks[1].nsuccs++] = 2;
+    size_t preds[3];
+    preds[0] = 0;
+    preds[1] = 1;
+    preds[2] = 1;
+    blocks[1].pred_start = 0;
+    blocks[1].npreds = 2;
+    blocks[2].pred_start = 2;
+    blocks[2].npreds = 1;
+    size_t rpo[3];
+    size_t rpo_index[3];
+    for (size_t i = 0; i < 3; ++i) {
+        rpo[i] = i;
+        rpo_index[i] = i;
+    }
+    cfg_t cfg = {0};
+    cfg.blocks = blocks;
+    cfg.nblocks = 3;
+    cfg.preds = preds;
+    cfg.rpo = rpo;
+    cfg.nrpo = 3;
+    cfg.rpo_index = rpo_index;
+
+    live_t live = {0};
+    live_build(&cfg, &live);
+
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_in(&live, 0), live.nwords), 0);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_out(&live, 0), live.nwords), 1);
+    TEST_ASSERT_TRUE(bitset_test(live_out(&live, 0), 1));
+    // r1 flows around the back edge; r2 never leaves b1.
+    TEST_ASSERT_TRUE(bitset_test(live_in(&live, 1), 1));
+    TEST_ASSERT_FALSE(bitset_test(live_in(&live, 1), 2));
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_out(&live, 1), live.nwords), 1);
+    TEST_ASSERT_TRUE(bitset_test(live_out(&live, 1), 1));
+    TEST_ASSERT_TRUE(bitset_test(live_in(&live, 2), 1));
+    TEST_ASSERT_FALSE(bitset_test(live_in(&live, 2), REG_EAX));
+
+    live_fini(&live);
+})
+
+TEST(unreachable_blocks_get_sets, {
+    // mov $1, %eax; ret; mov %r1, %eax; ret
+    inst_t insts[4];
+    set_mov_imm(&insts[0], REG_EAX, 1);
+    set_ret(&insts[1]);
+    set_mov_reg(&insts[2], REG_EAX, 1);
+    set_ret(&insts[3]);
+    link_insts(insts, 4);
+    asm_func_t func = {0};
+    func.inst = insts;
+
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+    live_t live = {0};
+    live_build(&cfg, &live);
+
+    TEST_ASSERT_EQ_SIZE(live.nblocks, 2);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_in(&live, 0), live.nwords), 0);
+    TEST_ASSERT_TRUE(bitset_test(live_in(&live, 1), 1));
+
+    live_fini(&live);
+    cfg_fini(&cfg);
+})
+
+TEST(empty_function, {
+    asm_func_t func = {0};
+    cfg_t cfg = {0};
+    cfg_build(&func, &cfg);
+    live_t live = {0};
+    live_build(&cfg, &live);
+
+    TEST_ASSERT_EQ_SIZE(live.nblocks, 0);
+    TEST_ASSERT_EQ_SIZE(live.nregs, 0);
+
+    live_fini(&live);
+    cfg_fini(&cfg);
+})
+
+// b0 writes every temporary and b1 reads them all back, so all of them are
+// live across the edge at once.
+TEST_BENCH(live_100k_temps, 5, {
+    const size_t ninsts = 2 * NTEMPS + 1;
+    inst_t* insts = fort_alloc(ALLOC_CODEGEN, ninsts * sizeof(inst_t));
+    for (size_t i = 0; i < NTEMPS; ++i) {
+        set_mov_imm(&insts[i], i + 1, (int32_t)i);
+        set_mov_reg(&insts[NTEMPS + i], REG_EAX, i + 1);
+    }
+    set_ret(&insts[2 * NTEMPS]);
+    link_insts(insts, ninsts);
+
+    block_t blocks[2];
+    set_block(&blocks[0], &insts[0], NTEMPS);
+    set_block(&blocks[1], &insts[NTEMPS], NTEMPS + 1);
+    blocks[0].succs[blocks[0].nsuccs++] = 1;
+    blocks[1].npreds = 1;
+    size_t preds[1] = {0};
+    size_t order[2] = {0};
+    order[1] = 1;
+    cfg_t cfg = {0};
+    cfg.blocks = blocks;
+    cfg.nblocks = 2;
+    cfg.preds = preds;
+    cfg.rpo = order;
+    cfg.nrpo = 2;
+    cfg.rpo_index = order;
+
+    live_t live = {0};
+    TEST_BENCH_TIMED(live_build(&cfg, &live));
+
+    TEST_ASSERT_EQ_SIZE(live.nregs, NTEMPS + 1);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_out(&live, 0), live.nwords), NTEMPS);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_in(&live, 1), live.nwords), NTEMPS);
+    TEST_ASSERT_EQ_SIZE(bitset_count(live_in(&live, 0), live.nwords), 0);
+
+    live_fini(&live);
+    fort_free(insts);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("live", argc, argv);
+
+    TEST_RUN(bitset_ops);
+    TEST_RUN(inst_regs_reads_and_writes);
+    TEST_RUN(single_block);
+    TEST_RUN(loop_converges);
+    TEST_RUN(unreachable_blocks_get_sets);
+    TEST_RUN(empty_function);
+    TEST_RUN(live_100k_temps);
+
+    TEST_EXIT();
+}
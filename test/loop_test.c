@@ -0,0 +1,218 @@
+#include "loop.h"
+
+#include <stdbool.h>  // for bool, false, true
+#include <stddef.h>   // for NULL, size_t
+
+#include "cfg.h"      // for cfg_t, dom_t, block_t, dom_build, dom_fini, CFG_NONE
+#include "common.h"   // for NELEM
+#include "test.h"     // for TEST_ASSERT_*, TEST
+
+#define MAX_BLOCKS 8
+
+// A CFG given by its edges, without instructions.
+typedef struct {
+    block_t blocks[MAX_BLOCKS];
+    size_t preds[2 * MAX_BLOCKS];
+    size_t rpo[MAX_BLOCKS];
+    size_t rpo_index[MAX_BLOCKS];
+    cfg_t cfg;
+    dom_t dom;
+} graph_t;
+
+typedef struct {
+    size_t from;
+    size_t to;
+} edge_t;
+
+static void build_graph(graph_t* g, size_t nblocks, const edge_t* edges, size_t nedges) {
+    for (size_t b = 0; b < nblocks; ++b) {
+        g->blocks[b] = (block_t){0};
+    }
+    for (size_t e = 0; e < nedges; ++e) {
+        block_t* from = &g->blocks[edges[e].from];
+        from->succs[from->nsuccs++] = edges[e].to;
+        g->blocks[edges[e].to].npreds++;
+    }
+    size_t start = 0;
+    for (size_t b = 0; b < nblocks; ++b) {
+        g->blocks[b].pred_start = start;
+        start += g->blocks[b].npreds;
+        g->blocks[b].npreds = 0;
+    }
+    for (size_t e = 0; e < nedges; ++e) {
+        block_t* to = &g->blocks[edges[e].to];
+        g->preds[to->pred_start + to->npreds++] = edges[e].from;
+    }
+
+    // Postorder by depth-first search from block 0, then reversed.
+    size_t stack[MAX_BLOCKS];
+    size_t next[MAX_BLOCKS] = {0};
+    bool seen[MAX_BLOCKS] = {false};
+    size_t post[MAX_BLOCKS];
+    size_t npost = 0;
+    size_t depth = 0;
+    stack[depth++] = 0;
+    seen[0] = true;
+    while (depth > 0) {
+        const size_t b = stack[depth - 1];
+        if (next[b] < g->blocks[b].nsuccs) {
+            const size_t succ = g->blocks[b].succs[next[b]++];
+            if (!seen[succ]) {
+                seen[succ] = true;
+                stack[depth++] = succ;
+            }
+            continue;
+        }
+        post[npost++] = b;
+        depth--;
+    }
+    for (size_t b = 0; b < nblocks; ++b) {
+        g->rpo_index[b] = CFG_NONE;
+    }
+    for (size_t i = 0; i < npost; ++i) {
+        g->rpo[i] = post[npost - 1 - i];
+        g->rpo_index[g->rpo[i]] = i;
+    }
+
+    g->cfg = (cfg_t){0};
+    g->cfg.blocks = g->blocks;
+    g->cfg.nblocks = nblocks;
+    g->cfg.preds = g->preds;
+    g->cfg.rpo = g->rpo;
+    g->cfg.nrpo = npost;
+    g->cfg.rpo_index = g->rpo_index;
+    dom_build(&g->cfg, &g->dom);
+}
+
+// Graphs; TEST bodies cannot hold brace lists with commas.
+static const edge_t SIMPLE[] = {{0, 1}, {1, 2}, {2, 1}, {2, 3}};
+static const edge_t NESTED[] = {{0, 1}, {1, 2}, {2, 3}, {3, 2}, {3, 4}, {4, 1}, {4, 5}};
+static const edge_t SHARED_HEADER[] = {{0, 1}, {1, 2}, {1, 3}, {2, 1}, {3, 1}, {3, 4}};
+static const edge_t SELF_LOOP[] = {{0, 1}, {0, 2}, {1, 1}, {1, 2}};
+static const edge_t DIAMOND[] = {{0, 1}, {0, 2}, {1, 3}, {2, 3}};
+static const edge_t IRREDUCIBLE[] = {{0, 1}, {0, 2}, {1, 2}, {2, 1}};
+
+TEST(simple_loop, {
+    graph_t g;
+    build_graph(&g, 4, SIMPLE, NELEM(SIMPLE));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 1);
+    const loop_t* loop = &loops.loops[0];
+    TEST_ASSERT_EQ_SIZE(loop->header, 1);
+    TEST_ASSERT_EQ_SIZE(loop->nblocks, 2);
+    TEST_ASSERT_EQ_SIZE(loops.blocks[loop->block_start], 1);
+    TEST_ASSERT_EQ_SIZE(loops.blocks[loop->block_start + 1], 2);
+    TEST_ASSERT_TRUE(loop->parent == CFG_NONE);
+    TEST_ASSERT_EQ_SIZE(loop->depth, 1);
+    TEST_ASSERT_EQ_SIZE(loop->preheader, 0);
+    TEST_ASSERT_TRUE(loops_contains(&loops, 0, 2));
+    TEST_ASSERT_FALSE(loops_contains(&loops, 0, 3));
+    TEST_ASSERT_TRUE(loops.innermost[0] == CFG_NONE);
+    TEST_ASSERT_EQ_SIZE(loops.innermost[2], 0);
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+TEST(nested_loops, {
+    graph_t g;
+    build_graph(&g, 6, NESTED, NELEM(NESTED));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 2);
+    const loop_t* outer = &loops.loops[0];
+    const loop_t* inner = &loops.loops[1];
+    TEST_ASSERT_EQ_SIZE(outer->header, 1);
+    TEST_ASSERT_EQ_SIZE(outer->nblocks, 4);
+    TEST_ASSERT_EQ_SIZE(outer->preheader, 0);
+    TEST_ASSERT_EQ_SIZE(inner->header, 2);
+    TEST_ASSERT_EQ_SIZE(inner->nblocks, 2);
+    TEST_ASSERT_EQ_SIZE(inner->parent, 0);
+    TEST_ASSERT_EQ_SIZE(inner->depth, 2);
+    TEST_ASSERT_EQ_SIZE(inner->preheader, 1);
+
+    TEST_ASSERT_EQ_SIZE(loops.innermost[1], 0);
+    TEST_ASSERT_EQ_SIZE(loops.innermost[3], 1);
+    TEST_ASSERT_EQ_SIZE(loops.innermost[4], 0);
+    TEST_ASSERT_TRUE(loops.innermost[5] == CFG_NONE);
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+TEST(back_edges_share_header, {
+    graph_t g;
+    build_graph(&g, 5, SHARED_HEADER, NELEM(SHARED_HEADER));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 1);
+    TEST_ASSERT_EQ_SIZE(loops.loops[0].nblocks, 3);
+    TEST_ASSERT_TRUE(loops_contains(&loops, 0, 2));
+    TEST_ASSERT_TRUE(loops_contains(&loops, 0, 3));
+    TEST_ASSERT_FALSE(loops_contains(&loops, 0, 4));
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+TEST(self_loop_without_preheader, {
+    // Block 0 also branches past the loop, so it is not a preheader.
+    graph_t g;
+    build_graph(&g, 3, SELF_LOOP, NELEM(SELF_LOOP));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 1);
+    TEST_ASSERT_EQ_SIZE(loops.loops[0].header, 1);
+    TEST_ASSERT_EQ_SIZE(loops.loops[0].nblocks, 1);
+    TEST_ASSERT_TRUE(loops.loops[0].preheader == CFG_NONE);
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+TEST(acyclic_has_no_loops, {
+    graph_t g;
+    build_graph(&g, 4, DIAMOND, NELEM(DIAMOND));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 0);
+    for (size_t b = 0; b < 4; ++b) {
+        TEST_ASSERT_TRUE(loops.innermost[b] == CFG_NONE);
+    }
+    TEST_ASSERT_FALSE(loops_contains(&loops, 0, 0));
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+TEST(irreducible_cycle_is_not_natural, {
+    // Neither 1 nor 2 dominates the other, so the cycle has no header.
+    graph_t g;
+    build_graph(&g, 3, IRREDUCIBLE, NELEM(IRREDUCIBLE));
+    loops_t loops = {0};
+    loops_build(&g.cfg, &g.dom, &loops);
+
+    TEST_ASSERT_EQ_SIZE(loops.nloops, 0);
+
+    loops_fini(&loops);
+    dom_fini(&g.dom);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("loop", argc, argv);
+
+    TEST_RUN(simple_loop);
+    TEST_RUN(nested_loops);
+    TEST_RUN(back_edges_share_header);
+    TEST_RUN(self_loop_without_preheader);
+    TEST_RUN(acyclic_has_no_loops);
+    TEST_RUN(irreducible_cycle_is_not_natural);
+
+    TEST_EXIT();
+}
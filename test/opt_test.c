@@ -0,0 +1,353 @@
+#include "opt.h"
+
+#include <stddef.h>    // for NULL, size_t
+#include <stdint.h>    // for int32_t
+#include <string.h>    // for strcmp, strlen
+
+#include "alloc.h"     // for fort_alloc, fort_free, ALLOC_CODEGEN
+#include "arena.h"     // for arena_t, arena_fini, mkarena
+#include "assemble.h"  // for asm_func_t, inst_t, INST_MOV, INST_RET, INST_XOR
+#include "common.h"    // for NELEM
+#include "parse.h"     // for prog_t, STMT_RET, EXPR_CONST
+#include "pool.h"      // for mkpool, pool_fini, pool_t
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+// `mov $vals[i], %eax` for each value, with a ret after every value marked in
+// `rets`.
+static void make_func(asm_func_t* func, const int32_t* vals, const int* rets, size_t n) {
+    *func = (asm_func_t){0};
+    inst_t** link = &func->inst;
+    for (size_t i = 0; i < n; ++i) {
+        inst_t* mov = fort_alloc(ALLOC_CODEGEN, sizeof(inst_t));
+        *mov = (inst_t){0};
+        mov->kind = INST_MOV;
+        mov->u.mov.src = (op_t){{{vals[i]}}, OP_IMM};
+        mov->u.mov.dst = (op_t){{{REG_EAX}}, OP_REG};
+        *link = mov;
+        link = &mov->next;
+        if (rets[i]) {
+            inst_t* ret = fort_alloc(ALLOC_CODEGEN, sizeof(inst_t));
+            *ret = (inst_t){0};
+            ret->kind = INST_RET;
+            *link = ret;
+            link = &ret->next;
+        }
+    }
+}
+
+static size_t count_insts(const asm_func_t* func) {
+    size_t n = 0;
+    for (const inst_t* inst = func->inst; inst != NULL; inst = inst->next) {
+        n++;
+    }
+    return n;
+}
+
+static void free_func(asm_func_t* func) {
+    inst_t* inst = func->inst;
+    while (inst != NULL) {
+        inst_t* next = inst->next;
+        fort_free(inst);
+        inst = next;
+    }
+}
+
+// Functions for make_func; TEST bodies cannot hold brace lists with commas.
+static const int32_t DEAD_TAIL_VALS[] = {1, 2, 3};
+static const int DEAD_TAIL_RETS[] = {1, 0, 1};
+static const int32_t TWO_RETS_VALS[] = {1, 2};
+static const int TWO_RETS_RETS[] = {1, 1};
+static const int32_t OVERWRITTEN_VALS[] = {1, 2};
+static const int OVERWRITTEN_RETS[] = {0, 1};
+static const int32_t REPEATED_VALS[] = {5, 5};
+static const int REPEATED_RETS[] = {0, 1};
+static const int32_t ZERO_VALS[] = {0};
+static const int ZERO_RETS[] = {1};
+static const int32_t MINUS_ONE_VALS[] = {-1};
+static const int MINUS_ONE_RETS[] = {1};
+
+TEST(levels_grow, {
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(0, &pipeline), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(pipeline.npasses, 0);
+
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(1, &pipeline), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(pipeline.npasses, 2);
+    TEST_ASSERT_EQ_INT32(pipeline.passes[0], PASS_UNREACHABLE);
+    TEST_ASSERT_EQ_INT32(pipeline.passes[1], PASS_DEAD_DEF);
+
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(2, &pipeline), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(pipeline.npasses, PASS_COUNT);
+
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(OPT_LEVEL_MAX + 1, &pipeline), FORT_OUTCOME_ERR);
+})
+
+TEST(parse_round_trips, {
+    static const char spec[] = "zero-idiom,unreachable,zero-idiom";
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse(spec, &pipeline), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(pipeline.npasses, 3);
+    TEST_ASSERT_EQ_INT32(pipeline.passes[0], PASS_ZERO_IDIOM);
+    TEST_ASSERT_EQ_INT32(pipeline.passes[1], PASS_UNREACHABLE);
+
+    char buf[64];
+    TEST_ASSERT_EQ_SIZE(opt_pipeline_str(&pipeline, buf, sizeof(buf)), strlen(spec));
+    TEST_ASSERT_TRUE(strcmp(buf, spec) == 0);
+
+    // Too small a buffer still reports the full length and stays terminated.
+    char small[8];
+    TEST_ASSERT_EQ_SIZE(opt_pipeline_str(&pipeline, small, sizeof(small)), strlen(spec));
+    TEST_ASSERT_EQ_SIZE(strlen(small), sizeof(small) - 1);
+})
+
+TEST(parse_rejects_bad_lists, {
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("", &pipeline), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_SIZE(pipeline.npasses, 0);
+
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("inline", &pipeline), FORT_OUTCOME_ERR);
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("unreachable,", &pipeline), FORT_OUTCOME_ERR);
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("unreach", &pipeline), FORT_OUTCOME_ERR);
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse(",zero-idiom", &pipeline), FORT_OUTCOME_ERR);
+})
+
+TEST(unreachable_drops_code_after_ret, {
+    asm_func_t func = {0};
+    make_func(&func, DEAD_TAIL_VALS, DEAD_TAIL_RETS, NELEM(DEAD_TAIL_VALS));
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 5);
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("unreachable", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 2);
+    TEST_ASSERT_EQ_INT32(func.inst->u.mov.src.u.imm.val, 1);
+    TEST_ASSERT_EQ_INT32(func.inst->next->kind, INST_RET);
+    TEST_ASSERT_EQ_SIZE(stats.pass_runs[PASS_UNREACHABLE], 1);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_UNREACHABLE], 1);
+    TEST_ASSERT_EQ_SIZE(stats.pass_removed[PASS_UNREACHABLE], 3);
+
+    free_func(&func);
+})
+
+TEST(unreachable_leaves_arena_insts, {
+    // Instructions from an arena are unlinked but not freed; the arena owns
+    // them.
+    arena_t* arena = mkarena(0);
+    asm_func_t func = {0};
+    inst_t* insts = fort_alloc_from(arena, ALLOC_CODEGEN, 3 * sizeof(inst_t));
+    insts[0] = (inst_t){0};
+    insts[0].kind = INST_RET;
+    insts[0].next = &insts[1];
+    insts[1] = (inst_t){0};
+    insts[1].kind = INST_MOV;
+    insts[1].next = &insts[2];
+    insts[2] = (inst_t){0};
+    insts[2].kind = INST_RET;
+    func.inst = insts;
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(1, &pipeline), FORT_OUTCOME_OK);
+    opt_run(&pipeline, &func, arena, NULL);
+
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 1);
+
+    arena_fini(arena);
+})
+
+TEST(dead_def_drops_overwritten_mov, {
+    asm_func_t func = {0};
+    make_func(&func, OVERWRITTEN_VALS, OVERWRITTEN_RETS, NELEM(OVERWRITTEN_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("dead-def", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 2);
+    TEST_ASSERT_EQ_INT32(func.inst->u.mov.src.u.imm.val, 2);
+    TEST_ASSERT_EQ_SIZE(stats.pass_removed[PASS_DEAD_DEF], 1);
+    // Liveness is built on the CFG, which is computed on its behalf.
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_CFG], 1);
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_LIVE], 1);
+
+    free_func(&func);
+})
+
+TEST(dead_def_keeps_return_value, {
+    asm_func_t func = {0};
+    make_func(&func, ZERO_VALS, ZERO_RETS, NELEM(ZERO_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("dead-def", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 2);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_DEAD_DEF], 0);
+
+    free_func(&func);
+})
+
+TEST(gvn_drops_recomputed_value, {
+    asm_func_t func = {0};
+    make_func(&func, REPEATED_VALS, REPEATED_RETS, NELEM(REPEATED_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("gvn", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 2);
+    TEST_ASSERT_EQ_INT32(func.inst->u.mov.src.u.imm.val, 5);
+    TEST_ASSERT_EQ_INT32(func.inst->next->kind, INST_RET);
+    TEST_ASSERT_EQ_SIZE(stats.pass_removed[PASS_GVN], 1);
+    TEST_ASSERT_EQ_SIZE(opt_removed(&stats), 1);
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_DOM], 1);
+
+    free_func(&func);
+})
+
+TEST(zero_idiom_rewrites_mov, {
+    asm_func_t func = {0};
+    make_func(&func, ZERO_VALS, ZERO_RETS, NELEM(ZERO_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("zero-idiom", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    const inst_t* inst = func.inst;
+    TEST_ASSERT_EQ_INT32(inst->kind, INST_XOR);
+    TEST_ASSERT_EQ_INT32(inst->u.xor.src.kind, OP_REG);
+    TEST_ASSERT_EQ_INT32(inst->u.xor.src.u.reg, REG_EAX);
+    TEST_ASSERT_EQ_INT32(inst->u.xor.dst.u.reg, REG_EAX);
+    TEST_ASSERT_EQ_INT32(inst->next->kind, INST_RET);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_ZERO_IDIOM], 1);
+    TEST_ASSERT_EQ_SIZE(stats.pass_removed[PASS_ZERO_IDIOM], 0);
+
+    free_func(&func);
+})
+
+TEST(zero_idiom_keeps_other_movs, {
+    asm_func_t func = {0};
+    make_func(&func, MINUS_ONE_VALS, MINUS_ONE_RETS, NELEM(MINUS_ONE_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(2, &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_INT32(func.inst->kind, INST_MOV);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_ZERO_IDIOM], 0);
+
+    free_func(&func);
+})
+
+TEST(preserved_analyses_are_reused, {
+    // zero-idiom changes the function but keeps the CFG, so the second
+    // unreachable reuses the first one's.
+    asm_func_t func = {0};
+    make_func(&func, ZERO_VALS, ZERO_RETS, NELEM(ZERO_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("unreachable,zero-idiom,unreachable", &pipeline),
+                         FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(stats.pass_runs[PASS_UNREACHABLE], 2);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_ZERO_IDIOM], 1);
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_CFG], 1);
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_DOM], 0);
+
+    free_func(&func);
+})
+
+TEST(changed_analyses_are_recomputed, {
+    // The first unreachable changes the function and preserves nothing.
+    asm_func_t func = {0};
+    make_func(&func, TWO_RETS_VALS, TWO_RETS_RETS, NELEM(TWO_RETS_VALS));
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("unreachable,unreachable", &pipeline),
+                         FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    opt_run(&pipeline, &func, NULL, &stats);
+
+    TEST_ASSERT_EQ_SIZE(stats.analysis_runs[ANALYSIS_CFG], 2);
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_UNREACHABLE], 1);
+    TEST_ASSERT_EQ_SIZE(count_insts(&func), 2);
+
+    free_func(&func);
+})
+
+TEST(merge_adds_up, {
+    opt_stats_t a = {0};
+    opt_stats_t b = {0};
+    a.pass_runs[PASS_UNREACHABLE] = 2;
+    b.pass_runs[PASS_UNREACHABLE] = 3;
+    b.analysis_runs[ANALYSIS_CFG] = 4;
+    opt_stats_merge(&a, &b);
+
+    TEST_ASSERT_EQ_SIZE(a.pass_runs[PASS_UNREACHABLE], 5);
+    TEST_ASSERT_EQ_SIZE(a.analysis_runs[ANALYSIS_CFG], 4);
+})
+
+TEST(assembler_runs_pipeline_on_every_function, {
+    // Four functions on two workers: per-worker stats must all be merged.
+    func_t funcs[3] = {0};
+    prog_t prog = {0};
+    prog.func.body.kind = STMT_RET;
+    prog.func.body.u.ret.expr.kind = EXPR_CONST;
+    prog.func.next = &funcs[0];
+    for (size_t i = 0; i < NELEM(funcs); ++i) {
+        funcs[i].body.kind = STMT_RET;
+        funcs[i].body.u.ret.expr.kind = EXPR_CONST;
+        funcs[i].body.u.ret.expr.u.constant.val = (int32_t)i;
+        funcs[i].next = i + 1 < NELEM(funcs) ? &funcs[i + 1] : NULL;
+    }
+
+    pool_t* pool = mkpool(2);
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_level(2, &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t stats = {0};
+    assembler_t* assembler = mkassembler(&prog);
+    assembler_set_pool(assembler, pool);
+    assembler_set_opt(assembler, &pipeline, &stats);
+    asm_prog_t asm_prog = {0};
+    TEST_ASSERT_EQ_INT32(assembler_run(assembler, &asm_prog), FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(stats.pass_runs[PASS_ZERO_IDIOM], 4);
+    // main and the first function return 0.
+    TEST_ASSERT_EQ_SIZE(stats.pass_changes[PASS_ZERO_IDIOM], 2);
+    TEST_ASSERT_EQ_INT32(asm_prog.func.inst->kind, INST_XOR);
+    TEST_ASSERT_EQ_INT32(asm_prog.func.next->inst->kind, INST_XOR);
+    TEST_ASSERT_EQ_INT32(asm_prog.func.next->next->inst->kind, INST_MOV);
+
+    asm_prog_fini(&asm_prog);
+    assembler_fini(assembler);
+    pool_fini(pool);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("opt", argc, argv);
+
+    TEST_RUN(levels_grow);
+    TEST_RUN(parse_round_trips);
+    TEST_RUN(parse_rejects_bad_lists);
+    TEST_RUN(unreachable_drops_code_after_ret);
+    TEST_RUN(unreachable_leaves_arena_insts);
+    TEST_RUN(dead_def_drops_overwritten_mov);
+    TEST_RUN(dead_def_keeps_return_value);
+    TEST_RUN(gvn_drops_recomputed_value);
+    TEST_RUN(zero_idiom_rewrites_mov);
+    TEST_RUN(zero_idiom_keeps_other_movs);
+    TEST_RUN(preserved_analyses_are_reused);
+    TEST_RUN(changed_analyses_are_recomputed);
+    TEST_RUN(merge_adds_up);
+    TEST_RUN(assembler_runs_pipeline_on_every_function);
+
+    TEST_EXIT();
+}
@@ -311,6 +311,57 @@ TEST(empty_input, {
     lexer_fini(lexer);
 })
 
+TEST(multiple_functions, {
+    const char* src = "i32 f(void) { return 1; }\n"
+                      "i32 g(void) { return 2; }\n"
+                      "i32 main(void) { return 3; }\n";
+    lexer_t* lexer = mklexer(src, strlen(src));
+    tok_stream_t toks = {0};
+    fort_outcome_t lex_outcome = lexer_run(lexer, &toks);
+    TEST_ASSERT_EQ_INT32(lex_outcome, FORT_OUTCOME_OK);
+    parser_t* parser = mkparser(&toks);
+
+    prog_t prog = {0};
+    fort_outcome_t outcome = parser_run(parser, &prog);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    // Functions stay in source order.
+    const func_t* func = &prog.func;
+    for (int32_t i = 1; i <= 3; ++i) {
+        TEST_ASSERT_NONNULL(func);
+        TEST_ASSERT_EQ_INT32(func->body.u.ret.expr.u.constant.val, i);
+        func = func->next;
+    }
+    TEST_ASSERT_TRUE(func == NULL);
+    TEST_ASSERT_EQ_SIZE(prog.func.next->name.len, (size_t)1);
+    TEST_ASSERT_EQ_CHAR(prog.func.next->name.p[0], 'g');
+
+    prog_fini(&prog);
+    parser_fini(parser);
+    tok_stream_fini(&toks);
+    lexer_fini(lexer);
+})
+
+TEST(junk_after_function, {
+    const char* src = "i32 main(void) { return 0; } return";
+    lexer_t* lexer = mklexer(src, strlen(src));
+    tok_stream_t toks = {0};
+    fort_outcome_t lex_outcome = lexer_run(lexer, &toks);
+    TEST_ASSERT_EQ_INT32(lex_outcome, FORT_OUTCOME_OK);
+    parser_t* parser = mkparser(&toks);
+
+    prog_t prog = {0};
+    fort_outcome_t outcome = parser_run(parser, &prog);
+
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_ERR);
+
+    prog_fini(&prog);
+    parser_fini(parser);
+    tok_stream_fini(&toks);
+    lexer_fini(lexer);
+})
+
 TEST(null_parser, {
     prog_t prog = {0};
     fort_outcome_t outcome = parser_run(NULL, &prog);
@@ -354,6 +405,8 @@ int main(int argc, char* argv[]) {
     TEST_RUN(wrong_return_type);
     TEST_RUN(missing_function_name);
     TEST_RUN(empty_input);
+    TEST_RUN(multiple_functions);
+    TEST_RUN(junk_after_function);
     TEST_RUN(null_parser);
     TEST_RUN(null_prog);
 
@@ -0,0 +1,115 @@
+#define _DEFAULT_SOURCE // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "perf.h"
+
+#include <stdint.h>  // for uint32_t, uint64_t, uint8_t
+#include <stdio.h>   // for fclose, fopen, fread, snprintf, FILE
+#include <stdlib.h>  // for mkdtemp, setenv
+#include <string.h>  // for memcmp, memcpy, strlen
+#include <unistd.h>  // for getpid, rmdir, unlink
+
+#include "test.h"    // for TEST_ASSERT_*, TEST
+
+#define PATH_LEN 256
+#define READ_LEN 4096
+
+// mov $7, %eax; ret
+static const uint8_t CODE[] = {0xB8, 0x07, 0x00, 0x00, 0x00, 0xC3};
+
+static size_t read_file(const char* path, char* buf, size_t cap) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t n = fread(buf, 1, cap, file);
+    FORT_UNUSED(fclose(file));
+    return n;
+}
+
+TEST(perf_map_line, {
+    char path[PATH_LEN];
+    FORT_UNUSED(snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid()));
+    FORT_UNUSED(unlink(path));
+
+    perf_map_t* map = mkperf_map();
+    TEST_ASSERT_NONNULL(map);
+
+    const char* name = "main";
+    fort_outcome_t outcome = perf_map_add(map, (const void*)0x1000, 6, (buf_t){name, 4});
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    outcome = perf_map_add(map, (const void*)0x2000, 16, (buf_t){"helper_fn", 6});
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    perf_map_fini(map);
+
+    char buf[READ_LEN] = {0};
+    size_t n = read_file(path, buf, sizeof(buf) - 1);
+    FORT_UNUSED(unlink(path));
+
+    const char* expected = "1000 6 main\n2000 10 helper\n";
+    TEST_ASSERT_EQ_SIZE(n, strlen(expected));
+    TEST_ASSERT_TRUE(memcmp(buf, expected, n) == 0);
+})
+
+TEST(perf_map_null, {
+    fort_outcome_t outcome = perf_map_add(NULL, NULL, 0, (buf_t){"", 0});
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_FATAL);
+})
+
+TEST(jitdump_records, {
+    char dir[] = "/tmp/fort-jitdump-XXXXXX";
+    TEST_ASSERT_NONNULL(mkdtemp(dir));
+    TEST_ERROR_NONZERO(setenv("JITDUMPDIR", dir, 1));
+
+    jitdump_t* dump = mkjitdump();
+    TEST_ASSERT_NONNULL(dump);
+
+    fort_outcome_t outcome = jitdump_code_load(dump, CODE, sizeof(CODE), (buf_t){"main", 4});
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    jitdump_fini(dump);
+
+    char path[PATH_LEN];
+    FORT_UNUSED(snprintf(path, sizeof(path), "%s/jit-%d.dump", dir, (int)getpid()));
+    char buf[READ_LEN] = {0};
+    size_t n = read_file(path, buf, sizeof(buf));
+    FORT_UNUSED(unlink(path));
+    FORT_UNUSED(rmdir(dir));
+
+    // File header: magic, version, header size, e_machine.
+    uint32_t u32[4];
+    TEST_ASSERT_GE_SIZE(n, sizeof(u32));
+    memcpy(u32, buf, sizeof(u32));
+    TEST_ASSERT_EQ_INT64((uint64_t)u32[0], (uint64_t)0x4A695444);
+    TEST_ASSERT_EQ_INT64((uint64_t)u32[1], (uint64_t)1);
+    const size_t header_sz = u32[2];
+    TEST_ASSERT_EQ_INT64((uint64_t)u32[3], (uint64_t)62);
+
+    // JIT_CODE_LOAD: record header, pid, tid, vma, code_addr, code_size, code_index, name, code.
+    const size_t load_fixed_sz = 16 + 8 + 4 * 8;
+    const size_t load_sz = load_fixed_sz + 5 + sizeof(CODE);
+    TEST_ASSERT_GE_SIZE(n, header_sz + load_sz);
+    const char* rec = buf + header_sz;
+    uint32_t rec_hdr[2];
+    memcpy(rec_hdr, rec, sizeof(rec_hdr));
+    TEST_ASSERT_EQ_INT64((uint64_t)rec_hdr[0], (uint64_t)0);
+    TEST_ASSERT_EQ_SIZE((size_t)rec_hdr[1], load_sz);
+
+    uint64_t code_size = 0;
+    memcpy(&code_size, rec + 16 + 8 + 2 * 8, sizeof(code_size));
+    TEST_ASSERT_EQ_INT64(code_size, (uint64_t)sizeof(CODE));
+    TEST_ASSERT_TRUE(memcmp(rec + load_fixed_sz, "main", 5) == 0);
+    TEST_ASSERT_TRUE(memcmp(rec + load_fixed_sz + 5, CODE, sizeof(CODE)) == 0);
+
+    // JIT_CODE_CLOSE trailer.
+    TEST_ASSERT_EQ_SIZE(n, header_sz + load_sz + 16);
+    memcpy(rec_hdr, rec + load_sz, sizeof(rec_hdr));
+    TEST_ASSERT_EQ_INT64((uint64_t)rec_hdr[0], (uint64_t)3);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("perf", argc, argv);
+
+    TEST_RUN(perf_map_line);
+    TEST_RUN(perf_map_null);
+    TEST_RUN(jitdump_records);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,132 @@
+#include "pool.h"
+
+#include <stdatomic.h>  // for atomic_fetch_add, atomic_init, atomic_load, atomic_size_t
+#include <stddef.h>     // for size_t, NULL
+#include <stdlib.h>     // for calloc, free
+
+#include "test.h"       // for TEST_ASSERT_*, TEST
+
+#define NJOBS 1000
+#define NWORKERS 4
+
+typedef struct {
+    size_t* hits;
+    size_t* worker_of;
+    atomic_size_t calls;
+} count_ctx_t;
+
+static void count_init(count_ctx_t* ctx) {
+    ctx->hits = calloc(NJOBS, sizeof(size_t));
+    ctx->worker_of = calloc(NJOBS, sizeof(size_t));
+    atomic_init(&ctx->calls, 0);
+}
+
+static void count_fini(count_ctx_t* ctx) {
+    free(ctx->worker_of);
+    free(ctx->hits);
+}
+
+static void count_job(void* ctx, size_t job, size_t worker) {
+    count_ctx_t* count = ctx;
+    count->hits[job]++;
+    count->worker_of[job] = worker;
+    FORT_UNUSED(atomic_fetch_add(&count->calls, 1));
+}
+
+static void noop_job(void* ctx, size_t job, size_t worker) {
+    FORT_UNUSED(ctx);
+    FORT_UNUSED(job);
+    FORT_UNUSED(worker);
+}
+
+TEST(every_job_runs_once, {
+    pool_t* pool = mkpool(NWORKERS);
+    TEST_ASSERT_NONNULL(pool);
+    TEST_ASSERT_EQ_SIZE(pool_nworkers(pool), (size_t)NWORKERS);
+
+    count_ctx_t ctx;
+    count_init(&ctx);
+    fort_outcome_t outcome = pool_run(pool, NJOBS, count_job, &ctx);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    TEST_ASSERT_EQ_SIZE(atomic_load(&ctx.calls), (size_t)NJOBS);
+    for (size_t i = 0; i < NJOBS; ++i) {
+        TEST_ASSERT_EQ_SIZE(ctx.hits[i], (size_t)1);
+        TEST_ASSERT_TRUE(ctx.worker_of[i] < NWORKERS);
+    }
+
+    count_fini(&ctx);
+    pool_fini(pool);
+})
+
+TEST(single_worker_runs_in_order, {
+    pool_t* pool = mkpool(1);
+    TEST_ASSERT_NONNULL(pool);
+
+    count_ctx_t ctx;
+    count_init(&ctx);
+    fort_outcome_t outcome = pool_run(pool, NJOBS, count_job, &ctx);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    for (size_t i = 0; i < NJOBS; ++i) {
+        TEST_ASSERT_EQ_SIZE(ctx.hits[i], (size_t)1);
+        TEST_ASSERT_EQ_SIZE(ctx.worker_of[i], (size_t)0);
+    }
+
+    count_fini(&ctx);
+    pool_fini(pool);
+})
+
+TEST(pool_is_reusable, {
+    pool_t* pool = mkpool(NWORKERS);
+    TEST_ASSERT_NONNULL(pool);
+
+    count_ctx_t ctx;
+    count_init(&ctx);
+    const size_t nrounds = 50;
+    for (size_t round = 0; round < nrounds; ++round) {
+        fort_outcome_t outcome = pool_run(pool, round, count_job, &ctx);
+        TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+    }
+
+    // Job i runs in every round r > i.
+    for (size_t i = 0; i < nrounds; ++i) {
+        TEST_ASSERT_EQ_SIZE(ctx.hits[i], nrounds - 1 - i);
+    }
+
+    count_fini(&ctx);
+    pool_fini(pool);
+})
+
+TEST(zero_jobs, {
+    pool_t* pool = mkpool(NWORKERS);
+    TEST_ASSERT_NONNULL(pool);
+
+    fort_outcome_t outcome = pool_run(pool, 0, noop_job, NULL);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_OK);
+
+    pool_fini(pool);
+})
+
+TEST(zero_workers, {
+    pool_t* pool = mkpool(0);
+    TEST_ASSERT_TRUE(pool == NULL);
+})
+
+TEST(null_pool, {
+    fort_outcome_t outcome = pool_run(NULL, 1, noop_job, NULL);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_FATAL);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("pool", argc, argv);
+
+    TEST_RUN(every_job_runs_once);
+    TEST_RUN(single_worker_runs_in_order);
+    TEST_RUN(pool_is_reusable);
+    TEST_RUN(zero_jobs);
+    TEST_RUN(zero_workers);
+    TEST_RUN(null_pool);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,240 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "server.h"
+
+#include <errno.h>     // for errno, EADDRINUSE, EEXIST
+#include <pthread.h>   // for pthread_create, pthread_join, pthread_t
+#include <stdatomic.h> // for atomic_int, atomic_fetch_add, atomic_init, atomic_load
+#include <stdio.h>     // for fclose, fopen, snprintf
+#include <stdlib.h>    // for mkdtemp
+#include <string.h>    // for memcmp, memcpy, strlen
+#include <time.h>      // for nanosleep, timespec
+#include <unistd.h>    // for access, rmdir, unlink, F_OK
+#include <sys/stat.h>  // for stat, S_IRWXG, S_IRWXO
+
+#include "alloc.h"     // for fort_alloc, ALLOC_DRIVER
+#include "pool.h"      // for mkpool, pool_fini, pool_t
+#include "test.h"      // for TEST_ASSERT_*, TEST
+
+#define PATH_LEN 64
+#define WAIT_STEP_NS 1000000
+#define WAIT_STEPS 2000
+
+static char ARG_PROG[] = "fort";
+static char ARG_OPT[] = "--jit";
+static char ARG_FILE[] = "a.fort";
+static char* const ARGS[] = {ARG_PROG, ARG_OPT, ARG_FILE, NULL};
+
+// Replies with the arguments joined by spaces on stdout, the argument count
+// on stderr, and the argument count as the status.
+static void echo_request(void* ctx, size_t worker, int argc, char* argv[], server_reply_t* reply) {
+    FORT_UNUSED(ctx);
+    FORT_UNUSED(worker);
+
+    size_t len = 0;
+    for (int i = 0; i < argc; ++i) {
+        len += strlen(argv[i]) + 1;
+    }
+
+    reply->out = fort_alloc(ALLOC_DRIVER, len);
+    for (int i = 0; i < argc; ++i) {
+        const size_t arg_len = strlen(argv[i]);
+        memcpy(reply->out + reply->out_len, argv[i], arg_len);
+        reply->out_len += arg_len;
+        reply->out[reply->out_len++] = i + 1 < argc ? ' ' : '\n';
+    }
+
+    reply->err = fort_alloc(ALLOC_DRIVER, PATH_LEN);
+    reply->err_len = (size_t)snprintf(reply->err, PATH_LEN, "%d", argc);
+    reply->status = argc;
+}
+
+static void* serve(void* server) {
+    FORT_UNUSED(server_run(server, NULL, echo_request, NULL));
+    return NULL;
+}
+
+// Waits, up to two seconds, for a second request to arrive, and replies with
+// status 0 if it did. A server that handles one request at a time never lets
+// the second one in while the first is waiting.
+static void wait_for_peer(void* ctx, size_t worker, int argc, char* argv[], server_reply_t* reply) {
+    FORT_UNUSED(worker);
+    FORT_UNUSED(argc);
+    FORT_UNUSED(argv);
+    atomic_int* arrived = ctx;
+
+    FORT_UNUSED(atomic_fetch_add(arrived, 1));
+    const struct timespec step = {0, WAIT_STEP_NS};
+    for (int i = 0; i < WAIT_STEPS && atomic_load(arrived) < 2; ++i) {
+        FORT_UNUSED(nanosleep(&step, NULL));
+    }
+    reply->status = atomic_load(arrived) >= 2 ? 0 : 1;
+}
+
+typedef struct {
+    server_t* server;
+    pool_t* pool;
+    atomic_int arrived;
+} pooled_server_t;
+
+static void* serve_pooled(void* arg) {
+    pooled_server_t* ps = arg;
+    FORT_UNUSED(server_run(ps->server, ps->pool, wait_for_peer, &ps->arrived));
+    return NULL;
+}
+
+static char SOCKET_ARG[PATH_LEN];
+
+static void* call(void* status) {
+    char* const args[] = {ARG_PROG, NULL};
+    server_reply_t reply = {0};
+    *(int*)status = server_call(SOCKET_ARG, 1, args, &reply) == FORT_OUTCOME_OK ? reply.status : -1;
+    server_reply_fini(&reply);
+    return NULL;
+}
+
+static void socket_path(char* dir, char* path) {
+    memcpy(dir, "/tmp/fort-server-XXXXXX", sizeof("/tmp/fort-server-XXXXXX"));
+    if (mkdtemp(dir) == NULL) {
+        dir[0] = '\0';
+    }
+    FORT_UNUSED(snprintf(path, PATH_LEN, "%s/fort.sock", dir));
+}
+
+TEST(round_trip, {
+    char dir[PATH_LEN];
+    char path[PATH_LEN];
+    socket_path(dir, path);
+
+    server_t* server = mkserver(path);
+    TEST_ASSERT_NONNULL(server);
+
+    pthread_t thread;
+    TEST_ASSERT_EQ_INT32(pthread_create(&thread, NULL, serve, server), 0);
+
+    // Requests are independent; the same server answers each of them.
+    for (int i = 0; i < 3; ++i) {
+        server_reply_t reply = {0};
+        TEST_ASSERT_EQ_INT32(server_call(path, 3, ARGS, &reply), FORT_OUTCOME_OK);
+        TEST_ASSERT_EQ_INT32(reply.status, 3);
+        TEST_ASSERT_EQ_SIZE(reply.out_len, strlen("fort --jit a.fort\n"));
+        TEST_ASSERT_TRUE(memcmp(reply.out, "fort --jit a.fort\n", reply.out_len) == 0);
+        TEST_ASSERT_EQ_SIZE(reply.err_len, (size_t)1);
+        TEST_ASSERT_EQ_CHAR(reply.err[0], '3');
+        server_reply_fini(&reply);
+    }
+
+    server_stop(server);
+    TEST_ASSERT_EQ_INT32(pthread_join(thread, NULL), 0);
+    server_fini(server);
+
+    // The socket file goes away with the server, so the directory is empty.
+    TEST_ASSERT_EQ_INT32(rmdir(dir), 0);
+})
+
+TEST(second_server_is_refused, {
+    char dir[PATH_LEN];
+    char path[PATH_LEN];
+    socket_path(dir, path);
+
+    server_t* server = mkserver(path);
+    TEST_ASSERT_NONNULL(server);
+
+    errno = 0;
+    TEST_ASSERT_TRUE(mkserver(path) == NULL);
+    TEST_ASSERT_EQ_INT32(errno, EADDRINUSE);
+
+    server_fini(server);
+    TEST_ASSERT_EQ_INT32(rmdir(dir), 0);
+})
+
+TEST(socket_is_private, {
+    char dir[PATH_LEN];
+    char path[PATH_LEN];
+    socket_path(dir, path);
+
+    server_t* server = mkserver(path);
+    TEST_ASSERT_NONNULL(server);
+    struct stat st;
+    TEST_ASSERT_EQ_INT32(stat(path, &st), 0);
+    TEST_ASSERT_TRUE((st.st_mode & (S_IRWXG | S_IRWXO)) == 0);
+
+    server_fini(server);
+    TEST_ASSERT_EQ_INT32(rmdir(dir), 0);
+})
+
+TEST(other_file_is_kept, {
+    char dir[PATH_LEN];
+    char path[PATH_LEN];
+    socket_path(dir, path);
+    FILE* f = fopen(path, "w");
+    TEST_ASSERT_NONNULL(f);
+    const int closed = fclose(f);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    errno = 0;
+    TEST_ASSERT_TRUE(mkserver(path) == NULL);
+    TEST_ASSERT_EQ_INT32(errno, EEXIST);
+    TEST_ASSERT_EQ_INT32(access(path, F_OK), 0);
+
+    TEST_ASSERT_EQ_INT32(unlink(path), 0);
+    TEST_ASSERT_EQ_INT32(rmdir(dir), 0);
+})
+
+TEST(serves_requests_concurrently, {
+    char dir[PATH_LEN];
+    socket_path(dir, SOCKET_ARG);
+
+    pooled_server_t ps;
+    ps.server = mkserver(SOCKET_ARG);
+    ps.pool = mkpool(2);
+    atomic_init(&ps.arrived, 0);
+    TEST_ASSERT_NONNULL(ps.server);
+    TEST_ASSERT_NONNULL(ps.pool);
+    pthread_t server_thread;
+    TEST_ASSERT_EQ_INT32(pthread_create(&server_thread, NULL, serve_pooled, &ps), 0);
+
+    int status[2];
+    pthread_t clients[2];
+    for (size_t i = 0; i < 2; ++i) {
+        status[i] = -1;
+        TEST_ASSERT_EQ_INT32(pthread_create(&clients[i], NULL, call, &status[i]), 0);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        TEST_ASSERT_EQ_INT32(pthread_join(clients[i], NULL), 0);
+        TEST_ASSERT_EQ_INT32(status[i], 0);
+    }
+
+    server_stop(ps.server);
+    TEST_ASSERT_EQ_INT32(pthread_join(server_thread, NULL), 0);
+    server_fini(ps.server);
+    pool_fini(ps.pool);
+    TEST_ASSERT_EQ_INT32(rmdir(dir), 0);
+})
+
+TEST(no_server, {
+    server_reply_t reply = {0};
+    fort_outcome_t outcome = server_call("/tmp/fort-server-missing.sock", 1, ARGS, &reply);
+    TEST_ASSERT_EQ_INT32(outcome, FORT_OUTCOME_ERR);
+    TEST_ASSERT_TRUE(reply.out == NULL);
+})
+
+TEST(path_too_long, {
+    char path[256];
+    memset(path, 'x', sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    TEST_ASSERT_TRUE(mkserver(path) == NULL);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("server", argc, argv);
+
+    TEST_RUN(round_trip);
+    TEST_RUN(second_server_is_refused);
+    TEST_RUN(socket_is_private);
+    TEST_RUN(other_file_is_kept);
+    TEST_RUN(serves_requests_concurrently);
+    TEST_RUN(no_server);
+    TEST_RUN(path_too_long);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,179 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "stats.h"
+
+#include <stdint.h>    // for uint64_t
+#include <stdio.h>     // for fclose, open_memstream, FILE
+#include <stdlib.h>    // for free
+#include <string.h>    // for strstr
+
+#include "arena.h"     // for arena_t, arena_fini, mkarena
+#include "assemble.h"  // for asm_prog_t, assembler_run, mkassembler
+#include "jit.h"       // for jit_prog_t, jit_run, mkjit
+#include "lex.h"       // for tok_stream_t, lexer_run, mklexer
+#include "opt.h"       // for opt_pipeline_t, opt_stats_t, opt_pipeline_parse, PASS_GVN
+#include "parse.h"     // for prog_t, parser_run, mkparser
+#include "test.h"      // for TEST_ASSERT_*, TEST
+#include "test_ir.h"   // for link_insts, set_mov_imm, set_ret
+
+static const char SRC[] = "i32 f(void) { return 1; }\n"
+                          "i32 main(void) { return 42; }\n";
+
+TEST(counts_every_stage, {
+    stats_t stats = {0};
+
+    tok_stream_t toks = {0};
+    lexer_t* lexer = mklexer(SRC, sizeof(SRC) - 1);
+    TEST_ASSERT_EQ_INT32(lexer_run(lexer, &toks), FORT_OUTCOME_OK);
+    stats_count_toks(&stats, &toks);
+    TEST_ASSERT_TRUE(stats.toks[TOKT_IDENTIFIER] == 2);
+    TEST_ASSERT_TRUE(stats.toks[TOKT_KEYWORD_RETURN] == 2);
+    TEST_ASSERT_TRUE(stats.toks[TOKT_EOF] == 1);
+    TEST_ASSERT_TRUE(stats.toks[TOKT_ERROR] == 0);
+
+    prog_t prog = {0};
+    parser_t* parser = mkparser(&toks);
+    TEST_ASSERT_EQ_INT32(parser_run(parser, &prog), FORT_OUTCOME_OK);
+    stats_count_prog(&stats, &prog);
+    TEST_ASSERT_TRUE(stats.funcs == 2);
+    TEST_ASSERT_TRUE(stats.stmts[STMT_RET] == 2);
+    TEST_ASSERT_TRUE(stats.exprs[EXPR_CONST] == 2);
+
+    asm_prog_t asm_prog = {0};
+    assembler_t* assembler = mkassembler(&prog);
+    TEST_ASSERT_EQ_INT32(assembler_run(assembler, &asm_prog), FORT_OUTCOME_OK);
+    stats_count_asm(&stats, &asm_prog);
+    TEST_ASSERT_TRUE(stats.ir_lowered == 4);
+    TEST_ASSERT_TRUE(stats.ir_optimized == 4);
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("dead-def", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t opt = {0};
+    opt.step_removed[0] = 1;
+    stats_count_opt(&stats, &pipeline, &opt);
+    TEST_ASSERT_TRUE(stats.ir_lowered == 5);
+    TEST_ASSERT_TRUE(stats.ir_optimized == 4);
+    TEST_ASSERT_EQ_SIZE(stats.npasses, 1);
+    TEST_ASSERT_TRUE(stats.pass_before[0] == 5);
+    TEST_ASSERT_TRUE(stats.pass_after[0] == 4);
+    TEST_ASSERT_TRUE(stats.insts[INST_MOV] == 2);
+    TEST_ASSERT_TRUE(stats.insts[INST_RET] == 2);
+
+    jit_prog_t jit_prog = {0};
+    jit_t* jit = mkjit(&asm_prog);
+    TEST_ASSERT_EQ_INT32(jit_run(jit, &jit_prog), FORT_OUTCOME_OK);
+    stats_count_code(&stats, &jit_prog);
+    TEST_ASSERT_TRUE(stats.code_bytes == jit_prog.func.len);
+    TEST_ASSERT_TRUE(stats.spills == 0);
+
+    jit_prog_fini(&jit_prog);
+    jit_fini(jit);
+    asm_prog_fini(&asm_prog);
+    assembler_fini(assembler);
+    prog_fini(&prog);
+    parser_fini(parser);
+    tok_stream_fini(&toks);
+    lexer_fini(lexer);
+})
+
+TEST(key_value_report, {
+    stats_t stats = {0};
+    stats.toks[TOKT_SEMICOLON] = 3;
+    stats.insts[INST_MOV] = 5;
+    stats.code_bytes = 12;
+    stats.encoded = true;
+    stats.npasses = 2;
+    stats.passes[0] = PASS_GVN;
+    stats.pass_before[0] = 4;
+    stats.pass_after[0] = 3;
+    stats.passes[1] = PASS_GVN;
+    stats.pass_before[1] = 3;
+    stats.pass_after[1] = 3;
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    stats_print(out, "a.fort", &stats);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "file=a.fort\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\ntokens.semicolon=3\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\nast.expr.const=0\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\nir.pass.gvn.before=4\nir.pass.gvn.after=3\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\nir.pass.gvn.2.before=3\nir.pass.gvn.2.after=3\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\ninsts.mov=5\n"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\ncode_bytes=12\n"));
+
+    free(buf);
+})
+
+TEST(json_report, {
+    stats_t stats = {0};
+    stats.funcs = 1;
+    stats.stmts[STMT_RET] = 1;
+    stats.ir_lowered = 2;
+    stats.ir_optimized = 1;
+    stats.npasses = 1;
+    stats.passes[0] = PASS_DEAD_DEF;
+    stats.pass_before[0] = 2;
+    stats.pass_after[0] = 1;
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    stats_print_json(out, "dir/\"q\".fort", &stats);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "{\"file\":\"dir/\\\"q\\\".fort\",\"tokens\":{\"identifier\":0,"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\"ast\":{\"func\":1,\"stmt\":{\"ret\":1},\"expr\":{\"const\":0}}"));
+    TEST_ASSERT_NONNULL(strstr(buf, "\"ir\":{\"lowered\":2,\"optimized\":1,\"passes\":[{\"name\":"
+                                    "\"dead-def\",\"before\":2,\"after\":1}]},\"insts\":{\"mov\":0,"
+                                    "\"ret\":0,\"xor\":0}"));
+    // Nothing was encoded, so there is no code size to report.
+    TEST_ASSERT_NONNULL(strstr(buf, "\"spills\":0}\n"));
+    TEST_ASSERT_TRUE(strstr(buf, "code_bytes") == NULL);
+
+    free(buf);
+})
+
+TEST(gvn_row_shows_removed_instructions, {
+    // The second mov loads a value eax already holds.
+    inst_t insts[3];
+    set_mov_imm(&insts[0], REG_EAX, 5);
+    set_mov_imm(&insts[1], REG_EAX, 5);
+    set_ret(&insts[2]);
+    link_insts(insts, 3);
+    asm_prog_t asm_prog = {0};
+    asm_prog.func.inst = insts;
+
+    opt_pipeline_t pipeline = {0};
+    TEST_ASSERT_EQ_INT32(opt_pipeline_parse("gvn", &pipeline), FORT_OUTCOME_OK);
+    opt_stats_t opt = {0};
+    // The instructions live on the stack, so nothing may be freed.
+    arena_t* arena = mkarena(1024);
+    opt_run(&pipeline, &asm_prog.func, arena, &opt);
+    arena_fini(arena);
+
+    stats_t stats = {0};
+    stats_count_asm(&stats, &asm_prog);
+    stats_count_opt(&stats, &pipeline, &opt);
+    TEST_ASSERT_EQ_SIZE(stats.npasses, 1);
+    TEST_ASSERT_TRUE(stats.passes[0] == PASS_GVN);
+    TEST_ASSERT_TRUE(stats.pass_before[0] == 3);
+    TEST_ASSERT_TRUE(stats.pass_after[0] == 2);
+    TEST_ASSERT_TRUE(stats.ir_lowered == 3);
+    TEST_ASSERT_TRUE(stats.ir_optimized == 2);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("stats", argc, argv);
+
+    TEST_RUN(counts_every_stage);
+    TEST_RUN(key_value_report);
+    TEST_RUN(json_report);
+    TEST_RUN(gvn_row_shows_removed_instructions);
+
+    TEST_EXIT();
+}
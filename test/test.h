@@ -1,12 +1,16 @@
 #ifndef FORT_TEST_H
 #define FORT_TEST_H
 
-#include <inttypes.h>  // for PRId32, PRId64
+#include <inttypes.h>  // for PRId32, PRId64, PRIu64
 #include <stdbool.h>   // for false, true
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for uint64_t, UINT64_MAX
 #include <stdio.h>     // for NULL
 #include <string.h>    // for strlen, strncmp
 
-#include "common.h"    // for eprintln
+#include "alloc.h"     // for alloc_heap
+#include "common.h"    // for eprintln, FORT_UNUSED
+#include "timing.h"    // for timing_now
 
 typedef enum {
     TEST_RESULT_OK = 0,
@@ -82,6 +86,55 @@ typedef enum {
         TEST_OK();                                                                                 \
     }
 
+// Defines a test that runs `test_body` `reps` times and reports the fastest
+// and mean run. The test fails as soon as one run does. Only the code inside
+// TEST_BENCH_TIMED is timed, so setup and teardown around it are not; a body
+// without a timed section is timed whole.
+#define TEST_BENCH(test_name, reps, test_body)                                                     \
+    static TEST_RESULT_ test_name##_once_(uint64_t* test_timed_ns_) {                              \
+        FORT_UNUSED(test_timed_ns_);                                                               \
+        test_body;                                                                                 \
+        TEST_OK();                                                                                 \
+    }                                                                                              \
+    static TEST_RESULT_ test_name(void) {                                                          \
+        const size_t test_reps = (reps);                                                           \
+        uint64_t test_min_ns = UINT64_MAX;                                                         \
+        uint64_t test_total_ns = 0;                                                                \
+        for (size_t test_rep = 0; test_rep < test_reps; ++test_rep) {                              \
+            uint64_t test_timed_ns = UINT64_MAX;                                                   \
+            const uint64_t test_start = timing_now();                                              \
+            const TEST_RESULT_ test_result = test_name##_once_(&test_timed_ns);                    \
+            uint64_t test_ns = timing_now() - test_start;                                          \
+            if (test_result != TEST_RESULT_OK) {                                                   \
+                return test_result;                                                                \
+            }                                                                                      \
+            test_ns = test_timed_ns != UINT64_MAX ? test_timed_ns : test_ns;                       \
+            test_min_ns = test_ns < test_min_ns ? test_ns : test_min_ns;                           \
+            test_total_ns += test_ns;                                                              \
+        }                                                                                          \
+        if (test_reps > 0) {                                                                       \
+            eprintln("BENCH: %s reps=%zu min=%" PRIu64 "ns mean=%" PRIu64 "ns",                    \
+                     #test_name,                                                                   \
+                     test_reps,                                                                    \
+                     test_min_ns,                                                                  \
+                     test_total_ns / test_reps);                                                   \
+        }                                                                                          \
+        TEST_OK();                                                                                 \
+    }
+
+// The part of a TEST_BENCH body that is timed. It may appear more than once,
+// and the times add up.
+#define TEST_BENCH_TIMED(...)                                                                      \
+    do {                                                                                           \
+        const uint64_t test_timed_start_ = timing_now();                                           \
+        __VA_ARGS__;                                                                               \
+        const uint64_t test_timed_end_ = timing_now();                                             \
+        if (*test_timed_ns_ == UINT64_MAX) {                                                       \
+            *test_timed_ns_ = 0;                                                                   \
+        }                                                                                          \
+        *test_timed_ns_ += test_timed_end_ - test_timed_start_;                                    \
+    } while (0)
+
 #if defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
@@ -153,6 +206,37 @@ typedef enum {
 #define TEST_ASSERT_LE_INT64(val, exp) TEST_ASSERT_LE_(val, exp, "%" PRId64)
 #define TEST_ASSERT_LE_SIZE(val, exp) TEST_ASSERT_LE_(val, exp, "%zu")
 
+// Allocation budgets: TEST_ALLOCS_BEGIN marks a point in a test, and
+// TEST_ASSERT_ALLOCS_LE fails if more than `max_count` heap allocations or
+// `max_bytes` bytes went through fort_alloc since then. Requests an arena
+// serves from memory it already has are free; plain malloc is not seen.
+#define TEST_ALLOCS_COUNT_ test_allocs_count
+#define TEST_ALLOCS_BYTES_ test_allocs_bytes
+
+#define TEST_ALLOCS_BEGIN()                                                                        \
+    size_t TEST_ALLOCS_COUNT_ = 0;                                                                 \
+    size_t TEST_ALLOCS_BYTES_ = 0;                                                                 \
+    alloc_heap(&TEST_ALLOCS_COUNT_, &TEST_ALLOCS_BYTES_)
+
+#define TEST_ASSERT_ALLOCS_LE(max_count, max_bytes)                                                \
+    do {                                                                                           \
+        size_t test_count = 0;                                                                     \
+        size_t test_bytes = 0;                                                                     \
+        alloc_heap(&test_count, &test_bytes);                                                      \
+        test_count -= TEST_ALLOCS_COUNT_;                                                          \
+        test_bytes -= TEST_ALLOCS_BYTES_;                                                          \
+        if (test_count > (size_t)(max_count) || test_bytes > (size_t)(max_bytes)) {                \
+            TEST_LOG_("allocation budget exceeded\n"                                               \
+                      "\tactual:   %zu allocations, %zu bytes\n"                                   \
+                      "\texpected: at most %zu allocations, %zu bytes",                            \
+                      test_count,                                                                  \
+                      test_bytes,                                                                  \
+                      (size_t)(max_count),                                                         \
+                      (size_t)(max_bytes));                                                        \
+            return TEST_RESULT_FAIL;                                                               \
+        }                                                                                          \
+    } while (0)
+
 #define TEST_OK() return TEST_RESULT_OK
 
 #define TEST_FAIL() return TEST_RESULT_FAIL
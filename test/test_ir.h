@@ -0,0 +1,65 @@
+#ifndef FORT_TEST_IR_H
+#define FORT_TEST_IR_H
+
+#include <stddef.h>    // for NULL, size_t
+#include <stdint.h>    // for int32_t
+#include <string.h>    // for strlen
+
+#include "assemble.h"  // for inst_t, reg_t, INST_MOV, INST_RET, INST_XOR, OP_IMM, OP_REG
+#include "parse.h"     // for prog_t, STMT_RET, EXPR_CONST
+
+// Programs and instructions that tests build by hand. Registers are plain
+// numbers so that tests can use temporaries past eax.
+
+// A program of one function that returns `ret_val`.
+static inline prog_t make_return_prog(const char* func_name, int32_t ret_val) {
+    prog_t prog = {0};
+    prog.func.name.p = func_name;
+    prog.func.name.len = strlen(func_name);
+    prog.func.body.kind = STMT_RET;
+    prog.func.body.u.ret.expr.kind = EXPR_CONST;
+    prog.func.body.u.ret.expr.u.constant.val = ret_val;
+    return prog;
+}
+
+static inline void set_mov_imm(inst_t* inst, size_t dst, int32_t val) {
+    *inst = (inst_t){0};
+    inst->kind = INST_MOV;
+    inst->u.mov.src.kind = OP_IMM;
+    inst->u.mov.src.u.imm.val = val;
+    inst->u.mov.dst.kind = OP_REG;
+    inst->u.mov.dst.u.reg = (reg_t)dst;
+}
+
+static inline void set_mov_reg(inst_t* inst, size_t dst, size_t src) {
+    *inst = (inst_t){0};
+    inst->kind = INST_MOV;
+    inst->u.mov.src.kind = OP_REG;
+    inst->u.mov.src.u.reg = (reg_t)src;
+    inst->u.mov.dst.kind = OP_REG;
+    inst->u.mov.dst.u.reg = (reg_t)dst;
+}
+
+static inline void set_xor(inst_t* inst, size_t dst, size_t src) {
+    *inst = (inst_t){0};
+    inst->kind = INST_XOR;
+    inst->u.xor.src.kind = OP_REG;
+    inst->u.xor.src.u.reg = (reg_t)src;
+    inst->u.xor.dst.kind = OP_REG;
+    inst->u.xor.dst.u.reg = (reg_t)dst;
+}
+
+static inline void set_ret(inst_t* inst) {
+    *inst = (inst_t){0};
+    inst->kind = INST_RET;
+}
+
+// Links insts[0, n) in order.
+static inline void link_insts(inst_t* insts, size_t n) {
+    for (size_t i = 0; i + 1 < n; ++i) {
+        insts[i].next = &insts[i + 1];
+    }
+    insts[n - 1].next = NULL;
+}
+
+#endif // FORT_TEST_IR_H
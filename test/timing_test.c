@@ -0,0 +1,101 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "timing.h"
+
+#include <stdint.h>  // for uint64_t
+#include <stdio.h>   // for fclose, open_memstream, FILE
+#include <stdlib.h>  // for free
+#include <string.h>  // for strstr, strcmp
+
+#include "test.h"    // for TEST_ASSERT_*, TEST
+
+TEST(lap_accumulates, {
+    timing_t timing = {0};
+    const uint64_t start = timing_now();
+    const uint64_t mid = timing_lap(&timing, PHASE_LEX, start);
+    TEST_ASSERT_TRUE(mid >= start);
+    TEST_ASSERT_TRUE(timing.ns[PHASE_LEX] == mid - start);
+
+    const uint64_t end = timing_lap(&timing, PHASE_LEX, mid);
+    TEST_ASSERT_TRUE(timing.ns[PHASE_LEX] == end - start);
+    TEST_ASSERT_TRUE(timing.ns[PHASE_PARSE] == 0);
+})
+
+TEST(merge_sums_everything, {
+    timing_t a = {0};
+    a.ns[PHASE_LOAD] = 10;
+    a.files = 1;
+    a.bytes = 100;
+    a.tokens = 7;
+    timing_t b = a;
+    b.ns[PHASE_EMIT] = 5;
+
+    timing_merge(&a, &b);
+    TEST_ASSERT_TRUE(a.ns[PHASE_LOAD] == 20);
+    TEST_ASSERT_TRUE(a.ns[PHASE_EMIT] == 5);
+    TEST_ASSERT_TRUE(a.files == 2);
+    TEST_ASSERT_TRUE(a.bytes == 200);
+    TEST_ASSERT_TRUE(a.tokens == 14);
+})
+
+TEST(phase_names, {
+    TEST_ASSERT_TRUE(strcmp(phase_name(PHASE_LOAD), "load_src") == 0);
+    TEST_ASSERT_TRUE(strcmp(phase_name(PHASE_EXEC), "exec") == 0);
+    TEST_ASSERT_TRUE(strcmp(phase_name(PHASE_COUNT), "unknown") == 0);
+})
+
+TEST(json_report, {
+    timing_t timing = {0};
+    timing.ns[PHASE_LEX] = 2000000000;
+    timing.files = 1;
+    timing.bytes = 4000;
+    timing.tokens = 1000;
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    timing_print_json(out, &timing, 3000000000);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "\"files\":1,\"bytes\":4000,\"tokens\":1000,\"wall_ns\":3000000000"));
+    TEST_ASSERT_NONNULL(
+        strstr(buf, "{\"name\":\"lex\",\"ns\":2000000000,\"bytes_per_sec\":2000,\"tokens_per_sec\":500}"));
+    // Phases that did not run report zero rates rather than dividing by zero.
+    TEST_ASSERT_NONNULL(
+        strstr(buf, "{\"name\":\"parse\",\"ns\":0,\"bytes_per_sec\":0,\"tokens_per_sec\":0}"));
+    TEST_ASSERT_EQ_CHAR(buf[len - 1], '\n');
+
+    free(buf);
+})
+
+TEST(text_report, {
+    timing_t timing = {0};
+    timing.ns[PHASE_PARSE] = 1000000;
+
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    timing_print(out, &timing, 1000000);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_NONNULL(strstr(buf, "parse"));
+    TEST_ASSERT_NONNULL(strstr(buf, "100.0%"));
+    TEST_ASSERT_NONNULL(strstr(buf, "wall"));
+
+    free(buf);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("timing", argc, argv);
+
+    TEST_RUN(lap_accumulates);
+    TEST_RUN(merge_sums_everything);
+    TEST_RUN(phase_names);
+    TEST_RUN(json_report);
+    TEST_RUN(text_report);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,104 @@
+#define _XOPEN_SOURCE 700 // NOLINT(bugprone-reserved-identifier,readability-identifier-naming)
+#include "trace.h"
+
+#include <pthread.h>  // for pthread_create, pthread_join, pthread_t
+#include <stdint.h>   // for uint64_t
+#include <stdio.h>    // for fclose, open_memstream, FILE
+#include <stdlib.h>   // for free
+#include <string.h>   // for strstr, strlen
+
+#include "test.h"     // for TEST_ASSERT_*, TEST
+
+#define NTHREADS 4
+#define NEVENTS 3000
+
+static const char SPAN[] = "span";
+
+static size_t count(const char* haystack, const char* needle) {
+    size_t n = 0;
+    for (const char* p = strstr(haystack, needle); p != NULL; p = strstr(p + 1, needle)) {
+        n++;
+    }
+
+    return n;
+}
+
+static void* record(void* arg) {
+    FORT_UNUSED(arg);
+    trace_name_thread("recorder");
+    for (size_t i = 0; i < NEVENTS; ++i) {
+        const uint64_t start = trace_begin();
+        trace_end((buf_t){SPAN, sizeof(SPAN) - 1}, "test", start);
+    }
+
+    return NULL;
+}
+
+TEST(disabled_records_nothing, {
+    TEST_ASSERT_TRUE(trace_begin() == 0);
+    trace_end((buf_t){SPAN, sizeof(SPAN) - 1}, "test", 0);
+    TEST_ASSERT_EQ_INT32(trace_stop(), FORT_OUTCOME_ERR);
+})
+
+TEST(threads_record_concurrently, {
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+    TEST_ASSERT_EQ_INT32(trace_start(out), FORT_OUTCOME_OK);
+    TEST_ASSERT_EQ_INT32(trace_start(out), FORT_OUTCOME_ERR);
+
+    pthread_t threads[NTHREADS];
+    for (size_t i = 0; i < NTHREADS; ++i) {
+        TEST_ASSERT_EQ_INT32(pthread_create(&threads[i], NULL, record, NULL), 0);
+    }
+    for (size_t i = 0; i < NTHREADS; ++i) {
+        TEST_ASSERT_EQ_INT32(pthread_join(threads[i], NULL), 0);
+    }
+
+    TEST_ASSERT_EQ_INT32(trace_stop(), FORT_OUTCOME_OK);
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    // Every event survives, spread over chunk boundaries, plus one label per thread.
+    TEST_ASSERT_EQ_SIZE(count(buf, "\"ph\":\"X\""), (size_t)(NTHREADS * NEVENTS));
+    TEST_ASSERT_EQ_SIZE(count(buf, "\"name\":\"recorder\""), (size_t)NTHREADS);
+    TEST_ASSERT_TRUE(strstr(buf, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == buf);
+    TEST_ASSERT_TRUE(strstr(buf, "]}\n") == buf + len - 3);
+
+    free(buf);
+})
+
+TEST(names_are_escaped_and_truncated, {
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    TEST_ASSERT_NONNULL(out);
+
+    // A second trace in the same thread must not reuse the buffer freed by the first.
+    for (int round = 0; round < 2; ++round) {
+        TEST_ASSERT_EQ_INT32(trace_start(out), FORT_OUTCOME_OK);
+        static const char quoted[] = "dir\\\"a\".fort";
+        trace_end((buf_t){quoted, sizeof(quoted) - 1}, "file", trace_begin());
+        static const char long_name[] = "a_very_long_function_name_that_goes_on_and_on_and_on";
+        trace_end((buf_t){long_name, sizeof(long_name) - 1}, "func", trace_begin());
+        TEST_ASSERT_EQ_INT32(trace_stop(), FORT_OUTCOME_OK);
+    }
+    const int closed = fclose(out);
+    TEST_ASSERT_EQ_INT32(closed, 0);
+
+    TEST_ASSERT_EQ_SIZE(count(buf, "\"name\":\"dir\\\\\\\"a\\\".fort\""), (size_t)2);
+    TEST_ASSERT_EQ_SIZE(count(buf, "a_very_long_function_name_that_goes_on_and_on_a\""), (size_t)2);
+
+    free(buf);
+})
+
+int main(int argc, char* argv[]) {
+    TEST_INIT("trace", argc, argv);
+
+    TEST_RUN(disabled_records_nothing);
+    TEST_RUN(threads_record_concurrently);
+    TEST_RUN(names_are_escaped_and_truncated);
+
+    TEST_EXIT();
+}
@@ -0,0 +1,31 @@
+# Writes OUT, a header defining FORT_BUILD_ID as a hash of the files in SRCS,
+# so that code built from different sources never shares a cache entry even
+# when the version number stays the same. SRCS is separated by '|', since ';'
+# does not survive the build tool.
+#
+#   cmake -DOUT=build_id.h -DSRCS=a.c|b.h -P build_id.cmake
+#
+# OUT is only rewritten when the hash changes, so an unchanged tree does not
+# recompile what includes it.
+
+string(REPLACE "|" ";" srcs "${SRCS}")
+list(SORT srcs)
+
+set(ids "")
+foreach(src IN LISTS srcs)
+    file(SHA256 ${src} hash)
+    get_filename_component(name ${src} NAME)
+    string(APPEND ids "${name}=${hash}\n")
+endforeach()
+string(SHA256 build_id "${ids}")
+
+set(header "// Generated by tools/build_id.cmake; do not edit.\n")
+string(APPEND header "#define FORT_BUILD_ID \"${build_id}\"\n")
+
+set(old "")
+if(EXISTS ${OUT})
+    file(READ ${OUT} old)
+endif()
+if(NOT old STREQUAL header)
+    file(WRITE ${OUT} "${header}")
+endif()